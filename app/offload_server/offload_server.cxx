@@ -11,7 +11,7 @@ inline static std::atomic_bool running = true;
 inline static std::latch l(2 + n_l_worker + n_r_worker * 2);
 
 void server_main(std::string dev_pci_addr, std::string local_ip, std::string remote_ip, std::string output_device,
-                 DispatchFn fn) {
+                 DispatchFn fn, const Codec& codec) {
   doca::Device ch_dev("mlx5_1", doca::Device::FindByIBDevName);
   ch_dev.open_representor(dev_pci_addr);
   doca::Device rdma_dev("mlx5_3", doca::Device::FindByIBDevName);
@@ -49,7 +49,7 @@ void server_main(std::string dev_pci_addr, std::string local_ip, std::string rem
   }
 
   DirectSpillWorker dsw(ch_dev, {true, "disk"}, {.queue_depth = 4, .max_rpc_msg_size = 512}, dsq,
-                        "/home/lsc/dpx/.test_spill", output_device, 1024, spill_bp, running);
+                        "/home/lsc/dpx/.test_spill", output_device, 1024, spill_bp, running, &codec);
 
   PipelineShuffleWorkerPool pswp(lsqs, rsqs, trsqs, dsq, fn, running);
 
@@ -93,29 +93,35 @@ void server_main(std::string dev_pci_addr, std::string local_ip, std::string rem
   }
 }
 
-void dpu21_server_main() {
+void dpu21_server_main(const Codec& codec) {
   server_main("0000:43:00.1", "192.168.203.21", "192.168.203.20", "/dev/nvme1n1p1",
-              [](size_t pid) { return pid % 2 == 0; });
+              [](size_t pid) { return pid % 2 == 0; }, codec);
 }
-void dpu20_server_main() {
+void dpu20_server_main(const Codec& codec) {
   server_main("0000:99:00.1", "192.168.203.20", "192.168.203.21", "/dev/nvme1n1p1",
-              [](size_t pid) { return pid % 2 == 1; });
+              [](size_t pid) { return pid % 2 == 1; }, codec);
 }
 
 }  // namespace dpx
 
 int main(int argc, char* argv[]) {
   spdlog::set_level(spdlog::level::trace);
-  if (argc != 2) {
-    die("Usage: %s [dpu20/dpu21]\n", argv[0]);
+  if (argc != 2 && argc != 3) {
+    die("Usage: %s [dpu20/dpu21] [raw/lz]\n", argv[0]);
   }
   auto which = std::string(argv[1]);
+  // spill blocks are raw unless asked otherwise
+  auto codec_name = argc == 3 ? std::string(argv[2]) : std::string("raw");
+  if (codec_name != "raw" && codec_name != "lz") {
+    die("Usage: %s [dpu20/dpu21] [raw/lz]\n", argv[0]);
+  }
+  auto& codec = dpx::codec_of(codec_name == "lz" ? dpx::CodecType::LZ : dpx::CodecType::Raw);
   if (which == "dpu21") {
-    dpx::dpu21_server_main();
+    dpx::dpu21_server_main(codec);
   } else if (which == "dpu20") {
-    dpx::dpu20_server_main();
+    dpx::dpu20_server_main(codec);
   } else {
-    die("Usage: %s [dpu20/dpu21]\n", argv[0]);
+    die("Usage: %s [dpu20/dpu21] [raw/lz]\n", argv[0]);
   }
   return 0;
 }
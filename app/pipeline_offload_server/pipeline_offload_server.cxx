@@ -1,3 +1,4 @@
+#include "native/combiner.hxx"
 #include "native/shuffle_worker.hxx"
 #include "native/spill_worker.hxx"
 #include "util/literal.hxx"
@@ -6,6 +7,9 @@ namespace dpx {
 
 inline static uint32_t n_r_worker = 2;
 inline static uint32_t n_l_worker = 1;
+// NOTICE: map-side combine folds the buffers the host declares combinable, i.e. PipelineTransEnv.Initialize with a
+// combine op, by the op and value type in their header. set by the optional combine argument
+inline static bool enable_combine = false;
 inline static std::atomic_bool running = true;
 inline static std::latch l(2 + n_l_worker + n_r_worker * 2);
 
@@ -49,7 +53,14 @@ void server_main(std::string dev_pci_addr, std::string local_ip, std::string rem
   LocalSpillWorker lw(ch_dev, rdma_dev, {.passive = true, .name = "disk"}, {.queue_depth = 32, .max_rpc_msg_size = 512},
                       dsq, running);
 
-  PipelineShuffleWorkerPool pswp(lsqs, rsqs, trsqs, dsq, [](size_t pid) { return pid % 2 == 0; }, running);
+  // all dispatch fibers run on one thread, so one combiner is enough
+  Combiner combiner;
+  CombineFn cfn = nullptr;
+  if (enable_combine) {
+    cfn = [&combiner](PartitionBuffer& b) { combiner.combine(b); };
+  }
+
+  PipelineShuffleWorkerPool pswp(lsqs, rsqs, trsqs, dsq, [](size_t pid) { return pid % 2 == 0; }, running, cfn);
 
   uint32_t core_idx = 0;
   pswp.run_dispatch(1, core_idx++);
@@ -97,8 +108,14 @@ void dpu20_server_main() { server_main("0000:99:00.1", "192.168.203.20", "192.16
 
 int main(int argc, char* argv[]) {
   spdlog::set_level(spdlog::level::trace);
-  if (argc != 2) {
-    die("Usage: %s [dpu20/dpu21]\n", argv[0]);
+  if (argc != 2 && argc != 3) {
+    die("Usage: %s [dpu20/dpu21] [combine]\n", argv[0]);
+  }
+  if (argc == 3) {
+    if (std::string(argv[2]) != "combine") {
+      die("Usage: %s [dpu20/dpu21] [combine]\n", argv[0]);
+    }
+    dpx::enable_combine = true;
   }
   auto which = std::string(argv[1]);
   if (which == "dpu21") {
@@ -106,7 +123,7 @@ int main(int argc, char* argv[]) {
   } else if (which == "dpu20") {
     dpx::dpu20_server_main();
   } else {
-    die("Usage: %s [dpu20/dpu21]\n", argv[0]);
+    die("Usage: %s [dpu20/dpu21] [combine]\n", argv[0]);
   }
   return 0;
 }
@@ -0,0 +1,94 @@
+#include <args.hxx>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "native/combiner.hxx"
+#include "util/literal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+using namespace dpx::literal;
+
+args::ArgumentParser p("DPX Combiner Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<uint32_t> n_key(p, "n key", "number of distinct keys", {"n_key"}, 1000);
+args::ValueFlag<uint32_t> key_size(p, "key size", "key size, in bytes", {"key_size"}, 16);
+args::ValueFlag<uint32_t> batch_size(p, "batch size", "batch size, in MB", {"batch_size"}, 32);
+args::ValueFlag<uint32_t> max_entries(p, "max entries", "max entries of the combine table", {"max_entries"}, 4096);
+args::ValueFlag<uint32_t> n_round(p, "n round", "n round", {"n_round"}, 10);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+// fill a batch with framed (key, 1) records, keys are picked with a skewed distribution
+size_t generate(std::vector<uint8_t>& batch, std::unordered_map<std::string, int64_t>& expected) {
+  std::mt19937_64 g(42);
+  // about 8 keys take most records, p must stay below 1 for a handful of keys
+  std::geometric_distribution<uint32_t> d(std::min(0.5, 8.0 / args::get(n_key)));
+  auto ks = args::get(key_size);
+  auto record_size = sizeof(dpx::RecordHeader) + ks + sizeof(int64_t);
+  auto n_record = batch.size() / record_size;
+  std::string key(ks, '\0');
+  for (auto i = 0uz; i < n_record; i++) {
+    auto k = d(g) % args::get(n_key);
+    memset(key.data(), 'a', ks);
+    memcpy(key.data(), &k, std::min<size_t>(ks, sizeof(k)));
+    dpx::RecordHeader h{.key_length = ks, .value_length = sizeof(int64_t)};
+    int64_t v = 1;
+    auto o = batch.data() + i * record_size;
+    memcpy(o, &h, sizeof(h));
+    memcpy(o + sizeof(h), key.data(), ks);
+    memcpy(o + sizeof(h) + ks, &v, sizeof(v));
+    expected[key] += v;
+  }
+  return n_record * record_size;
+}
+
+bool verify(const uint8_t* data, size_t length, const std::unordered_map<std::string, int64_t>& expected) {
+  std::unordered_map<std::string, int64_t> got;
+  for (auto r = 0uz; r < length;) {
+    dpx::RecordHeader h;
+    memcpy(&h, data + r, sizeof(h));
+    std::string key(reinterpret_cast<const char*>(data + r + sizeof(h)), h.key_length);
+    int64_t v;
+    memcpy(&v, data + r + sizeof(h) + h.key_length, sizeof(v));
+    got[key] += v;
+    r += sizeof(h) + h.key_length + h.value_length;
+  }
+  return got == expected;
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  std::vector<uint8_t> origin(args::get(batch_size) * 1_MB);
+  std::unordered_map<std::string, int64_t> expected;
+  auto length = generate(origin, expected);
+
+  dpx::Combiner c(dpx::CombineOp::Sum, dpx::CombineValueType::Int64, args::get(max_entries));
+  std::vector<uint8_t> batch(origin.size());
+  uint64_t total_us = 0;
+  size_t combined = 0;
+  for (auto i = 0uz; i < args::get(n_round); i++) {
+    memcpy(batch.data(), origin.data(), length);
+    dpx::Timer t;
+    combined = c.combine(batch.data(), length);
+    total_us += t.elapsed_us();
+  }
+  if (!verify(batch.data(), combined, expected)) {
+    die("Combined records mismatch");
+  }
+  INFO("{} keys, {} -> {} bytes, ratio {:.2f}, throughput {:.2f} MB/s", expected.size(), length, combined,
+       static_cast<double>(length) / combined, static_cast<double>(length) * args::get(n_round) / total_us);
+  return 0;
+}
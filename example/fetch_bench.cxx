@@ -0,0 +1,136 @@
+#include <args.hxx>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "native/fetch_service.hxx"
+#include "native/spill_block.hxx"
+#include "util/fatal.hxx"
+#include "util/literal.hxx"
+#include "util/timer.hxx"
+
+using namespace dpx::literal;
+
+args::ArgumentParser p("DPX Fetch Service Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::MapFlag<std::string, dpx::Side> side(p, "side", "Client or Server", {"side"},
+                                           std::unordered_map<std::string, dpx::Side>{
+                                               {"Client", dpx::Side::ClientSide},
+                                               {"Server", dpx::Side::ServerSide},
+                                           },
+                                           args::Options::Required);
+args::ValueFlag<std::string> local_ip(p, "local ip", "local ip", {"local_ip"}, "");
+args::ValueFlag<uint16_t> local_port(p, "local port", "local port", {"local_port"}, 0);
+args::ValueFlag<std::string> remote_ip(p, "remote ip", "remote ip", {"remote_ip"}, "");
+args::ValueFlag<uint16_t> remote_port(p, "remote port", "remote port", {"remote_port"}, 0);
+
+args::ValueFlag<std::string> spill_dir(p, "spill dir", "directory of spilled partitions, server only", {"spill_dir"},
+                                       "/tmp");
+args::ValueFlag<uint32_t> n_partition(p, "n partition", "n partition", {"n_partition"}, 16);
+args::ValueFlag<uint32_t> n_buffer(p, "n buffer", "n staging buffer, server only", {"n_buffer"}, 4);
+args::ValueFlag<uint32_t> chunk_size(p, "chunk size", "fetch chunk size, in MB", {"chunk_size"}, 4);
+args::ValueFlag<uint32_t> n_block(p, "n block", "max n block per fetch", {"n_block"}, 16);
+args::Flag decode(p, "decode", "decode and verify the spill blocks of the partitions on the client", {"decode"}, false);
+args::Flag header(p, "header", "partitions are spilled with the file header", {"header"}, false);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << std::endl << p;
+    exit(-1);
+  } catch (args::ValidationError e) {
+    std::cerr << e.what() << std::endl << std::endl << p;
+    exit(-1);
+  }
+}
+
+using FetchTransport = dpx::FetchTransport<dpx::Backend::TCP>;
+
+void run_server(FetchTransport& t) {
+  std::atomic_bool running = true;
+  dpx::TransportGuard g(t);
+  dpx::FetchServer<dpx::Backend::TCP> s(t, args::get(spill_dir), args::get(n_partition), args::get(n_buffer),
+                                        args::get(chunk_size) * 1_MB, running);
+  t.show_rpc_infos();
+  s.serve();
+}
+
+// a fetch over the chunk size of the server is rejected without hanging the client, and the bulk stream stays in
+// step, so the same block reads back the same bytes around it
+void check_oversized_fetch(FetchTransport& t, uint64_t partition_size) {
+  dpx::naive::Buffers landing_bufs(1, 2 * args::get(chunk_size) * 1_MB);
+  auto& landing = landing_bufs[0];
+  dpx::FetchClient<dpx::Backend::TCP> c(t, landing, args::get(n_block));
+  auto small = dpx::FetchBlock{.partition_id = 0, .offset = 0, .length = std::min(partition_size, 4_KB)};
+  c.fetch({small});
+  std::vector<uint8_t> before(landing.data(), landing.data() + small.length);
+
+  auto rejected = false;
+  try {
+    c.fetch({{.partition_id = 0, .offset = 0, .length = args::get(chunk_size) * 1_MB + 1}});
+  } catch (std::runtime_error& e) {
+    INFO("oversized fetch rejected: {}", e.what());
+    rejected = true;
+  }
+  if (!rejected) {
+    die("Fetch over the chunk size of the server is not rejected");
+  }
+
+  c.fetch({small});
+  if (memcmp(before.data(), landing.data(), small.length) != 0) {
+    die("Bulk stream is out of step after a rejected fetch");
+  }
+}
+
+void run_client(FetchTransport& t) {
+  dpx::TransportGuard g(t);
+  dpx::naive::Buffers landing_bufs(1, args::get(chunk_size) * 1_MB);
+  dpx::FetchClient<dpx::Backend::TCP> c(t, landing_bufs[0], args::get(n_block));
+
+  std::vector<uint32_t> partition_ids(args::get(n_partition));
+  std::iota(partition_ids.begin(), partition_ids.end(), 0);
+
+  auto n_fetched = 0uz;
+  auto n_decoded = 0uz;
+  dpx::Timer timer;
+  if (args::get(decode)) {
+    auto sizes = c.stat(partition_ids);
+    n_fetched = std::accumulate(sizes.begin(), sizes.end(), 0uz);
+    c.fetch_decoded(partition_ids, args::get(header),
+                    [&](uint32_t, std::span<const uint8_t> data) { n_decoded += data.size(); });
+  } else {
+    c.fetch_partitions(partition_ids,
+                       [&](const dpx::FetchBlock&, std::span<uint8_t> data) { n_fetched += data.size(); });
+  }
+  auto elapsed_us = timer.elapsed_us();
+  INFO("fetch {} bytes of {} partitions in {}us, {:.2f} MB/s, decoded {} bytes", n_fetched, partition_ids.size(),
+       elapsed_us, static_cast<double>(n_fetched) / elapsed_us, n_decoded);
+
+  check_oversized_fetch(t, c.stat({0})[0]);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  dpx::ConnectionHolder<dpx::Backend::TCP> c(dpx::ConnectionParam<dpx::Backend::TCP>{
+      .passive = args::get(side) == dpx::Side::ServerSide,
+      .remote_ip = args::get(remote_ip),
+      .local_ip = args::get(local_ip),
+      .remote_port = args::get(remote_port),
+      .local_port = args::get(local_port),
+  });
+  FetchTransport t(c, dpx::Config{.queue_depth = 4, .max_rpc_msg_size = 4096});
+  c.establish_connections();
+  if (args::get(side) == dpx::Side::ServerSide) {
+    run_server(t);
+  } else {
+    run_client(t);
+  }
+  c.terminate_connections();
+  return 0;
+}
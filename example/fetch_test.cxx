@@ -0,0 +1,177 @@
+#include <args.hxx>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/fetch_service.hxx"
+#include "native/spill_block.hxx"
+#include "util/fatal.hxx"
+#include "util/literal.hxx"
+
+using namespace dpx::literal;
+
+args::ArgumentParser p("DPX Fetch Service Test, spill partitions then fetch them back over TCP in one process");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<std::string> work_dir(p, "work dir", "directory for the spilled partitions", {"work_dir"},
+                                      "/tmp/dpx_fetch_test");
+args::ValueFlag<uint16_t> port(p, "port", "loopback port of the server", {"port"}, 10086);
+args::ValueFlag<uint32_t> n_partition(p, "n partition", "n partition", {"n_partition"}, 8);
+args::ValueFlag<uint32_t> n_block(p, "n block", "max n spill block per partition", {"n_block"}, 32);
+args::ValueFlag<uint32_t> block_size(p, "block size", "max spill block size, in KB", {"block_size"}, 16);
+args::ValueFlag<uint32_t> chunk_size(p, "chunk size", "fetch chunk size of the server, in KB", {"chunk_size"}, 64);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+using FetchTransport = dpx::FetchTransport<dpx::Backend::TCP>;
+
+struct Partition {
+  std::vector<uint8_t> data;      // what is spilled, concatenated
+  std::vector<uint8_t> file;      // what is on disk
+  size_t first_block_offset = 0;  // of the stored data in the file
+};
+
+// partitions as the spill workers write them, with the file header and one block per buffer, some larger than the
+// chunk size of the server and some smaller
+std::vector<Partition> spill_partitions() {
+  std::filesystem::create_directories(args::get(work_dir));
+  std::mt19937_64 g(42);
+  std::vector<Partition> partitions(args::get(n_partition));
+  for (auto i = 0uz; i < partitions.size(); i++) {
+    auto& [data, file, first_block_offset] = partitions[i];
+    auto& codec = dpx::codec_of(i % 2 == 0 ? dpx::CodecType::LZ : dpx::CodecType::Raw);
+    file.insert(file.end(), reinterpret_cast<const uint8_t*>(&dpx::partition_file_magic),
+                reinterpret_cast<const uint8_t*>(&dpx::partition_file_magic) + dpx::partition_file_header_size);
+    first_block_offset = file.size() + sizeof(dpx::SpillBlockHeader);
+    dpx::SpillBlock block;
+    for (auto n = 1 + g() % args::get(n_block); n > 0; n--) {
+      // half compressible
+      std::vector<uint8_t> buffer(1 + g() % (args::get(block_size) * 1_KB));
+      for (auto j = 0uz; j < buffer.size(); j++) {
+        buffer[j] = j % 2 == 0 ? static_cast<uint8_t>(g()) : static_cast<uint8_t>(j);
+      }
+      data.insert(data.end(), buffer.begin(), buffer.end());
+      block.encode(codec, buffer.data(), buffer.size());
+      for (auto& v : block.iov) {
+        file.insert(file.end(), reinterpret_cast<const uint8_t*>(v.iov_base),
+                    reinterpret_cast<const uint8_t*>(v.iov_base) + v.iov_len);
+      }
+    }
+    std::ofstream f(std::format("{}/p{}", args::get(work_dir), i), std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(file.data()), file.size());
+  }
+  return partitions;
+}
+
+void run_server(std::atomic_bool& running) {
+  dpx::ConnectionHolder<dpx::Backend::TCP> c(dpx::ConnectionParam<dpx::Backend::TCP>{
+      .passive = true,
+      .local_ip = "127.0.0.1",
+      .local_port = args::get(port),
+  });
+  FetchTransport t(c, dpx::Config{.queue_depth = 4, .max_rpc_msg_size = 4096});
+  c.establish_connections();
+  {
+    dpx::TransportGuard g(t);
+    dpx::FetchServer<dpx::Backend::TCP> s(t, std::filesystem::absolute(args::get(work_dir)).string(),
+                                          args::get(n_partition), 2, args::get(chunk_size) * 1_KB, running);
+    s.serve();
+  }
+  c.terminate_connections();
+}
+
+void check_fetched(FetchTransport& t, const std::vector<Partition>& partitions,
+                   const std::vector<uint32_t>& partition_ids) {
+  // larger than the chunk size of the server, the client must still cap its batches with the latter
+  dpx::naive::Buffers landing_bufs(1, 4 * args::get(chunk_size) * 1_KB);
+  dpx::FetchClient<dpx::Backend::TCP> c(t, landing_bufs[0]);
+
+  std::vector<std::vector<uint8_t>> fetched(partitions.size());
+  c.fetch_partitions(partition_ids, [&](const dpx::FetchBlock& block, std::span<uint8_t> data) {
+    auto& f = fetched[block.partition_id];
+    if (f.size() != block.offset) {
+      die("Partition {} is fetched out of order at {}, expect {}", block.partition_id, block.offset, f.size());
+    }
+    f.insert(f.end(), data.begin(), data.end());
+  });
+  for (auto i = 0uz; i < partitions.size(); i++) {
+    if (fetched[i] != partitions[i].file) {
+      die("Partition {} is fetched with {} bytes different from the spilled {} bytes", i, fetched[i].size(),
+          partitions[i].file.size());
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> decoded(partitions.size());
+  c.fetch_decoded(partition_ids, true, [&](uint32_t partition_id, std::span<const uint8_t> data) {
+    decoded[partition_id].insert(decoded[partition_id].end(), data.begin(), data.end());
+  });
+  for (auto i = 0uz; i < partitions.size(); i++) {
+    if (decoded[i] != partitions[i].data) {
+      die("Partition {} is decoded with {} bytes different from the spilled {} bytes", i, decoded[i].size(),
+          partitions[i].data.size());
+    }
+  }
+  INFO("fetch and decode {} partitions", partitions.size());
+
+  // a flipped bit in the stored data of a block must fail its crc on the client
+  auto corrupted = partitions.size() - 1;
+  auto path = std::format("{}/p{}", args::get(work_dir), corrupted);
+  std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+  auto byte = static_cast<char>(partitions[corrupted].file[partitions[corrupted].first_block_offset] ^ 0x10);
+  f.seekp(partitions[corrupted].first_block_offset);
+  f.write(&byte, 1);
+  f.close();
+  auto rejected = false;
+  try {
+    c.fetch_decoded({static_cast<uint32_t>(corrupted)}, true, [](uint32_t, std::span<const uint8_t>) {});
+  } catch (std::runtime_error& e) {
+    INFO("corrupted partition rejected: {}", e.what());
+    rejected = true;
+  }
+  if (!rejected) {
+    die("Partition {} with a flipped bit is decoded", corrupted);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  auto partitions = spill_partitions();
+  std::vector<uint32_t> partition_ids(partitions.size());
+  std::iota(partition_ids.begin(), partition_ids.end(), 0);
+
+  std::atomic_bool running = true;
+  std::thread server([&running]() { run_server(running); });
+
+  dpx::ConnectionHolder<dpx::Backend::TCP> c(dpx::ConnectionParam<dpx::Backend::TCP>{
+      .passive = false,
+      .remote_ip = "127.0.0.1",
+      .remote_port = args::get(port),
+  });
+  FetchTransport t(c, dpx::Config{.queue_depth = 4, .max_rpc_msg_size = 4096});
+  c.establish_connections();
+  {
+    dpx::TransportGuard g(t);
+    check_fetched(t, partitions, partition_ids);
+  }
+  running = false;
+  c.terminate_connections();
+  server.join();
+  std::filesystem::remove_all(args::get(work_dir));
+  INFO("fetch test passed");
+  return 0;
+}
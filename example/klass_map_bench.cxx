@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <args.hxx>
+#include <random>
+#include <vector>
+
+#include "sd/common/klass_map.h"
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+args::ArgumentParser p("DPX Klass Map Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<uint32_t> n_class(p, "n class", "n registered class", {"n_class"}, 64);
+args::ValueFlag<uint32_t> n_lookup(p, "n lookup", "n lookup per round", {"n_lookup"}, 1 << 20);
+args::ValueFlag<uint32_t> n_site(p, "n site", "n call site, each sees one class mostly", {"n_site"}, 8);
+args::ValueFlag<uint32_t> miss_rate(p, "miss rate", "percent of lookups of another class", {"miss_rate"}, 5);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+struct Entry {
+  uint32_t klass_cptr;
+  class_id_t id;
+};
+
+// what the resolver and the kernel did before, a binary search over entries sorted by klass
+class_id_t sorted_lookup(const std::vector<Entry>& sorted, uint32_t klass_cptr) {
+  auto iter = std::ranges::lower_bound(sorted, klass_cptr, std::less<uint32_t>(), &Entry::klass_cptr);
+  return iter != sorted.end() && iter->klass_cptr == klass_cptr ? iter->id : UNREGISTERED_CLASS_ID;
+}
+
+template <typename Fn>
+void run(const char* name, const std::vector<uint32_t>& sites, const std::vector<uint32_t>& cptrs, Fn&& fn) {
+  dpx::Timer t;
+  uint64_t sum = 0;
+  for (auto i = 0uz; i < cptrs.size(); i++) {
+    sum += fn(sites[i], cptrs[i]);
+  }
+  auto elapsed_ns = t.elapsed_ns();
+  INFO("{}: {} lookups, {:.2f} ns/lookup, checksum {}", name, cptrs.size(),
+       static_cast<double>(elapsed_ns) / cptrs.size(), sum);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  std::mt19937 g(42);
+
+  // compressed klass pointers are 8 bytes aligned offsets in the class space
+  std::vector<Entry> entries;
+  while (entries.size() < args::get(n_class)) {
+    auto cptr = (g() % (1u << 24)) << 3;
+    if (cptr == KLASS_MAP_EMPTY ||
+        std::ranges::find(entries, cptr, &Entry::klass_cptr) != entries.end()) {
+      continue;
+    }
+    entries.push_back({cptr, static_cast<class_id_t>(MIN_CLASS_ID + entries.size())});
+  }
+  auto sorted = entries;
+  std::ranges::sort(sorted, std::less<uint32_t>(), &Entry::klass_cptr);
+
+  auto capacity = klass_map_capacity_for(entries.size());
+  std::vector<uint64_t> buffer((klass_map_size(capacity) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  auto m = (klass_map_t*)buffer.data();
+  klass_map_init(m, capacity);
+  for (auto& e : entries) {
+    if (!klass_map_insert(m, e.klass_cptr, e.id)) {
+      die("Fail to insert {:X}", e.klass_cptr);
+    }
+  }
+  if (klass_map_insert(m, entries[0].klass_cptr, entries[0].id)) {
+    die("Insert duplicated {:X}", entries[0].klass_cptr);
+  }
+
+  // check against the sorted entries, including absent klasses
+  for (auto i = 0; i < 100000; i++) {
+    auto cptr = (g() % (1u << 24)) << 3;
+    if (cptr == KLASS_MAP_EMPTY) {
+      continue;
+    }
+    if (klass_map_lookup(m, cptr) != sorted_lookup(sorted, cptr)) {
+      die("Mismatched lookup of {:X}", cptr);
+    }
+  }
+  std::vector<klass_cache_t> caches(args::get(n_site), KLASS_CACHE_EMPTY);
+  for (auto& e : entries) {
+    if (klass_map_lookup_cached(m, &caches[0], e.klass_cptr) != e.id ||
+        klass_map_lookup_cached(m, &caches[0], e.klass_cptr) != e.id) {
+      die("Mismatched cached lookup of {:X}", e.klass_cptr);
+    }
+  }
+  std::ranges::fill(caches, KLASS_CACHE_EMPTY);
+
+  // each call site sees its own class, except for a few polymorphic hits
+  std::vector<uint32_t> site_klass(args::get(n_site));
+  for (auto& k : site_klass) {
+    k = entries[g() % entries.size()].klass_cptr;
+  }
+  std::vector<uint32_t> sites(args::get(n_lookup));
+  std::vector<uint32_t> cptrs(args::get(n_lookup));
+  for (auto i = 0uz; i < cptrs.size(); i++) {
+    sites[i] = g() % site_klass.size();
+    cptrs[i] = g() % 100 < args::get(miss_rate) ? entries[g() % entries.size()].klass_cptr : site_klass[sites[i]];
+  }
+
+  run("sorted", sites, cptrs, [&](uint32_t, uint32_t cptr) { return sorted_lookup(sorted, cptr); });
+  run("hashed", sites, cptrs, [&](uint32_t, uint32_t cptr) { return klass_map_lookup(m, cptr); });
+  run("cached", sites, cptrs,
+      [&](uint32_t site, uint32_t cptr) { return klass_map_lookup_cached(m, &caches[site], cptr); });
+  return 0;
+}
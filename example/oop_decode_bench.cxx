@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <args.hxx>
+#include <bit>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "sd/native/oop_decode.hxx"
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+args::ArgumentParser p("DPX Compressed Oop Decode Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<uint32_t> n_elem(p, "n elem", "n element of the synthetic array", {"n_elem"}, 1 << 20);
+args::ValueFlag<uint32_t> n_round(p, "n round", "n round", {"n_round"}, 100);
+args::ValueFlag<uint32_t> null_rate(p, "null rate", "percent of null elements", {"null_rate"}, 10);
+args::ValueFlag<uint32_t> shift(p, "shift", "heap compress shift", {"shift"}, 3);
+args::ValueFlag<uint64_t> base(p, "base", "heap base, 0 for zero based", {"base"}, 0);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+template <typename Fn>
+void run(const char* name, const std::vector<uint32_t>& cptrs, std::vector<uint64_t>& out, Fn&& fn) {
+  dpx::Timer t;
+  uint64_t n_null = 0;
+  for (auto r = 0uz; r < args::get(n_round); r++) {
+    for (auto i = 0uz; i < cptrs.size(); i += dpx::sd::MAX_OOP_RUN) {
+      auto n = std::min<uint32_t>(cptrs.size() - i, dpx::sd::MAX_OOP_RUN);
+      n_null += std::popcount(fn(cptrs.data() + i, n, out.data() + i));
+    }
+  }
+  auto elapsed_ns = t.elapsed_ns();
+  auto n = cptrs.size() * args::get(n_round);
+  INFO("{}: {} oops, {} nulls, {:.3f} ns/oop", name, n, n_null, static_cast<double>(elapsed_ns) / n);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  dpx::sd::OopFormat f{.base = args::get(base), .shift = args::get(shift)};
+  std::mt19937 g(42);
+  std::vector<uint32_t> cptrs(args::get(n_elem));
+  for (auto& c : cptrs) {
+    c = g() % 100 < args::get(null_rate) ? 0 : g() | 1;
+  }
+
+  std::vector<uint64_t> expected(cptrs.size());
+  std::vector<uint64_t> got(cptrs.size());
+  for (auto i = 0uz; i < cptrs.size(); i += dpx::sd::MAX_OOP_RUN) {
+    auto n = std::min<uint32_t>(cptrs.size() - i, dpx::sd::MAX_OOP_RUN);
+    auto m1 = dpx::sd::detail::decode_oops_sw(f, cptrs.data() + i, n, expected.data() + i);
+    auto m2 = dpx::sd::decode_oops(f, cptrs.data() + i, n, got.data() + i);
+    if (m1 != m2 || memcmp(expected.data() + i, got.data() + i, n * sizeof(uint64_t)) != 0) {
+      die("Mismatched decode at {}", i);
+    }
+  }
+  INFO("simd: {}", dpx::sd::detail::decode_oops_hw_supported());
+
+  run("scalar", cptrs, got,
+      [&](const uint32_t* c, uint32_t n, uint64_t* out) { return dpx::sd::detail::decode_oops_sw(f, c, n, out); });
+  run("dispatch", cptrs, got,
+      [&](const uint32_t* c, uint32_t n, uint64_t* out) { return dpx::sd::decode_oops(f, c, n, out); });
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <args.hxx>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "native/spill_block.hxx"
+#include "util/literal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+using namespace dpx::literal;
+
+args::ArgumentParser p("DPX Spill Block Codec Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<uint32_t> block_size(p, "block size", "block size, in MB", {"block_size"}, 32);
+args::ValueFlag<uint32_t> n_round(p, "n round", "n round", {"n_round"}, 10);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+std::vector<uint8_t> random_data(size_t size) {
+  std::mt19937_64 g(42);
+  std::vector<uint8_t> data(size);
+  for (auto& b : data) {
+    b = g();
+  }
+  return data;
+}
+
+// text records that look like the rows we shuffle, e.g. "user_1234,2024-01-02,GET /index.html,200,5120"
+std::vector<uint8_t> text_data(size_t size) {
+  constexpr static const char* methods[] = {"GET", "POST", "PUT", "DELETE"};
+  constexpr static const char* paths[] = {"/index.html", "/api/v1/items", "/static/app.js", "/login", "/search?q=dpu"};
+  constexpr static int codes[] = {200, 200, 200, 304, 404, 500};
+  std::mt19937_64 g(42);
+  std::vector<uint8_t> data;
+  data.reserve(size);
+  while (data.size() < size) {
+    auto row = std::format("user_{},2024-{:02}-{:02},{} {},{},{}\n", g() % 100000, 1 + g() % 12, 1 + g() % 28,
+                           methods[g() % std::size(methods)], paths[g() % std::size(paths)],
+                           codes[g() % std::size(codes)], g() % 65536);
+    data.insert(data.end(), row.begin(), row.end());
+  }
+  data.resize(size);
+  return data;
+}
+
+void run(const std::string& name, const dpx::Codec& codec, const std::vector<uint8_t>& data) {
+  dpx::SpillBlock block;
+  std::vector<uint8_t> stored;
+  std::vector<uint8_t> decoded;
+  uint64_t encode_us = 0;
+  uint64_t decode_us = 0;
+  for (auto i = 0uz; i < args::get(n_round); i++) {
+    dpx::Timer t;
+    block.encode(codec, const_cast<uint8_t*>(data.data()), data.size());
+    encode_us += t.elapsed_us();
+
+    stored.clear();
+    for (auto& v : block.iov) {
+      auto b = reinterpret_cast<uint8_t*>(v.iov_base);
+      stored.insert(stored.end(), b, b + v.iov_len);
+    }
+
+    t.reset();
+    auto n = dpx::decode_spill_block(stored, decoded);
+    decode_us += t.elapsed_us();
+    if (n != stored.size() || decoded != data) {
+      die("Round trip mismatch of {} with {}", name, static_cast<uint8_t>(codec.type()));
+    }
+  }
+  auto total = static_cast<double>(data.size()) * args::get(n_round);
+  INFO("{} codec {}: ratio {:.2f}, encode {:.2f} MB/s, decode {:.2f} MB/s", name, static_cast<uint8_t>(codec.type()),
+       static_cast<double>(data.size()) / block.size(), total / encode_us, total / decode_us);
+}
+
+// crc32c should be close to a plain memcpy of the same block
+void run_crc(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> copy(data.size());
+  uint64_t copy_us = 0;
+  uint64_t crc_us = 0;
+  uint32_t crc = 0;
+  for (auto i = 0uz; i < args::get(n_round); i++) {
+    dpx::Timer t;
+    memcpy(copy.data(), data.data(), data.size());
+    copy_us += t.elapsed_us();
+    t.reset();
+    crc ^= dpx::crc32c(data.data(), data.size());
+    crc_us += t.elapsed_us();
+  }
+  auto total = static_cast<double>(data.size()) * args::get(n_round);
+  INFO("crc32c {:.2f} MB/s, memcpy {:.2f} MB/s, hw: {} ({:#x})", total / crc_us, total / copy_us,
+       dpx::detail::crc32c_hw_supported(), crc);
+}
+
+// flip one bit of each stored block and make sure the reader notices
+void run_bit_flip(const dpx::Codec& codec, const std::vector<uint8_t>& data) {
+  std::mt19937_64 g(42);
+  dpx::SpillBlock block;
+  block.encode(codec, const_cast<uint8_t*>(data.data()), data.size());
+  std::vector<uint8_t> stored;
+  for (auto& v : block.iov) {
+    auto b = reinterpret_cast<uint8_t*>(v.iov_base);
+    stored.insert(stored.end(), b, b + v.iov_len);
+  }
+  std::vector<uint8_t> decoded;
+  auto n_detected = 0uz;
+  for (auto i = 0uz; i < args::get(n_round); i++) {
+    auto bit = g() % ((stored.size() - sizeof(dpx::SpillBlockHeader)) * 8);
+    auto& b = stored[sizeof(dpx::SpillBlockHeader) + bit / 8];
+    b ^= 1 << (bit % 8);
+    try {
+      dpx::decode_spill_block(stored, decoded);
+    } catch (std::runtime_error& e) {
+      n_detected++;
+    }
+    b ^= 1 << (bit % 8);
+  }
+  if (n_detected != args::get(n_round)) {
+    die("Only {} of {} bit flips detected", n_detected, args::get(n_round));
+  }
+  INFO("codec {}: {} bit flips detected", static_cast<uint8_t>(codec.type()), n_detected);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  auto size = args::get(block_size) * 1_MB;
+  auto random = random_data(size);
+  auto text = text_data(size);
+  for (auto type : {dpx::CodecType::Raw, dpx::CodecType::LZ}) {
+    auto& codec = dpx::codec_of(type);
+    run("random", codec, random);
+    run("text", codec, text);
+    run_bit_flip(codec, text);
+  }
+  run_crc(random);
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <args.hxx>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "native/spill_reader.hxx"
+#include "util/literal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+using namespace dpx::literal;
+
+args::ArgumentParser p("DPX Spill Reader Benchmark");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<std::string> work_dir(p, "work dir", "directory for the generated segments", {"work_dir"},
+                                      "/tmp/dpx_spill_reader");
+args::ValueFlag<uint32_t> n_segment(p, "n segment", "n segment of the partition", {"n_segment"}, 8);
+args::ValueFlag<uint32_t> n_record(p, "n record", "n record per segment", {"n_record"}, 1000000);
+args::ValueFlag<uint32_t> value_size(p, "value size", "value size, in bytes", {"value_size"}, 64);
+args::ValueFlag<uint32_t> block_size(p, "block size", "partition buffer size, in KB", {"block_size"}, 1024);
+args::ValueFlag<uint32_t> chunk_size(p, "chunk size", "read-ahead chunk size, in KB", {"chunk_size"}, 1024);
+args::ValueFlag<uint32_t> n_chunk(p, "n chunk", "n read-ahead chunk per segment", {"n_chunk"}, 2);
+args::Flag raw(p, "raw", "spill with the raw codec", {"raw"}, false);
+args::Flag header(p, "header", "start the segments with the file header", {"header"}, false);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+// sorted segments as the spill workers write them, one spill block per partition buffer
+std::vector<std::string> generate_segments() {
+  std::filesystem::create_directories(args::get(work_dir));
+  std::mt19937_64 g(42);
+  std::vector<std::string> paths;
+  auto& codec = dpx::codec_of(args::get(raw) ? dpx::CodecType::Raw : dpx::CodecType::LZ);
+  for (auto s = 0uz; s < args::get(n_segment); s++) {
+    std::vector<uint64_t> keys(args::get(n_record));
+    for (auto& k : keys) {
+      k = g() % (keys.size() * args::get(n_segment));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    auto path = std::format("{}/seg{}", args::get(work_dir), s);
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (args::get(header)) {
+      f.write(reinterpret_cast<const char*>(&dpx::partition_file_magic), sizeof(dpx::partition_file_magic));
+    }
+    std::vector<uint8_t> buffer;
+    dpx::SpillBlock block;
+    auto flush = [&]() {
+      if (buffer.empty()) {
+        return;
+      }
+      block.encode(codec, buffer.data(), buffer.size());
+      for (auto& v : block.iov) {
+        f.write(reinterpret_cast<const char*>(v.iov_base), v.iov_len);
+      }
+      buffer.clear();
+    };
+    std::string value(args::get(value_size), 'v');
+    for (auto k : keys) {
+      dpx::RecordHeader h{.key_length = sizeof(uint64_t), .value_length = static_cast<uint32_t>(value.size())};
+      if (buffer.size() + sizeof(h) + h.key_length + h.value_length > args::get(block_size) * 1_KB) {
+        flush();
+      }
+      auto be_key = __builtin_bswap64(k);
+      auto append = [&](const void* data, size_t length) {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + length);
+      };
+      append(&h, sizeof(h));
+      append(&be_key, sizeof(be_key));
+      append(value.data(), value.size());
+    }
+    flush();
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+void run(const std::vector<std::string>& paths, dpx::PartitionReader::Mode mode) {
+  dpx::Timer t;
+  dpx::PartitionReader r(paths, mode, args::get(header), args::get(chunk_size) * 1_KB, args::get(n_chunk));
+  auto n = 0uz;
+  auto n_bytes = 0uz;
+  std::vector<uint8_t> last_key;
+  while (r.next()) {
+    auto key = r.key();
+    if (mode == dpx::PartitionReader::Mode::Merge && std::ranges::lexicographical_compare(key, last_key)) {
+      die("Merged stream out of order at record {}", n);
+    }
+    last_key.assign(key.begin(), key.end());
+    n++;
+    n_bytes += sizeof(dpx::RecordHeader) + key.size() + r.value().size();
+  }
+  auto elapsed_us = t.elapsed_us();
+  if (n != static_cast<size_t>(args::get(n_segment)) * args::get(n_record)) {
+    die("Expect {} records, got {}", static_cast<size_t>(args::get(n_segment)) * args::get(n_record), n);
+  }
+  INFO("{}: {} records in {}us, {:.2f} Mrec/s, {:.2f} MB/s",
+       mode == dpx::PartitionReader::Mode::Merge ? "merge" : "concat", n, elapsed_us,
+       static_cast<double>(n) / elapsed_us, static_cast<double>(n_bytes) / elapsed_us);
+}
+
+// a copy of the first segment with one bit flipped in the stored data of its first block must be rejected
+void check_corrupted_segment(const std::vector<std::string>& paths) {
+  auto path = std::format("{}/corrupted", args::get(work_dir));
+  std::filesystem::copy_file(paths[0], path, std::filesystem::copy_options::overwrite_existing);
+  {
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    auto at = (args::get(header) ? dpx::partition_file_header_size : 0) + sizeof(dpx::SpillBlockHeader);
+    f.seekg(at);
+    char c;
+    f.get(c);
+    f.seekp(at);
+    f.put(static_cast<char>(c ^ 0x10));
+  }
+  auto rejected = false;
+  try {
+    dpx::PartitionReader r({path}, dpx::PartitionReader::Mode::Concat, args::get(header),
+                           args::get(chunk_size) * 1_KB, args::get(n_chunk));
+    while (r.next()) {
+    }
+  } catch (std::runtime_error& e) {
+    INFO("corrupted segment rejected: {}", e.what());
+    rejected = true;
+  }
+  if (!rejected) {
+    die("Segment with a flipped bit is not rejected");
+  }
+  std::filesystem::remove(path);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  auto paths = generate_segments();
+  run(paths, dpx::PartitionReader::Mode::Concat);
+  run(paths, dpx::PartitionReader::Mode::Merge);
+  check_corrupted_segment(paths);
+  std::filesystem::remove_all(args::get(work_dir));
+  return 0;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "util/fatal.hxx"
+
+namespace dpx {
+
+enum class CodecType : uint8_t {
+  Raw = 0,
+  LZ = 1,
+};
+
+class Codec {
+ public:
+  virtual ~Codec() = default;
+
+  virtual CodecType type() const = 0;
+  virtual size_t max_compressed_size(size_t length) const = 0;
+  // return 0 if dst is too small
+  virtual size_t compress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const = 0;
+  // return the decompressed length, die on malformed input
+  virtual size_t decompress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const = 0;
+};
+
+class RawCodec : public Codec {
+ public:
+  CodecType type() const override { return CodecType::Raw; }
+  size_t max_compressed_size(size_t length) const override { return length; }
+  size_t compress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const override {
+    if (length > capacity) {
+      return 0;
+    }
+    memcpy(dst, src, length);
+    return length;
+  }
+  size_t decompress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const override {
+    if (length > capacity) {
+      die("Raw block with length {} exceeds capacity {}", length, capacity);
+    }
+    memcpy(dst, src, length);
+    return length;
+  }
+};
+
+/*
+ * LZ77 block codec in the LZ4 block format:
+ *
+ * | token | literal length ext | literals | offset (u16) | match length ext | ... | token | literals |
+ *
+ * high 4 bits of the token is the literal length, low 4 bits is the match length minus 4, 15 means more bytes
+ * follow, each adds up to 255. The last sequence only has literals.
+ */
+class LZCodec : public Codec {
+  constexpr static size_t min_match = 4;
+  constexpr static size_t hash_log = 12;
+  constexpr static size_t last_literals = 5;
+  constexpr static size_t mf_limit = 12;
+  constexpr static size_t max_offset = 65535;
+
+ public:
+  CodecType type() const override { return CodecType::LZ; }
+
+  size_t max_compressed_size(size_t length) const override { return length + length / 255 + 16; }
+
+  size_t compress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const override {
+    if (capacity < max_compressed_size(length)) {
+      return 0;
+    }
+    std::array<uint32_t, 1 << hash_log> table{};
+    auto ip = src;
+    auto anchor = src;
+    auto end = src + length;
+    auto op = dst;
+    if (length > mf_limit) {
+      auto match_limit = end - last_literals;
+      auto ip_limit = end - mf_limit;
+      ip++;
+      while (ip < ip_limit) {
+        auto& slot = table[hash(ip)];
+        auto ref = src + slot;
+        slot = ip - src;
+        if (ref >= ip || ip - ref > static_cast<ptrdiff_t>(max_offset) || read32(ref) != read32(ip)) {
+          // skip faster over incompressible data
+          ip += 1 + ((ip - anchor) >> 6);
+          continue;
+        }
+        while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+          ip--;
+          ref--;
+        }
+        auto mp = ip + min_match;
+        auto mr = ref + min_match;
+        while (mp < match_limit && *mp == *mr) {
+          mp++;
+          mr++;
+        }
+        op = put_sequence(op, anchor, ip - anchor, ip - ref, mp - ip - min_match);
+        ip = mp;
+        anchor = ip;
+        if (ip < ip_limit) {
+          table[hash(ip - 2)] = ip - 2 - src;
+        }
+      }
+    }
+    op = put_literals(op, anchor, end - anchor);
+    return op - dst;
+  }
+
+  size_t decompress(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) const override {
+    auto ip = src;
+    auto end = src + length;
+    auto op = dst;
+    auto oend = dst + capacity;
+    while (ip < end) {
+      auto token = *ip++;
+      size_t n_literal = token >> 4;
+      if (n_literal == 15) {
+        n_literal += get_length(ip, end);
+      }
+      if (n_literal > static_cast<size_t>(end - ip) || n_literal > static_cast<size_t>(oend - op)) {
+        die("Corrupted LZ block, literals overflow at {}", ip - src);
+      }
+      memcpy(op, ip, n_literal);
+      ip += n_literal;
+      op += n_literal;
+      if (ip == end) {
+        break;
+      }
+      if (end - ip < 2) {
+        die("Corrupted LZ block, truncated offset at {}", ip - src);
+      }
+      size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+        die("Corrupted LZ block, invalid offset {} at {}", offset, ip - src);
+      }
+      size_t n_match = token & 15;
+      if (n_match == 15) {
+        n_match += get_length(ip, end);
+      }
+      n_match += min_match;
+      if (n_match > static_cast<size_t>(oend - op)) {
+        die("Corrupted LZ block, match overflow at {}", ip - src);
+      }
+      auto match = op - offset;
+      if (offset >= n_match) {
+        memcpy(op, match, n_match);
+        op += n_match;
+      } else {
+        // overlapped, repeat the pattern
+        for (auto i = 0uz; i < n_match; i++) {
+          *op++ = *match++;
+        }
+      }
+    }
+    return op - dst;
+  }
+
+ private:
+  static uint32_t read32(const uint8_t* p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(uint32_t));
+    return x;
+  }
+
+  static uint32_t hash(const uint8_t* p) { return (read32(p) * 2654435761U) >> (32 - hash_log); }
+
+  static uint8_t* put_length(uint8_t* op, size_t n) {
+    while (n >= 255) {
+      *op++ = 255;
+      n -= 255;
+    }
+    *op++ = n;
+    return op;
+  }
+
+  static size_t get_length(const uint8_t*& ip, const uint8_t* end) {
+    size_t n = 0;
+    uint8_t b = 0;
+    do {
+      if (ip == end) {
+        die("Corrupted LZ block, truncated length");
+      }
+      b = *ip++;
+      n += b;
+    } while (b == 255);
+    return n;
+  }
+
+  static uint8_t* put_sequence(uint8_t* op, const uint8_t* literals, size_t n_literal, size_t offset, size_t n_match) {
+    auto token = op++;
+    *token = (std::min<size_t>(n_literal, 15) << 4) | std::min<size_t>(n_match, 15);
+    if (n_literal >= 15) {
+      op = put_length(op, n_literal - 15);
+    }
+    memcpy(op, literals, n_literal);
+    op += n_literal;
+    *op++ = offset & 0xff;
+    *op++ = offset >> 8;
+    if (n_match >= 15) {
+      op = put_length(op, n_match - 15);
+    }
+    return op;
+  }
+
+  static uint8_t* put_literals(uint8_t* op, const uint8_t* literals, size_t n_literal) {
+    *op++ = std::min<size_t>(n_literal, 15) << 4;
+    if (n_literal >= 15) {
+      op = put_length(op, n_literal - 15);
+    }
+    memcpy(op, literals, n_literal);
+    return op + n_literal;
+  }
+};
+
+inline const Codec& codec_of(CodecType type) {
+  static RawCodec raw;
+  static LZCodec lz;
+  switch (type) {
+    case CodecType::Raw:
+      return raw;
+    case CodecType::LZ:
+      return lz;
+  }
+  die("Unknown codec {}", static_cast<uint8_t>(type));
+}
+
+}  // namespace dpx
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "native/offload.hxx"
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/noncopyable.hxx"
+
+namespace dpx {
+
+// NOTICE: the values are sent in RecordFormat and mirrored by pdsl.dpx.PipelineTransEnv, keep them in sync
+enum class CombineOp : uint8_t {
+  Sum,
+  Count,
+  Min,
+  Max,
+};
+
+enum class CombineValueType : uint8_t {
+  Int32,
+  Int64,
+  Float32,
+  Float64,
+};
+
+constexpr bool combine_supported(CombineOp op, CombineValueType t) {
+  if (op > CombineOp::Max || t > CombineValueType::Float64) {
+    return false;
+  }
+  return op != CombineOp::Count || t == CombineValueType::Int32 || t == CombineValueType::Int64;
+}
+
+constexpr size_t combine_value_width(CombineValueType t) {
+  switch (t) {
+    case CombineValueType::Int32:
+    case CombineValueType::Float32:
+      return 4;
+    case CombineValueType::Int64:
+    case CombineValueType::Float64:
+      return 8;
+  }
+  return 0;
+}
+
+/*
+ * Hash aggregation of framed records (| RecordHeader | key | value |) with equal keys inside one partition batch.
+ * Values are fixed-width little-endian numbers, Count ignores the incoming value and counts records.
+ *
+ * The table is bounded by max_entries. When it is full, the aggregated records are flushed in first-seen order and
+ * the table is reset, so one key may show up several times in the output of a large batch.
+ *
+ * Aggregation is done in place: the i-th flushed record is never larger than the record where its key was first
+ * seen and never written past it, so keys that are still referenced by the table are not overwritten.
+ *
+ * A PartitionBuffer is combined by the RecordFormat in its header, so one combiner serves buffers of any op and
+ * value type. Buffers that are not declared combinable, or whose records do not match the declaration, are passed
+ * through untouched.
+ */
+class Combiner : Noncopyable {
+  struct Entry {
+    uint32_t key_offset;
+    uint32_t key_length;
+    uint64_t acc;
+  };
+
+  struct Slot {
+    uint64_t hash;
+    uint32_t entry;  // index + 1, 0 is empty
+  };
+
+ public:
+  explicit Combiner(size_t max_entries_ = 4096) : max_entries(max_entries_) {
+    slots.resize(std::bit_ceil(max_entries * 2));
+    mask = slots.size() - 1;
+    entries.reserve(max_entries);
+  }
+  Combiner(CombineOp op_, CombineValueType type_, size_t max_entries_ = 4096) : Combiner(max_entries_) {
+    if (!reset(op_, type_)) {
+      die("Count only supports integer values");
+    }
+  }
+  ~Combiner() = default;
+
+  // return false if the buffer is passed through
+  bool combine(PartitionBuffer& buffer) {
+    auto& f = buffer.format();
+    if (!f.framed || !f.combinable) {
+      return false;
+    }
+    if (!reset(static_cast<CombineOp>(f.combine_op), static_cast<CombineValueType>(f.combine_type))) {
+      WARN("Pass through partition {}, unsupported combine op {} on value type {}", buffer.partition_id(),
+           f.combine_op, f.combine_type);
+      return false;
+    }
+    auto data = reinterpret_cast<uint8_t*>(buffer.actual_data());
+    // check the whole buffer first, as a bad record met halfway would leave it half combined
+    if (!well_formed(data, buffer.actual_size())) {
+      WARN("Pass through partition {}, records are not framed with {} byte values", buffer.partition_id(), width);
+      return false;
+    }
+    buffer.shrink(combine(data, buffer.actual_size()));
+    buffer.seal();
+    return true;
+  }
+
+  // return the length of the combined records
+  size_t combine(uint8_t* data, size_t length) {
+    auto r = 0uz;
+    auto w = 0uz;
+    while (r < length) {
+      if (length - r < sizeof(RecordHeader)) {
+        die("Truncated record header at {}, length: {}", r, length);
+      }
+      RecordHeader h;
+      memcpy(&h, data + r, sizeof(RecordHeader));
+      auto record_length = sizeof(RecordHeader) + h.key_length + h.value_length;
+      if (r + record_length > length) {
+        die("Truncated record at {}, length: {}", r, length);
+      }
+      if (h.value_length != width) {
+        die("Expected value width {}, got {}", width, h.value_length);
+      }
+      if (entries.size() == max_entries) {
+        w = flush(data, w);
+      }
+      auto key_offset = r + sizeof(RecordHeader);
+      fold(data, key_offset, h.key_length, data + key_offset + h.key_length);
+      r += record_length;
+    }
+    return flush(data, w);
+  }
+
+ private:
+  bool reset(CombineOp op_, CombineValueType type_) {
+    if (!combine_supported(op_, type_)) {
+      return false;
+    }
+    op = op_;
+    type = type_;
+    width = combine_value_width(type_);
+    return true;
+  }
+
+  bool well_formed(const uint8_t* data, size_t length) const {
+    auto r = 0uz;
+    while (r < length) {
+      if (length - r < sizeof(RecordHeader)) {
+        return false;
+      }
+      RecordHeader h;
+      memcpy(&h, data + r, sizeof(RecordHeader));
+      if (h.value_length != width || length - r - sizeof(RecordHeader) < (size_t)h.key_length + h.value_length) {
+        return false;
+      }
+      r += sizeof(RecordHeader) + h.key_length + h.value_length;
+    }
+    return true;
+  }
+
+  static uint64_t hash_key(const uint8_t* p, size_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+    while (n >= 8) {
+      uint64_t x;
+      memcpy(&x, p, 8);
+      h = (h ^ x) * 0xbf58476d1ce4e5b9ULL;
+      h ^= h >> 31;
+      p += 8;
+      n -= 8;
+    }
+    uint64_t x = 0;
+    memcpy(&x, p, n);
+    h = (h ^ x) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 29);
+  }
+
+  void fold(const uint8_t* data, size_t key_offset, uint32_t key_length, const uint8_t* value) {
+    auto h = hash_key(data + key_offset, key_length);
+    for (auto i = h & mask;; i = (i + 1) & mask) {
+      auto& s = slots[i];
+      if (s.entry == 0) {
+        s.hash = h;
+        s.entry = entries.size() + 1;
+        entries.push_back({
+            .key_offset = static_cast<uint32_t>(key_offset),
+            .key_length = key_length,
+            .acc = init(value),
+        });
+        return;
+      }
+      auto& e = entries[s.entry - 1];
+      if (s.hash == h && e.key_length == key_length &&
+          memcmp(data + e.key_offset, data + key_offset, key_length) == 0) {
+        e.acc = accumulate(e.acc, value);
+        return;
+      }
+    }
+  }
+
+  size_t flush(uint8_t* data, size_t w) {
+    for (auto& e : entries) {
+      RecordHeader h{.key_length = e.key_length, .value_length = static_cast<uint32_t>(width)};
+      memcpy(data + w, &h, sizeof(RecordHeader));
+      w += sizeof(RecordHeader);
+      memmove(data + w, data + e.key_offset, e.key_length);
+      w += e.key_length;
+      memcpy(data + w, &e.acc, width);
+      w += width;
+    }
+    entries.clear();
+    std::fill(slots.begin(), slots.end(), Slot{});
+    return w;
+  }
+
+  uint64_t init(const uint8_t* value) const {
+    if (op == CombineOp::Count) {
+      return type == CombineValueType::Int32 ? store<int32_t>(1) : store<int64_t>(1);
+    }
+    uint64_t acc = 0;
+    memcpy(&acc, value, width);
+    return acc;
+  }
+
+  uint64_t accumulate(uint64_t acc, const uint8_t* value) const {
+    switch (type) {
+      case CombineValueType::Int32:
+        return accumulate<int32_t>(acc, value);
+      case CombineValueType::Int64:
+        return accumulate<int64_t>(acc, value);
+      case CombineValueType::Float32:
+        return accumulate<float>(acc, value);
+      case CombineValueType::Float64:
+        return accumulate<double>(acc, value);
+    }
+    return acc;
+  }
+
+  template <typename T>
+  uint64_t accumulate(uint64_t acc, const uint8_t* value) const {
+    auto a = load<T>(acc);
+    T v;
+    memcpy(&v, value, sizeof(T));
+    switch (op) {
+      case CombineOp::Sum:
+        return store<T>(a + v);
+      case CombineOp::Count:
+        return store<T>(a + 1);
+      case CombineOp::Min:
+        return store<T>(v < a ? v : a);
+      case CombineOp::Max:
+        return store<T>(v > a ? v : a);
+    }
+    return acc;
+  }
+
+  template <typename T>
+  static T load(uint64_t acc) {
+    T v;
+    memcpy(&v, &acc, sizeof(T));
+    return v;
+  }
+
+  template <typename T>
+  static uint64_t store(T v) {
+    uint64_t acc = 0;
+    memcpy(&acc, &v, sizeof(T));
+    return acc;
+  }
+
+  CombineOp op = CombineOp::Sum;
+  CombineValueType type = CombineValueType::Int64;
+  size_t width = combine_value_width(CombineValueType::Int64);
+  size_t max_entries;
+  size_t mask = 0;
+  std::vector<Slot> slots;
+  std::vector<Entry> entries;
+};
+
+using CombineFn = std::function<void(PartitionBuffer&)>;
+
+}  // namespace dpx
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <functional>
+#include <unordered_map>
+
+#include "doca/buffer.hxx"
+#include "memory/naive_buffer.hxx"
+#include "native/spill_block.hxx"
+#include "trans/transport.hxx"
+
+namespace dpx {
+
+/*
+ * Fetch service for spilled partition files ({spill_dir}/p{i}).
+ *
+ * A reducer first stats the partitions it needs, then pulls segments of them with FetchRpc. Several segments are
+ * batched into one request, the server reads them with io_uring into one staging buffer from a bounded pool and
+ * pushes them back to the landing buffer of the reducer in one bulk write, in request order.
+ *
+ * TCP:  server writes the data on the bulk socket, client reads exactly the requested length, zeros if rejected.
+ * DOCA: client registers its landing buffer once, server writes into it before responding.
+ *
+ * NOTICE: one client must not have more than one outstanding fetch, or the bulk data of TCP interleaves.
+ */
+
+struct FetchBlock {
+  uint32_t partition_id;
+  uint64_t offset;
+  uint64_t length;
+};
+
+struct FetchRequest {
+  MemoryRegion dst;  // landing buffer of the reducer, unused by TCP
+  std::vector<FetchBlock> blocks;
+};
+
+struct FetchResponse {
+  int32_t status;                // 0 or -errno
+  std::vector<uint64_t> lengths;  // actual length of each block, shorter at the end of file
+};
+
+struct FetchStatRequest {
+  std::vector<uint32_t> partition_ids;
+};
+
+struct FetchStatResponse {
+  int32_t status;
+  std::vector<uint64_t> sizes;
+  uint64_t chunk_size;  // largest fetch the server accepts
+};
+
+struct FetchStatRpc : RpcBase<"FetchStat", FetchStatRequest, FetchStatResponse> {};
+struct FetchRpc : RpcBase<"Fetch", FetchRequest, FetchResponse> {};
+
+template <Backend b>
+using FetchTransport = Transport<b, FetchStatRpc, FetchRpc>;
+
+template <Backend b>
+class FetchServer : Noncopyable, Nonmovable {
+  using StagingBufferPool =
+      std::conditional_t<b == Backend::TCP, BufferPool<naive::Buffers>, BufferPool<doca::Buffers>>;
+  using StagingBuffer = typename StagingBufferPool::BufferType;
+
+  struct ReadBatch {
+    boost::fibers::promise<void> done;
+    size_t n_pending = 0;
+    std::vector<int64_t> results;
+  };
+
+  struct ReadTask {
+    ReadBatch* batch;
+    size_t idx;
+  };
+
+ public:
+  FetchServer(FetchTransport<b>& t_, std::string spill_dir_, size_t max_n_partition, size_t n_buffer,
+              size_t chunk_size_, std::atomic_bool& running_)
+    requires(b == Backend::TCP)
+      : t(t_), spill_dir(spill_dir_), chunk_size(chunk_size_), running(running_), bp(n_buffer, chunk_size_) {
+    init(max_n_partition);
+  }
+
+  FetchServer(FetchTransport<b>& t_, doca::Device& dev, std::string spill_dir_, size_t max_n_partition,
+              size_t n_buffer, size_t chunk_size_, std::atomic_bool& running_)
+    requires(b == Backend::DOCA_Comch || b == Backend::DOCA_RDMA)
+      : t(t_),
+        spill_dir(spill_dir_),
+        chunk_size(chunk_size_),
+        running(running_),
+        bp(dev, n_buffer, chunk_size_,
+           DOCA_ACCESS_FLAG_PCI_READ_WRITE | DOCA_ACCESS_FLAG_RDMA_READ | DOCA_ACCESS_FLAG_RDMA_WRITE) {
+    init(max_n_partition);
+  }
+
+  ~FetchServer() {
+    for (auto fd : fds) {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+    io_uring_queue_exit(&ring);
+  }
+
+  // NOTICE: must run on the thread attached to the transport
+  void serve(std::function<void(void)>&& cb = nullptr) {
+    auto serving = true;
+    auto io_poller = boost::fibers::fiber([this, &serving]() {
+      INFO("Fetch IO poller start");
+      progress_io(serving);
+      INFO("Fetch IO poller stop");
+    });
+    t.serve_until([this]() -> bool { return !running; }, std::move(cb));
+    serving = false;
+    io_poller.join();
+  }
+
+ private:
+  void init(size_t max_n_partition) {
+    fds.resize(max_n_partition, -1);
+    if (auto ec = io_uring_queue_init(256, &ring, 0); ec < 0) {
+      die("Fail to init ring, errno: {}", -ec);
+    }
+    t.template register_handler<FetchStatRpc>(
+        [this](const FetchStatRequest& req) -> FetchStatResponse { return handle_stat(req); });
+    t.template register_handler<FetchRpc>(
+        [this](const FetchRequest& req) -> FetchResponse { return handle_fetch(req); });
+  }
+
+  int open_partition_file(uint32_t partition_id) {
+    if (partition_id >= fds.size()) {
+      return -EINVAL;
+    }
+    auto& fd = fds[partition_id];
+    if (fd == -1) {
+      auto fname = std::format("{}/p{}", spill_dir, partition_id);
+      fd = open(fname.c_str(), O_RDONLY);
+      if (fd == -1) {
+        return -errno;
+      }
+      INFO("open {} for fetch", fname);
+    }
+    return fd;
+  }
+
+  FetchStatResponse handle_stat(const FetchStatRequest& req) {
+    FetchStatResponse resp{.status = 0, .sizes = {}, .chunk_size = chunk_size};
+    resp.sizes.reserve(req.partition_ids.size());
+    for (auto pid : req.partition_ids) {
+      struct stat st;
+      auto fd = open_partition_file(pid);
+      if (fd < 0) {
+        return {.status = fd, .sizes = {}, .chunk_size = chunk_size};
+      }
+      if (fstat(fd, &st) != 0) {
+        return {.status = -errno, .sizes = {}, .chunk_size = chunk_size};
+      }
+      resp.sizes.push_back(st.st_size);
+    }
+    return resp;
+  }
+
+  FetchResponse handle_fetch(const FetchRequest& req) {
+    auto total = 0uz;
+    for (auto& block : req.blocks) {
+      total += block.length;
+    }
+    if (total > chunk_size || (b != Backend::TCP && total > req.dst.size())) {
+      WARN("Fetch {} exceeds chunk size {} or landing size {}", total, chunk_size, req.dst.size());
+      if constexpr (b == Backend::TCP) {
+        // client reads the requested length before the status, or it never gets the status
+        write_padding(total);
+      }
+      return {.status = -EMSGSIZE, .lengths = {}};
+    }
+
+    StagingBuffer& buf = acquire_staging_buffer();
+
+    ReadBatch batch;
+    batch.results.resize(req.blocks.size(), 0);
+    std::vector<ReadTask> tasks(req.blocks.size());
+    auto offset = 0uz;
+    auto status = 0;
+    for (auto i = 0uz; i < req.blocks.size(); i++) {
+      auto& block = req.blocks[i];
+      auto fd = open_partition_file(block.partition_id);
+      if (fd < 0) {
+        status = fd;
+        break;
+      }
+      if (block.length != 0) {
+        tasks[i] = {.batch = &batch, .idx = i};
+        auto sqe = acquire_sqe();
+        io_uring_prep_read(sqe, fd, buf.data() + offset, block.length, block.offset);
+        io_uring_sqe_set_data(sqe, &tasks[i]);
+        batch.n_pending++;
+      }
+      offset += block.length;
+    }
+    if (batch.n_pending != 0) {
+      if (auto ec = io_uring_submit(&ring); ec < 0) {
+        die("Fail to submit sqe, errno: {}", -ec);
+      }
+      batch.done.get_future().get();
+    }
+
+    FetchResponse resp{.status = status, .lengths = {}};
+    resp.lengths.reserve(req.blocks.size());
+    offset = 0;
+    for (auto i = 0uz; i < req.blocks.size(); i++) {
+      auto& block = req.blocks[i];
+      auto n_read = batch.results[i];
+      if (n_read < 0) {
+        resp.status = n_read;
+        n_read = 0;
+      }
+      if (static_cast<uint64_t>(n_read) < block.length) {
+        // keep the layout of the landing buffer, short blocks are padded
+        memset(buf.data() + offset + n_read, 0, block.length - n_read);
+      }
+      resp.lengths.push_back(n_read);
+      offset += block.length;
+    }
+
+    if (total != 0) {
+      if constexpr (b == Backend::TCP) {
+        // client always reads the requested length
+        naive::BorrowedBuffer view(buf.data(), total);
+        t.bulk_write(view, MemoryRegion());
+      } else {
+        t.bulk_write(buf, MemoryRegion(req.dst.handle(), total));
+      }
+    }
+    bp.release_one(buf);
+    DEBUG("fetch {} blocks with length {}, status {}", req.blocks.size(), total, resp.status);
+    return resp;
+  }
+
+  // zeros on the bulk socket in staging-sized pieces, keeps the stream in step with a rejected fetch
+  void write_padding(size_t total)
+    requires(b == Backend::TCP)
+  {
+    StagingBuffer& buf = acquire_staging_buffer();
+    memset(buf.data(), 0, std::min(total, chunk_size));
+    for (auto offset = 0uz; offset < total;) {
+      auto length = std::min(total - offset, chunk_size);
+      naive::BorrowedBuffer view(buf.data(), length);
+      t.bulk_write(view, MemoryRegion());
+      offset += length;
+    }
+    bp.release_one(buf);
+  }
+
+  StagingBuffer& acquire_staging_buffer() {
+    while (true) {
+      if (auto buf = bp.acquire_one(); buf.has_value()) {
+        return buf.value();
+      }
+      boost::this_fiber::yield();
+    }
+  }
+
+  io_uring_sqe* acquire_sqe() {
+    while (true) {
+      if (auto sqe = io_uring_get_sqe(&ring); sqe != nullptr) {
+        return sqe;
+      }
+      io_uring_submit(&ring);
+      boost::this_fiber::yield();
+    }
+  }
+
+  void progress_io(const bool& serving) {
+    io_uring_cqe* cqe = nullptr;
+    while (serving) {
+      io_uring_peek_cqe(&ring, &cqe);
+      if (cqe == nullptr) {
+        boost::this_fiber::yield();
+        continue;
+      }
+      auto task = reinterpret_cast<ReadTask*>(io_uring_cqe_get_data(cqe));
+      task->batch->results[task->idx] = cqe->res;
+      if (--task->batch->n_pending == 0) {
+        task->batch->done.set_value();
+      }
+      io_uring_cqe_seen(&ring, cqe);
+    }
+  }
+
+  FetchTransport<b>& t;
+  std::string spill_dir;  // absolute path
+  size_t chunk_size;
+  std::atomic_bool& running;
+  StagingBufferPool bp;
+  io_uring ring;
+  std::vector<int> fds;
+};
+
+template <Backend b>
+class FetchClient : Noncopyable, Nonmovable {
+  using LandingBuffer = std::conditional_t<b == Backend::TCP, naive::BorrowedBuffer, doca::BorrowedBuffer>;
+
+ public:
+  using BlockFn = std::function<void(const FetchBlock&, std::span<uint8_t>)>;
+  using DecodedFn = std::function<void(uint32_t, std::span<const uint8_t>)>;
+
+  // NOTICE: DOCA backends need the landing buffer registered by t.register_memory
+  FetchClient(FetchTransport<b>& t_, LandingBuffer& landing_, size_t max_blocks_per_request_ = 16)
+      : t(t_), landing(landing_), max_blocks_per_request(max_blocks_per_request_) {}
+  ~FetchClient() = default;
+
+  std::vector<uint64_t> stat(std::vector<uint32_t> partition_ids) {
+    auto resp = t.template call<FetchStatRpc>(FetchStatRequest{.partition_ids = std::move(partition_ids)}).get();
+    if (resp.status != 0) {
+      die("Fail to stat partitions, errno: {}", -resp.status);
+    }
+    server_chunk_size = resp.chunk_size;
+    return resp.sizes;
+  }
+
+  // fetch blocks in one round trip, data of block i lands right after block i - 1
+  std::vector<uint64_t> fetch(const std::vector<FetchBlock>& blocks) {
+    auto total = 0uz;
+    for (auto& block : blocks) {
+      total += block.length;
+    }
+    if (total > landing.size()) {
+      die("Fetch {} exceeds landing buffer {}", total, landing.size());
+    }
+    auto resp_f = t.template call<FetchRpc>(
+        FetchRequest{.dst = MemoryRegion(landing.data(), landing.size()), .blocks = blocks});
+    if constexpr (b == Backend::TCP) {
+      if (total != 0) {
+        naive::BorrowedBuffer view(landing.data(), total);
+        t.bulk_read(view, MemoryRegion());
+      }
+    }
+    auto resp = resp_f.get();
+    if (resp.status != 0) {
+      die("Fail to fetch {} blocks, errno: {}", blocks.size(), -resp.status);
+    }
+    return resp.lengths;
+  }
+
+  // stream whole partitions, small ones are batched and large ones are split into chunks that fit both the landing
+  // buffer and the chunk size of the server
+  void fetch_partitions(const std::vector<uint32_t>& partition_ids, BlockFn fn) {
+    auto sizes = stat(partition_ids);
+    auto max_batch_size = std::min<size_t>(landing.size(), server_chunk_size);
+    std::vector<FetchBlock> batch;
+    auto batch_size = 0uz;
+    auto flush = [&]() {
+      if (batch.empty()) {
+        return;
+      }
+      auto lengths = fetch(batch);
+      auto offset = 0uz;
+      for (auto i = 0uz; i < batch.size(); i++) {
+        fn(batch[i], std::span<uint8_t>(landing.data() + offset, lengths[i]));
+        offset += batch[i].length;
+      }
+      batch.clear();
+      batch_size = 0;
+    };
+    for (auto i = 0uz; i < partition_ids.size(); i++) {
+      for (auto offset = 0uz; offset < sizes[i];) {
+        auto length = std::min(sizes[i] - offset, max_batch_size - batch_size);
+        batch.push_back({.partition_id = partition_ids[i], .offset = offset, .length = length});
+        batch_size += length;
+        offset += length;
+        if (batch_size == max_batch_size || batch.size() == max_blocks_per_request) {
+          flush();
+        }
+      }
+    }
+    flush();
+  }
+
+  // stream the spill blocks of whole partitions, each decoded and checked against its crc before fn sees it. a block
+  // that straddles fetched chunks is kept until it is complete. has_header if the partitions are spilled with the
+  // file header, which is checked and skipped
+  void fetch_decoded(const std::vector<uint32_t>& partition_ids, bool has_header, DecodedFn fn) {
+    struct Pending {
+      std::vector<uint8_t> tail;
+      bool headed = false;  // the file header is checked, or there is none
+    };
+    std::unordered_map<uint32_t, Pending> pending;
+    std::vector<uint8_t> decoded;
+    fetch_partitions(partition_ids, [&](const FetchBlock& block, std::span<uint8_t> data) {
+      auto& [tail, headed] = pending[block.partition_id];
+      tail.insert(tail.end(), data.begin(), data.end());
+      auto offset = 0uz;
+      if (!headed) {
+        if (has_header) {
+          if (tail.size() < partition_file_header_size) {
+            return;
+          }
+          check_partition_file_header(tail);
+          offset = partition_file_header_size;
+        }
+        headed = true;
+      }
+      while (tail.size() - offset >= sizeof(SpillBlockHeader)) {
+        SpillBlockHeader h;
+        memcpy(&h, tail.data() + offset, sizeof(SpillBlockHeader));
+        if (tail.size() - offset < sizeof(SpillBlockHeader) + h.stored_length) {
+          break;
+        }
+        offset += decode_spill_block(std::span<const uint8_t>(tail).subspan(offset), decoded);
+        fn(block.partition_id, decoded);
+      }
+      tail.erase(tail.begin(), tail.begin() + offset);
+    });
+    for (auto& [pid, p] : pending) {
+      if (!p.headed || !p.tail.empty()) {
+        die("Partition {} ends with a truncated spill block of {} bytes", pid, p.tail.size());
+      }
+    }
+  }
+
+ private:
+  FetchTransport<b>& t;
+  LandingBuffer& landing;
+  size_t max_blocks_per_request;
+  size_t server_chunk_size = 0;  // known after the first stat
+};
+
+}  // namespace dpx
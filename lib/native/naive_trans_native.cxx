@@ -21,14 +21,15 @@ inline static std::atomic_bool running = true;
 /*
  * Class:     pdsl_dpx_NaiveTransEnv
  * Method:    Initialize
- * Signature: (Ljava/lang/String;Ljava/lang/String;)V
+ * Signature: (Ljava/lang/String;Ljava/lang/String;I)V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_NaiveTransEnv_Initialize(JNIEnv *j_env, jclass, jstring j_pci_addr,
-                                                              jstring j_spill_dir) {
+                                                              jstring j_spill_dir, jint j_codec) {
   spdlog::set_level(spdlog::level::trace);
 
   auto pci_addr = dpx::get_j_string(j_env, j_pci_addr);
   auto spill_dir = dpx::get_j_string(j_env, j_spill_dir);
+  auto &codec = dpx::codec_of(static_cast<dpx::CodecType>(j_codec));
 
   dev_mlx5_1 = dpx::doca::Device::new_device_by_pci_addr(pci_addr);
 
@@ -38,7 +39,8 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_NaiveTransEnv_Initialize(JNIEnv *j_env, jcl
   std::this_thread::sleep_for(1s);  // split two connections
 
   sw = new dpx::HostSpillWorker(*dev_mlx5_1, {.passive = false, .name = "disk"},
-                                {.queue_depth = 16, .max_rpc_msg_size = 512}, spill_dir, 192, sp, running, 17);
+                                {.queue_depth = 16, .max_rpc_msg_size = 512}, spill_dir, 192, sp, running, 17,
+                                &codec);
 
   sp.arrive_and_wait();
 
@@ -10,10 +10,10 @@ extern "C" {
 /*
  * Class:     pdsl_dpx_NaiveTransEnv
  * Method:    Initialize
- * Signature: (Ljava/lang/String;Ljava/lang/String;)V
+ * Signature: (Ljava/lang/String;Ljava/lang/String;I)V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_NaiveTransEnv_Initialize
-  (JNIEnv *, jclass, jstring, jstring);
+  (JNIEnv *, jclass, jstring, jstring, jint);
 
 /*
  * Class:     pdsl_dpx_NaiveTransEnv
@@ -3,6 +3,7 @@
 #include <MPMCQueue.h>
 #include <SPSCQueue.h>
 
+#include <cassert>
 #include <cstdlib>
 #include <format>
 
@@ -10,12 +11,33 @@
 #include "doca/buffer.hxx"
 #include "memory/simple_buffer_pool.hxx"
 #include "trans/concept/rpc.hxx"
+#include "util/crc32c.hxx"
 
 namespace dpx {
 
+// how the records of a partition buffer are laid out, set by the host and carried along with the data, so the
+// combine stage on the dpu only folds what the host declared foldable
+struct RecordFormat {
+  uint8_t framed;        // records are framed with RecordHeader
+  uint8_t combinable;    // values of equal keys fold with combine_op, implies framed
+  uint8_t combine_op;    // CombineOp
+  uint8_t combine_type;  // CombineValueType, all values are of its width
+  uint32_t reserved;
+};
+
 struct PartitionDataHeader {
   size_t partition_id;
   size_t length;
+  uint32_t crc;  // crc32c of the data, valid if has_crc
+  uint32_t has_crc;
+  RecordFormat format;
+};
+
+// optional framing of one key/value record inside a partition buffer:
+// | RecordHeader | key | value |
+struct RecordHeader {
+  uint32_t key_length;
+  uint32_t value_length;
 };
 
 class PartitionBuffer {
@@ -26,6 +48,9 @@ class PartitionBuffer {
       : buffer(buffer_), header(reinterpret_cast<PartitionDataHeader*>(buffer.data())) {
     header->partition_id = partition_id;
     header->length = sizeof(PartitionDataHeader);
+    header->crc = 0;
+    header->has_crc = false;
+    header->format = {};
   }
 
   bool need_spill(size_t expected_size) { return header->length + expected_size > buffer.size(); }
@@ -34,6 +59,34 @@ class PartitionBuffer {
     memcpy(buffer.data() + header->length, data, length);
     header->length += length;
   }
+  void append_record(std::span<uint8_t> key, std::span<uint8_t> value) {
+    RecordHeader h{.key_length = static_cast<uint32_t>(key.size_bytes()),
+                   .value_length = static_cast<uint32_t>(value.size_bytes())};
+    append(&h, sizeof(RecordHeader));
+    append(key);
+    append(value);
+  }
+  // for writers that fill the buffer in place, commit what they wrote at tail
+  uint8_t* tail() { return buffer.data() + header->length; }
+  size_t remaining() { return buffer.size() - header->length; }
+  void commit(size_t length) {
+    assert(length <= remaining());
+    header->length += length;
+  }
+  // NOTICE: only shrinks, the data beyond the new size is dropped
+  void shrink(size_t actual_size_) {
+    assert(actual_size_ <= actual_size());
+    header->length = sizeof(PartitionDataHeader) + actual_size_;
+  }
+  // NOTICE: reseal after modifying the data
+  void seal() {
+    header->crc = crc32c(actual_data(), actual_size());
+    header->has_crc = true;
+  }
+  bool verify() { return !header->has_crc || header->crc == crc32c(actual_data(), actual_size()); }
+  uint32_t crc() { return header->has_crc ? header->crc : crc32c(actual_data(), actual_size()); }
+  void set_format(const RecordFormat& format) { header->format = format; }
+  const RecordFormat& format() { return header->format; }
   bool empty() { return header->length == sizeof(PartitionDataHeader); }
   size_t actual_size() { return header->length - sizeof(PartitionDataHeader); }
   size_t total_size() { return header->length; }
@@ -1,7 +1,9 @@
 #include "native/pipeline_trans_native.hxx"
 
+#include "native/sd_global.hxx"
 #include "native/spill_agent.hxx"
 #include "native/spill_worker.hxx"
+#include "sd/native/sd.hxx"
 #include "util/j_util.hxx"
 #include "util/literal.hxx"
 
@@ -11,30 +13,49 @@ inline static dpx::SpillAgent *sa = nullptr;
 inline static dpx::BufferredHostSpillWorker *sw = nullptr;
 inline static std::latch sp(3);
 inline static std::atomic_bool running = true;
+
+// appenders run on many java threads, each walks with its own context
+dpx::sd::Context &local_sd_context() {
+  auto pool = dpx::sd::global_context_pool();
+  if (pool == nullptr) {
+    die("SD is not initialized");
+  }
+  return pool->local();
+}
 }  // namespace
 
 /*
  * Class:     pdsl_dpx_PipelineTransEnv
  * Method:    Initialize
- * Signature: (Ljava/lang/String;Ljava/lang/String;)V
+ * Signature: (Ljava/lang/String;Ljava/lang/String;ZIII)V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_Initialize(JNIEnv *j_env, jclass, jstring j_pci_addr,
-                                                                 jstring j_spill_dir) {
+                                                                 jstring j_spill_dir, jboolean j_frame_records,
+                                                                 jint j_combine_op, jint j_combine_value_type,
+                                                                 jint j_codec) {
   spdlog::set_level(spdlog::level::trace);
 
   auto pci_addr = dpx::get_j_string(j_env, j_pci_addr);
   auto spill_dir = dpx::get_j_string(j_env, j_spill_dir);
+  auto &codec = dpx::codec_of(static_cast<dpx::CodecType>(j_codec));
 
   dev_mlx5_1 = dpx::doca::Device::new_device_by_pci_addr(pci_addr);
 
   sa = new dpx::SpillAgent(*dev_mlx5_1, {.passive = false, .name = "spill"},
                            {.queue_depth = 32, .max_rpc_msg_size = 512}, 1, 64, 32_MB, 32, sp, running);
+  if (j_frame_records) {
+    sa->enable_record_frame();
+  }
+  if (j_combine_op >= 0) {
+    sa->enable_combine(static_cast<dpx::CombineOp>(j_combine_op),
+                       static_cast<dpx::CombineValueType>(j_combine_value_type));
+  }
 
   std::this_thread::sleep_for(1s);
 
   sw = new dpx::BufferredHostSpillWorker(*dev_mlx5_1, {.passive = false, .name = "disk"},
                                          {.queue_depth = 32, .max_rpc_msg_size = 512}, spill_dir, 32, 32_MB, 32, sp,
-                                         running, 0);
+                                         running, 0, &codec);
 
   std::this_thread::sleep_for(1s);
 
@@ -73,6 +94,27 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_Append(JNIEnv *j_env, jcla
   dpx::release_raw_j_array(j_env, j_value, value);
 }
 
+/*
+ * Class:     pdsl_dpx_PipelineTransEnv
+ * Method:    AppendObject
+ * Signature: (ILjava/lang/Object;Z)V
+ */
+JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_AppendObject(JNIEnv *j_env, jclass, jint partition_id,
+                                                                   jobject j_obj, jboolean is_last) {
+  auto &ctx = local_sd_context();
+  // walk straight into the partition buffer, no byte[] in between
+  sa->append_or_spill_in_place(
+      partition_id,
+      [&](uint8_t *dst, size_t capacity) {
+        return ctx.serialize_to(j_env, j_obj, dpx::naive::BorrowedBuffer(dst, capacity));
+      },
+      [&](uint8_t *dst) { ctx.take_overflow(dst); });
+  if (is_last) {
+    DEBUG("is last {}", is_last);
+    sa->force_spill(partition_id);
+  }
+}
+
 /*
  * Class:     pdsl_dpx_PipelineTransEnv
  * Method:    WaitForSpillDone
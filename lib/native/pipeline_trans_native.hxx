@@ -10,10 +10,10 @@ extern "C" {
 /*
  * Class:     pdsl_dpx_PipelineTransEnv
  * Method:    Initialize
- * Signature: (Ljava/lang/String;Ljava/lang/String;)V
+ * Signature: (Ljava/lang/String;Ljava/lang/String;ZIII)V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_Initialize
-  (JNIEnv *, jclass, jstring, jstring);
+  (JNIEnv *, jclass, jstring, jstring, jboolean, jint, jint, jint);
 
 /*
  * Class:     pdsl_dpx_PipelineTransEnv
@@ -31,6 +31,14 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_TriggerSpillStart
 JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_Append
   (JNIEnv *, jclass, jint, jbyteArray, jbyteArray, jboolean);
 
+/*
+ * Class:     pdsl_dpx_PipelineTransEnv
+ * Method:    AppendObject
+ * Signature: (ILjava/lang/Object;Z)V
+ */
+JNIEXPORT void JNICALL Java_pdsl_dpx_PipelineTransEnv_AppendObject
+  (JNIEnv *, jclass, jint, jobject, jboolean);
+
 /*
  * Class:     pdsl_dpx_PipelineTransEnv
  * Method:    WaitForSpillDone
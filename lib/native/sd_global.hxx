@@ -0,0 +1,16 @@
+#pragma once
+
+#include "sd/native/class_resolver.hxx"
+#include "sd/native/context_pool.hxx"
+#include "sd/native/options.hxx"
+
+namespace dpx::sd {
+
+// state created by SD.Initialize, shared with the other native entries
+Options &global_options();
+// nullptr if SD is not initialized
+ClassResolver *global_resolver();
+// contexts of the calling threads, nullptr if SD is not initialized
+ContextPool *global_context_pool();
+
+}  // namespace dpx::sd
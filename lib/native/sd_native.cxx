@@ -2,6 +2,8 @@
 
 #include <glaze/glaze.hpp>
 
+#include "native/sd_global.hxx"
+#include "sd/native/context_pool.hxx"
 #include "sd/native/jenv_util.hxx"
 #include "sd/native/sd.hxx"
 #include "util/logger.hxx"
@@ -12,13 +14,23 @@ namespace {
 
 static dpx::sd::Options g_options;
 static dpx::sd::ClassResolver *g_r = nullptr;
-static dpx::sd::Context *g_ctx = nullptr;
+static dpx::sd::ContextPool *g_pool = nullptr;  // a context per calling thread
 static dpx::doca::Device *dev_mlx5_1 = nullptr;
 static dpx::sd::DPAContext *g_d_ctx = nullptr;
 static dpx::doca::MappedRegion *jvm_heap = nullptr;
 
 }  // namespace
 
+namespace dpx::sd {
+
+Options &global_options() { return g_options; }
+
+ClassResolver *global_resolver() { return g_r; }
+
+ContextPool *global_context_pool() { return g_pool; }
+
+}  // namespace dpx::sd
+
 /*
  * Class:     pdsl_dpx_SD
  * Method:    Start
@@ -42,8 +54,9 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_SD_Stop(JNIEnv *, jclass) {}
  * Signature: ()V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_SD_Destroy(JNIEnv *, jclass) {
-  if (g_ctx != nullptr) {
-    delete g_ctx;
+  if (g_pool != nullptr) {
+    delete g_pool;
+    g_pool = nullptr;
   }
   if (g_d_ctx != nullptr) {
     delete g_d_ctx;
@@ -75,7 +88,7 @@ JNIEXPORT jbyteArray JNICALL Java_pdsl_dpx_SD_Serialize(JNIEnv *j_env, jclass, j
   if (g_options.use_dpa) {
     return g_d_ctx->serialize(j_env, j_obj);
   }
-  return g_ctx->serialize(j_env, j_obj);
+  return g_pool->local().serialize(j_env, j_obj);
 }
 
 /*
@@ -84,7 +97,37 @@ JNIEXPORT jbyteArray JNICALL Java_pdsl_dpx_SD_Serialize(JNIEnv *j_env, jclass, j
  * Signature: ([BLjava/lang/Class;)Ljava/lang/Object;
  */
 JNIEXPORT jobject JNICALL Java_pdsl_dpx_SD_Deserialize(JNIEnv *j_env, jclass, jbyteArray j_input, jclass j_class) {
-  return g_ctx->deserialize(j_env, j_input, j_class);
+  return g_pool->local().deserialize(j_env, j_input, j_class);
+}
+
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    DeserializeInto
+ * Signature: ([BLjava/lang/Object;)Ljava/lang/Object;
+ */
+JNIEXPORT jobject JNICALL Java_pdsl_dpx_SD_DeserializeInto(JNIEnv *j_env, jclass, jbyteArray j_input,
+                                                           jobject j_target) {
+  return g_pool->local().deserialize_into(j_env, j_input, j_target);
+}
+
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    HashKey
+ * Signature: ([B[I)J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_SD_HashKey(JNIEnv *j_env, jclass, jbyteArray j_input, jintArray j_path) {
+  return g_pool->local().hash_key(j_env, j_input, j_path);
+}
+
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    SerializeBatch
+ * Signature: ([Ljava/lang/Object;ILjava/nio/ByteBuffer;II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_pdsl_dpx_SD_SerializeBatch(JNIEnv *j_env, jclass, jobjectArray j_objs, jint j_from,
+                                                            jobject j_out, jint j_position, jint j_limit) {
+  // NOTICE: batches always run on the host walker, dpa tasks are triggered one object at a time
+  return g_pool->local().serialize_batch(j_env, j_objs, j_from, j_out, j_position, j_limit);
 }
 
 /*
@@ -111,7 +154,7 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_SD_Initialize(JNIEnv *j_env, jclass, jobjec
   INFO("jvm args options: {}",
        glz::write<glz::opts{.prettify = true}>(dpx::sd::JVMArgs::jvm_args).value_or("Corrupted option"));
   g_r = new dpx::sd::ClassResolver(g_options);
-  g_ctx = new dpx::sd::Context(g_options, *g_r);
+  g_pool = new dpx::sd::ContextPool(j_env, g_options, *g_r);
   if (g_options.use_dpa) {
     dev_mlx5_1 = new dpx::doca::Device("mlx5_1", dpx::doca::Device::FindByIBDevName);
     dev_mlx5_1->open_dpa(::sd, "sd");
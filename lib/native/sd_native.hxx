@@ -55,6 +55,30 @@ JNIEXPORT jbyteArray JNICALL Java_pdsl_dpx_SD_Serialize
 JNIEXPORT jobject JNICALL Java_pdsl_dpx_SD_Deserialize
   (JNIEnv *, jclass, jbyteArray, jclass);
 
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    DeserializeInto
+ * Signature: ([BLjava/lang/Object;)Ljava/lang/Object;
+ */
+JNIEXPORT jobject JNICALL Java_pdsl_dpx_SD_DeserializeInto
+  (JNIEnv *, jclass, jbyteArray, jobject);
+
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    HashKey
+ * Signature: ([B[I)J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_SD_HashKey
+  (JNIEnv *, jclass, jbyteArray, jintArray);
+
+/*
+ * Class:     pdsl_dpx_SD
+ * Method:    SerializeBatch
+ * Signature: ([Ljava/lang/Object;ILjava/nio/ByteBuffer;II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_pdsl_dpx_SD_SerializeBatch
+  (JNIEnv *, jclass, jobjectArray, jint, jobject, jint, jint);
+
 /*
  * Class:     pdsl_dpx_SD
  * Method:    Register
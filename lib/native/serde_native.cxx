@@ -1,8 +1,8 @@
 #include "native/serde_native.hxx"
 
 #include <glaze/glaze.hpp>
-#include <set>
 
+#include "sd/native/context_pool.hxx"
 #include "sd/native/jenv_util.hxx"
 #include "sd/native/sd.hxx"
 #include "util/logger.hxx"
@@ -11,8 +11,7 @@ namespace {
 
 static dpx::sd::Options g_options;
 static dpx::sd::ClassResolver *g_r = nullptr;
-static std::mutex mu;
-static std::set<dpx::sd::Context *> g_ctx;
+static dpx::sd::ContextPool *g_pool = nullptr;  // contexts of the Serde instances
 
 }  // namespace
 
@@ -22,12 +21,28 @@ static std::set<dpx::sd::Context *> g_ctx;
  * Signature: ()V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_Serde_Destroy(JNIEnv *, jclass) {
+  // contexts refer to the resolver
+  if (g_pool != nullptr) {
+    delete g_pool;
+    g_pool = nullptr;
+  }
   if (g_r != nullptr) {
     delete g_r;
+    g_r = nullptr;
   }
-  for (auto ctx : g_ctx) {
-    delete ctx;
+}
+
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    TrimContexts
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_TrimContexts(JNIEnv *, jclass) {
+  if (g_pool == nullptr) {
+    WARN("Not initialized");
+    return 0;
   }
+  return g_pool->trim();
 }
 
 /*
@@ -62,6 +77,38 @@ JNIEXPORT jobject JNICALL Java_pdsl_dpx_Serde_Deserialize(JNIEnv *j_env, jclass,
   return reinterpret_cast<dpx::sd::Context *>(j_handle)->deserialize(j_env, j_input, j_class);
 }
 
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    DeserializeInto
+ * Signature: (J[BLjava/lang/Object;)Ljava/lang/Object;
+ */
+JNIEXPORT jobject JNICALL Java_pdsl_dpx_Serde_DeserializeInto(JNIEnv *j_env, jclass, jlong j_handle,
+                                                              jbyteArray j_input, jobject j_target) {
+  return reinterpret_cast<dpx::sd::Context *>(j_handle)->deserialize_into(j_env, j_input, j_target);
+}
+
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    HashKey
+ * Signature: (J[B[I)J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_HashKey(JNIEnv *j_env, jclass, jlong j_handle, jbyteArray j_input,
+                                                    jintArray j_path) {
+  return reinterpret_cast<dpx::sd::Context *>(j_handle)->hash_key(j_env, j_input, j_path);
+}
+
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    SerializeBatch
+ * Signature: (J[Ljava/lang/Object;ILjava/nio/ByteBuffer;II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_pdsl_dpx_Serde_SerializeBatch(JNIEnv *j_env, jclass, jlong j_handle,
+                                                               jobjectArray j_objs, jint j_from, jobject j_out,
+                                                               jint j_position, jint j_limit) {
+  return reinterpret_cast<dpx::sd::Context *>(j_handle)->serialize_batch(j_env, j_objs, j_from, j_out, j_position,
+                                                                         j_limit);
+}
+
 /*
  * Class:     pdsl_dpx_Serde
  * Method:    Register
@@ -89,6 +136,7 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_Serde_Initialize(JNIEnv *j_env, jclass, job
        glz::write<glz::opts{.prettify = true}>(dpx::sd::JVMArgs::jvm_args).value_or("Corrupted option"));
   g_options.enable_utf16_to_utf8 = true;
   g_r = new dpx::sd::ClassResolver(g_options);
+  g_pool = new dpx::sd::ContextPool(j_env, g_options, *g_r);
 }
 
 /*
@@ -97,16 +145,11 @@ JNIEXPORT void JNICALL Java_pdsl_dpx_Serde_Initialize(JNIEnv *j_env, jclass, job
  * Signature: ()J
  */
 JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_create(JNIEnv *, jclass) {
-  if (g_r == nullptr) {
+  if (g_pool == nullptr) {
     WARN("Not initialized");
     return 0;
   }
-  auto ctx = new dpx::sd::Context(g_options, *g_r);
-  {
-    std::lock_guard l(mu);
-    g_ctx.insert(ctx);
-  }
-  return reinterpret_cast<jlong>(ctx);
+  return reinterpret_cast<jlong>(g_pool->acquire());
 }
 
 /*
@@ -115,12 +158,8 @@ JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_create(JNIEnv *, jclass) {
  * Signature: (J)V
  */
 JNIEXPORT void JNICALL Java_pdsl_dpx_Serde_close(JNIEnv *, jclass, jlong j_handle) {
-  if (j_handle != 0) {
-    auto ctx = reinterpret_cast<dpx::sd::Context *>(j_handle);
-    {
-      std::lock_guard l(mu);
-      g_ctx.erase(ctx);
-    }
-    delete ctx;
+  // a handle closed after Destroy has been freed along with the pool, and a new pool does not take it back
+  if (j_handle != 0 && g_pool != nullptr && !g_pool->release(reinterpret_cast<dpx::sd::Context *>(j_handle))) {
+    WARN("Close a handle that is not open");
   }
 }
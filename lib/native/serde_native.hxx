@@ -15,6 +15,14 @@ extern "C" {
 JNIEXPORT void JNICALL Java_pdsl_dpx_Serde_Destroy
   (JNIEnv *, jclass);
 
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    TrimContexts
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_TrimContexts
+  (JNIEnv *, jclass);
+
 /*
  * Class:     pdsl_dpx_Serde
  * Method:    ShowRegisteredClass
@@ -39,6 +47,30 @@ JNIEXPORT jbyteArray JNICALL Java_pdsl_dpx_Serde_Serialize
 JNIEXPORT jobject JNICALL Java_pdsl_dpx_Serde_Deserialize
   (JNIEnv *, jclass, jlong, jbyteArray, jclass);
 
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    DeserializeInto
+ * Signature: (J[BLjava/lang/Object;)Ljava/lang/Object;
+ */
+JNIEXPORT jobject JNICALL Java_pdsl_dpx_Serde_DeserializeInto
+  (JNIEnv *, jclass, jlong, jbyteArray, jobject);
+
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    HashKey
+ * Signature: (J[B[I)J
+ */
+JNIEXPORT jlong JNICALL Java_pdsl_dpx_Serde_HashKey
+  (JNIEnv *, jclass, jlong, jbyteArray, jintArray);
+
+/*
+ * Class:     pdsl_dpx_Serde
+ * Method:    SerializeBatch
+ * Signature: (J[Ljava/lang/Object;ILjava/nio/ByteBuffer;II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_pdsl_dpx_Serde_SerializeBatch
+  (JNIEnv *, jclass, jlong, jobjectArray, jint, jobject, jint, jint);
+
 /*
  * Class:     pdsl_dpx_Serde
  * Method:    Register
@@ -2,6 +2,7 @@
 
 #include <queue>
 
+#include "native/combiner.hxx"
 #include "native/offload.hxx"
 #include "native/worker.hxx"
 
@@ -351,8 +352,8 @@ using TaskQueues = std::vector<TaskQueue*>;
 class PipelineShuffleWorkerPool {
  public:
   PipelineShuffleWorkerPool(TaskQueues lsqs_, TaskQueues rsqs_, TaskQueues trsqs_, TaskQueue& dsq_, DispatchFn fn_,
-                            std::atomic_bool& running_)
-      : lsqs(lsqs_), rsqs(rsqs_), trsqs(trsqs_), dsq(dsq_), fn(fn_), running(running_) {}
+                            std::atomic_bool& running_, CombineFn cfn_ = nullptr)
+      : lsqs(lsqs_), rsqs(rsqs_), trsqs(trsqs_), dsq(dsq_), fn(fn_), cfn(cfn_), running(running_) {}
   ~PipelineShuffleWorkerPool() {}
 
   void run_dispatch(size_t n_fiber, size_t core_idx) {
@@ -387,6 +388,10 @@ class PipelineShuffleWorkerPool {
         }
         auto t = *q->front();
         q->pop();
+        // NOTICE: combine only on the map side, buffers from remote are already combined by the sender
+        if (cfn) {
+          cfn(t->buffer);
+        }
         if (fn(t->buffer.partition_id())) {
           choose_one_trsq()->push(t);
         } else {
@@ -419,6 +424,7 @@ class PipelineShuffleWorkerPool {
   TaskQueue& dsq;
   std::thread ld;
   DispatchFn fn;
+  CombineFn cfn;
   std::atomic_bool& running;
 };
 
@@ -3,6 +3,7 @@
 #include <latch>
 #include <queue>
 
+#include "native/combiner.hxx"
 #include "native/offload.hxx"
 #include "native/worker.hxx"
 #include "util/literal.hxx"
@@ -50,27 +51,71 @@ class SpillAgent {
     // }
   }
 
+  // records are framed with RecordHeader, needed by the combine stage
+  void enable_record_frame() { format.framed = true; }
+  // values of equal keys may be folded with op on the dpu, all values must be of the width of type
+  void enable_combine(CombineOp op, CombineValueType type) {
+    if (!combine_supported(op, type)) {
+      die("Unsupported combine op {} on value type {}", (int)op, (int)type);
+    }
+    format = {
+        .framed = true,
+        .combinable = true,
+        .combine_op = static_cast<uint8_t>(op),
+        .combine_type = static_cast<uint8_t>(type),
+    };
+  }
+
   void append_or_spill(size_t partition_id, std::span<uint8_t> key, std::span<uint8_t> value) {
     std::lock_guard g(locks[partition_id]);
     auto b = active_buffers[partition_id];
+    auto length = key.size_bytes() + value.size_bytes() + (format.framed ? sizeof(RecordHeader) : 0);
     if (b == nullptr) {
       b = acquire_one(partition_id);
-      b->append(key);
-      b->append(value);
+      append(b, key, value);
       active_buffers[partition_id] = b;
-    } else if (b->need_spill(key.size_bytes() + value.size_bytes())) {
+    } else if (b->need_spill(length)) {
       INFO("buffer {} need spill, length: {}({})", partition_id, b->actual_size(), b->total_size());
       submit_spill_buffer(b);
       b = acquire_one(partition_id);
-      b->append(key);
-      b->append(value);
+      append(b, key, value);
       active_buffers[partition_id] = b;
     } else {
-      b->append(key);
-      b->append(value);
+      append(b, key, value);
     }
   }
 
+  // write a record in place, fn(dst, capacity) returns its length, which is larger than capacity if the record did
+  // not fit and then nothing is written, place(dst) lays it out in the next buffer, or drops it if dst is nullptr.
+  // a record gets whatever room is left, so nothing is reserved per record and a buffer only rolls over on overflow
+  template <typename Fn, typename PlaceFn>
+  void append_or_spill_in_place(size_t partition_id, Fn&& fn, PlaceFn&& place) {
+    std::lock_guard g(locks[partition_id]);
+    auto b = active_buffers[partition_id];
+    auto header = format.framed ? sizeof(RecordHeader) : 0uz;
+    if (b == nullptr) {
+      b = acquire_one(partition_id);
+      active_buffers[partition_id] = b;
+    } else if (b->need_spill(header)) {
+      b = roll_over(partition_id);
+    }
+    auto n = fn(b->tail() + header, b->remaining() - header);
+    if (b->need_spill(header + n)) {
+      b = roll_over(partition_id);
+      if (b->need_spill(header + n)) {
+        place(nullptr);
+        die("Record of {} bytes never fits a partition buffer", n);
+      }
+      place(b->tail() + header);
+    }
+    if (format.framed) {
+      // the whole record is the value
+      RecordHeader rh{.key_length = 0, .value_length = static_cast<uint32_t>(n)};
+      memcpy(b->tail(), &rh, sizeof(RecordHeader));
+    }
+    b->commit(header + n);
+  }
+
   void force_spill(size_t partition_id) {
     std::lock_guard g(locks[partition_id]);
     if (active_buffers[partition_id] == nullptr) {
@@ -81,6 +126,24 @@ class SpillAgent {
   }
 
  private:
+  PartitionBuffer* roll_over(size_t partition_id) {
+    auto b = active_buffers[partition_id];
+    INFO("buffer {} need spill, length: {}({})", partition_id, b->actual_size(), b->total_size());
+    submit_spill_buffer(b);
+    b = acquire_one(partition_id);
+    active_buffers[partition_id] = b;
+    return b;
+  }
+
+  void append(PartitionBuffer* b, std::span<uint8_t> key, std::span<uint8_t> value) {
+    if (format.framed) {
+      b->append_record(key, value);
+    } else {
+      b->append(key);
+      b->append(value);
+    }
+  }
+
   void issue_spill(int i) {
     INFO("spiller {} start", i);
     auto w = dma_worker[i];
@@ -115,6 +178,7 @@ class SpillAgent {
   }
 
   void submit_spill_buffer(PartitionBuffer* b) {
+    b->seal();
     {
       std::unique_lock g(q_mu);
       spill_q.push_back(b);
@@ -130,7 +194,9 @@ class SpillAgent {
         continue;
       }
       INFO("acquire one buf");
-      return new PartitionBuffer(buf->get(), partition_id);
+      auto b = new PartitionBuffer(buf->get(), partition_id);
+      b->set_format(format);
+      return b;
     }
   }
 
@@ -151,6 +217,7 @@ class SpillAgent {
   std::vector<std::mutex> locks;
   std::vector<PartitionBuffer*> active_buffers;
   BufferPool<doca::Buffers> dma_buffer_pool;
+  RecordFormat format = {};
 };
 
 class NaiveSpillAgent : Worker<Backend::DOCA_Comch> {
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "native/codec.hxx"
+#include "util/crc32c.hxx"
+
+namespace dpx {
+
+// the stream header of java serialization, written at the start of a partition file by
+// create_partition_files(need_header = true), before any spill block. readers are told whether a file has it, as
+// the data of a file without it may start with the same bytes
+constexpr uint32_t partition_file_magic = 0x0500edac;
+constexpr size_t partition_file_header_size = sizeof(partition_file_magic);
+
+// head is the start of a partition file that is expected to have the file header
+inline void check_partition_file_header(std::span<const uint8_t> head) {
+  uint32_t magic = 0;
+  if (head.size() < partition_file_header_size) {
+    die("Truncated partition file header, length: {}", head.size());
+  }
+  memcpy(&magic, head.data(), sizeof(magic));
+  if (magic != partition_file_magic) {
+    die("Bad partition file magic {:#x}", magic);
+  }
+}
+
+/*
+ * spill file layout, the raw codec if none is set:
+ *
+ * | SpillBlockHeader | stored data | SpillBlockHeader | stored data | ...
+ *
+ * each block is one partition buffer and decodes independently, its crc is checked by every reader.
+ */
+struct SpillBlockHeader {
+  constexpr static uint32_t magic_number = 0x42585044;  // "DPXB"
+
+  uint32_t magic;
+  CodecType codec;
+  uint8_t reserved[3];
+  uint32_t uncompressed_length;
+  uint32_t stored_length;
+  uint32_t crc;  // crc32c of the uncompressed data
+  uint32_t reserved1;
+};
+static_assert(sizeof(SpillBlockHeader) == 24);
+
+// one encoded block, must be alive until its write is done
+struct SpillBlock {
+  SpillBlockHeader header;
+  std::vector<uint8_t> scratch;
+  std::array<iovec, 2> iov;
+
+  // fall back to raw if the codec does not help
+  void encode(const Codec& codec, uint8_t* data, size_t length) { encode(codec, data, length, crc32c(data, length)); }
+  // reuse the crc carried by the partition buffer
+  void encode(const Codec& codec, uint8_t* data, size_t length, uint32_t crc) {
+    header = SpillBlockHeader{
+        .magic = SpillBlockHeader::magic_number,
+        .codec = CodecType::Raw,
+        .reserved = {},
+        .uncompressed_length = static_cast<uint32_t>(length),
+        .stored_length = static_cast<uint32_t>(length),
+        .crc = crc,
+        .reserved1 = 0,
+    };
+    iov[1] = {data, length};
+    if (codec.type() != CodecType::Raw) {
+      scratch.resize(codec.max_compressed_size(length));
+      auto n = codec.compress(data, length, scratch.data(), scratch.size());
+      if (n != 0 && n < length) {
+        header.codec = codec.type();
+        header.stored_length = n;
+        iov[1] = {scratch.data(), n};
+      }
+    }
+    iov[0] = {&header, sizeof(SpillBlockHeader)};
+  }
+
+  size_t size() const { return sizeof(SpillBlockHeader) + header.stored_length; }
+};
+
+// blocks of the writes in flight, a block goes back after its write is done and keeps its scratch, so encoding
+// does not allocate once every in flight slot has seen its largest block. not thread safe, the submitting and the
+// reaping fibers of a worker share one thread.
+class SpillBlockPool {
+ public:
+  SpillBlock* acquire() {
+    if (free.empty()) {
+      blocks.push_back(std::make_unique<SpillBlock>());
+      return blocks.back().get();
+    }
+    auto b = free.back();
+    free.pop_back();
+    return b;
+  }
+
+  void release(SpillBlock* b) { free.push_back(b); }
+
+ private:
+  std::vector<std::unique_ptr<SpillBlock>> blocks;
+  std::vector<SpillBlock*> free;
+};
+
+// decode and verify the stored data of one block into out
+inline void decode_spill_block(const SpillBlockHeader& header, std::span<const uint8_t> stored,
+                               std::vector<uint8_t>& out) {
+  if (header.magic != SpillBlockHeader::magic_number) {
+    die("Bad spill block magic {:#x}", header.magic);
+  }
+  if (stored.size() < header.stored_length) {
+    die("Truncated spill block, expected: {}, got: {}", header.stored_length, stored.size());
+  }
+  out.resize(header.uncompressed_length);
+  auto n = codec_of(header.codec).decompress(stored.data(), header.stored_length, out.data(), out.size());
+  if (n != header.uncompressed_length) {
+    die("Fail to decode spill block, expected: {}, got: {}", header.uncompressed_length, n);
+  }
+  if (auto crc = crc32c(out.data(), out.size()); crc != header.crc) {
+    die("Spill block checksum mismatch, expected: {:#x}, got: {:#x}", header.crc, crc);
+  }
+}
+
+// decode and verify the block at the front of data into out, return the consumed length
+inline size_t decode_spill_block(std::span<const uint8_t> data, std::vector<uint8_t>& out) {
+  if (data.size() < sizeof(SpillBlockHeader)) {
+    die("Truncated spill block header, length: {}", data.size());
+  }
+  SpillBlockHeader header;
+  memcpy(&header, data.data(), sizeof(SpillBlockHeader));
+  decode_spill_block(header, data.subspan(sizeof(SpillBlockHeader)), out);
+  return sizeof(SpillBlockHeader) + header.stored_length;
+}
+
+}  // namespace dpx
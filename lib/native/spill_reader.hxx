@@ -0,0 +1,385 @@
+#pragma once
+
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "memory/naive_buffer.hxx"
+#include "native/offload.hxx"
+#include "native/spill_block.hxx"
+#include "util/literal.hxx"
+
+namespace dpx {
+
+/*
+ * Reduce-side reader of spilled partitions.
+ *
+ * One partition may have several segments, e.g. {spill_dir}/p{i} of every spill session or map task. Each segment is
+ * read sequentially with io_uring into n_chunk chunks of its own, so at most n_segment * n_chunk * chunk_size bytes
+ * are buffered and the next chunks are in flight while the current one is consumed.
+ *
+ * Segments must be spilled with record framing (| RecordHeader | key | value |). They are sequences of spill blocks,
+ * raw ones without a codec, records never straddle blocks and each block is checked against its crc. Segments of
+ * create_partition_files(need_header = true) start with the file header, which the caller tells the reader about.
+ */
+
+// one segment as a byte stream, spans returned by read are valid until the next read
+class SegmentStream : Noncopyable, Nonmovable {
+  struct Chunk {
+    naive::BorrowedBuffer& buf;
+    size_t length = 0;  // valid length of the last read
+    bool in_flight = false;
+  };
+
+ public:
+  // has_header if the segment starts with the file header, which is checked and skipped
+  SegmentStream(io_uring& ring_, std::string path_, bool has_header, size_t chunk_size, size_t n_chunk)
+      : ring(ring_), path(path_), bufs(n_chunk, chunk_size) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      die("Fail to open {}, errno: {}", path, errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      die("Fail to stat {}, errno: {}", path, errno);
+    }
+    file_size = st.st_size;
+    if (has_header) {
+      uint8_t head[partition_file_header_size];
+      auto n_head = pread(fd, head, sizeof(head), 0);
+      if (n_head < 0) {
+        die("Fail to read {}, errno: {}", path, errno);
+      }
+      check_partition_file_header(std::span<const uint8_t>(head, n_head));
+      read_offset = consumed = partition_file_header_size;
+    }
+    chunks.reserve(n_chunk);
+    for (auto i = 0uz; i < n_chunk; i++) {
+      chunks.push_back({.buf = bufs[i]});
+    }
+    read_ahead();
+  }
+
+  ~SegmentStream() {
+    // the ring may still write into our chunks
+    for (auto& c : chunks) {
+      while (c.in_flight) {
+        reap();
+      }
+    }
+    close(fd);
+  }
+
+  bool eof() const { return consumed == file_size; }
+  size_t size() const { return file_size; }
+
+  std::span<const uint8_t> read(size_t n) {
+    if (n > file_size - consumed) {
+      die("Truncated segment {}, expected {} more bytes at {}", path, n, consumed);
+    }
+    if (n == 0) {
+      return {};
+    }
+    release_consumed();
+    auto& head = wait_head();
+    if (head.length - pos >= n) {
+      std::span<const uint8_t> s(head.buf.data() + pos, n);
+      pos += n;
+      consumed += n;
+      return s;
+    }
+    // straddles chunks, assemble it in carry
+    carry.resize(n);
+    auto copied = 0uz;
+    while (copied < n) {
+      release_consumed();
+      auto& c = wait_head();
+      auto len = std::min(c.length - pos, n - copied);
+      memcpy(carry.data() + copied, c.buf.data() + pos, len);
+      pos += len;
+      copied += len;
+    }
+    consumed += n;
+    return carry;
+  }
+
+ private:
+  // hand the fully consumed head chunk back to the read-ahead
+  void release_consumed() {
+    auto& head = chunks[head_idx];
+    if (!head.in_flight && head.length != 0 && pos == head.length) {
+      head.length = 0;
+      pos = 0;
+      head_idx = (head_idx + 1) % chunks.size();
+      read_ahead();
+    }
+  }
+
+  Chunk& wait_head() {
+    auto& head = chunks[head_idx];
+    if (head.length == 0) {
+      read_ahead();
+    }
+    while (head.in_flight) {
+      reap();
+    }
+    if (head.length == 0) {
+      die("Segment {} has no data at {}", path, consumed);
+    }
+    return head;
+  }
+
+  void read_ahead() {
+    auto submitted = false;
+    for (auto i = 0uz; i < chunks.size() && read_offset < file_size; i++) {
+      auto& c = chunks[(tail_idx) % chunks.size()];
+      if (c.in_flight || c.length != 0) {
+        break;
+      }
+      auto sqe = io_uring_get_sqe(&ring);
+      if (sqe == nullptr) {
+        break;
+      }
+      c.length = std::min(c.buf.size(), file_size - read_offset);
+      c.in_flight = true;
+      io_uring_prep_read(sqe, fd, c.buf.data(), c.length, read_offset);
+      io_uring_sqe_set_data(sqe, &c);
+      read_offset += c.length;
+      tail_idx = (tail_idx + 1) % chunks.size();
+      submitted = true;
+    }
+    if (submitted) {
+      if (auto ec = io_uring_submit(&ring); ec < 0) {
+        die("Fail to submit sqe, errno: {}", -ec);
+      }
+    }
+  }
+
+  // completions of all segments share the ring, route them by chunk
+  void reap() {
+    io_uring_cqe* cqe = nullptr;
+    if (auto ec = io_uring_wait_cqe(&ring, &cqe); ec < 0) {
+      die("Fail to wait cqe, errno: {}", -ec);
+    }
+    auto c = reinterpret_cast<Chunk*>(io_uring_cqe_get_data(cqe));
+    if (cqe->res < 0 || static_cast<size_t>(cqe->res) != c->length) {
+      die("Fail to read segment, expected: {}, got: {}", c->length, cqe->res);
+    }
+    c->in_flight = false;
+    io_uring_cqe_seen(&ring, cqe);
+  }
+
+  io_uring& ring;
+  std::string path;
+  int fd = -1;
+  size_t file_size = 0;
+  size_t read_offset = 0;  // next offset to read ahead
+  size_t consumed = 0;     // offset of the stream
+  naive::Buffers bufs;
+  std::vector<Chunk> chunks;
+  size_t head_idx = 0;  // chunk being consumed
+  size_t tail_idx = 0;  // next chunk to read ahead
+  size_t pos = 0;       // offset in the head chunk
+  std::vector<uint8_t> carry;
+};
+
+// framed records of one segment, key and value are valid until the next call of next
+class SegmentReader : Noncopyable, Nonmovable {
+ public:
+  SegmentReader(io_uring& ring, std::string path, bool has_header, size_t chunk_size, size_t n_chunk)
+      : s(ring, path, has_header, chunk_size, n_chunk) {}
+  ~SegmentReader() = default;
+
+  bool next() {
+    while (block_pos == block.size()) {
+      if (s.eof()) {
+        return false;
+      }
+      next_block();
+    }
+    RecordHeader h;
+    if (block.size() - block_pos < sizeof(RecordHeader)) {
+      die("Truncated record header in block, length: {}", block.size() - block_pos);
+    }
+    memcpy(&h, block.data() + block_pos, sizeof(RecordHeader));
+    block_pos += sizeof(RecordHeader);
+    if (block.size() - block_pos < static_cast<size_t>(h.key_length) + h.value_length) {
+      die("Record straddles spill block, key: {}, value: {}", h.key_length, h.value_length);
+    }
+    set_record(h, std::span<const uint8_t>(block.data() + block_pos, h.key_length + h.value_length));
+    block_pos += h.key_length + h.value_length;
+    return true;
+  }
+
+  std::span<const uint8_t> key() const { return k; }
+  std::span<const uint8_t> value() const { return v; }
+  // first 8 bytes of the key in big endian, zero padded, compares the same as memcmp
+  uint64_t key_prefix() const { return prefix; }
+
+ private:
+  void next_block() {
+    SpillBlockHeader h;
+    memcpy(&h, s.read(sizeof(SpillBlockHeader)).data(), sizeof(SpillBlockHeader));
+    decode_spill_block(h, s.read(h.stored_length), block);
+    block_pos = 0;
+  }
+
+  void set_record(const RecordHeader& h, std::span<const uint8_t> kv) {
+    k = kv.subspan(0, h.key_length);
+    v = kv.subspan(h.key_length);
+    uint8_t bytes[sizeof(uint64_t)] = {};
+    memcpy(bytes, k.data(), std::min(k.size(), sizeof(uint64_t)));
+    uint64_t x;
+    memcpy(&x, bytes, sizeof(uint64_t));
+    prefix = __builtin_bswap64(x);
+  }
+
+  SegmentStream s;
+  std::vector<uint8_t> block;  // decoded block
+  size_t block_pos = 0;
+  std::span<const uint8_t> k;
+  std::span<const uint8_t> v;
+  uint64_t prefix = 0;
+};
+
+/*
+ * Records of all segments of one partition.
+ *
+ * Concat: segment after segment.
+ * Merge:  k-way merge with a loser tree, segments must be sorted by key in memcmp order. Keys are compared by the
+ *         8-byte prefix first, the full key only on ties. Equal keys come out in the order of segments.
+ */
+class PartitionReader : Noncopyable, Nonmovable {
+ public:
+  enum class Mode {
+    Concat,
+    Merge,
+  };
+
+  // has_header if the segments are spilled with the file header
+  PartitionReader(const std::vector<std::string>& segment_paths, Mode mode_, bool has_header,
+                  size_t chunk_size = 1_MB, size_t n_chunk = 2)
+      : mode(mode_) {
+    if (auto ec = io_uring_queue_init(std::max<size_t>(segment_paths.size() * n_chunk, 1), &ring, 0); ec < 0) {
+      die("Fail to init ring, errno: {}", -ec);
+    }
+    segments.reserve(segment_paths.size());
+    for (auto& path : segment_paths) {
+      segments.emplace_back(std::make_unique<SegmentReader>(ring, path, has_header, chunk_size, n_chunk));
+    }
+    exhausted.resize(segments.size(), false);
+  }
+
+  ~PartitionReader() {
+    segments.clear();
+    io_uring_queue_exit(&ring);
+  }
+
+  bool next() {
+    if (mode == Mode::Concat) {
+      while (current < segments.size()) {
+        if (segments[current]->next()) {
+          return true;
+        }
+        current++;
+      }
+      return false;
+    }
+    if (!started) {
+      build();
+      started = true;
+    } else if (!segments.empty()) {
+      advance(tree[0]);
+      adjust(tree[0]);
+    }
+    if (segments.empty() || exhausted[tree[0]]) {
+      return false;
+    }
+    current = tree[0];
+    return true;
+  }
+
+  std::span<const uint8_t> key() const { return segments[current]->key(); }
+  std::span<const uint8_t> value() const { return segments[current]->value(); }
+  size_t segment_idx() const { return current; }
+
+ private:
+  void advance(size_t i) { exhausted[i] = !segments[i]->next(); }
+
+  // whether segment a goes before segment b, k is the sentinel that goes before all
+  bool before(size_t a, size_t b) const {
+    auto k = segments.size();
+    if (a == k || b == k) {
+      return a == k;
+    }
+    if (exhausted[a] || exhausted[b]) {
+      return !exhausted[a] && exhausted[b];
+    }
+    auto& sa = *segments[a];
+    auto& sb = *segments[b];
+    if (sa.key_prefix() != sb.key_prefix()) {
+      return sa.key_prefix() < sb.key_prefix();
+    }
+    auto ka = sa.key();
+    auto kb = sb.key();
+    if (auto r = memcmp(ka.data(), kb.data(), std::min(ka.size(), kb.size())); r != 0) {
+      return r < 0;
+    }
+    if (ka.size() != kb.size()) {
+      return ka.size() < kb.size();
+    }
+    return a < b;
+  }
+
+  // replay the leaf i from the bottom, losers stay in the nodes, the winner goes to tree[0]
+  void adjust(size_t i) {
+    auto k = segments.size();
+    auto winner = i;
+    for (auto t = (i + k) / 2; t > 0; t /= 2) {
+      if (before(tree[t], winner)) {
+        std::swap(winner, tree[t]);
+      }
+    }
+    tree[0] = winner;
+  }
+
+  void build() {
+    auto k = segments.size();
+    tree.assign(std::max<size_t>(k, 1), k);
+    for (auto i = 0uz; i < k; i++) {
+      advance(i);
+    }
+    for (auto i = k; i > 0; i--) {
+      adjust(i - 1);
+    }
+  }
+
+  Mode mode;
+  io_uring ring;
+  std::vector<std::unique_ptr<SegmentReader>> segments;
+  std::vector<bool> exhausted;
+  std::vector<size_t> tree;  // tree[0] is the winner, tree[1..k) are losers
+  size_t current = 0;
+  bool started = false;
+};
+
+// existing segments of one partition in the given spill dirs, in the order of dirs
+inline std::vector<std::string> segments_of(const std::vector<std::string>& spill_dirs, size_t partition_id) {
+  std::vector<std::string> paths;
+  for (auto& dir : spill_dirs) {
+    auto path = std::format("{}/p{}", dir, partition_id);
+    if (std::filesystem::exists(path)) {
+      paths.push_back(path);
+    }
+  }
+  return paths;
+}
+
+}  // namespace dpx
@@ -3,6 +3,7 @@
 #include <latch>
 
 #include "native/offload.hxx"
+#include "native/spill_block.hxx"
 #include "native/worker.hxx"
 
 namespace dpx {
@@ -81,6 +82,9 @@ class SpillWorker : public Worker<b, rpcs...> {
     if (task.buffer.total_size() != n_read) {
       die("Fail to read partition buffer, expected: {}, got: {}", task.buffer.total_size(), n_read);
     }
+    if (!task.buffer.verify()) {
+      die("Checksum mismatch of partition {} with length {}", task.buffer.partition_id(), n_read);
+    }
     DEBUG("Fetch {} of partition {}", n_read, task.buffer.partition_id());
     task_q.push(&task);
     size_t n_spill = task.res.get_future().get();
@@ -103,11 +107,12 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
  public:
   DirectSpillWorker(doca::Device& dev, const ConnectionParam<Backend::DOCA_Comch>& param, const Config& trans_conf,
                     TaskQueue& spill_q_, std::string mount_point_, std::string output_device_, size_t io_depth,
-                    SpillBufferPool& bp, std::atomic_bool& running_)
+                    SpillBufferPool& bp, std::atomic_bool& running_, const Codec* codec_ = nullptr)
       : Base(dev, param, trans_conf, running_),
         spill_q(spill_q_),
         mount_point(mount_point_),
-        output_device(output_device_) {
+        output_device(output_device_),
+        codec(codec_ != nullptr ? codec_ : &codec_of(CodecType::Raw)) {
     if (auto ec = io_uring_queue_init(io_depth, &ring, 0); ec < 0) {
       die("Fail to init ring, errno: {}", -ec);
     }
@@ -116,8 +121,6 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
       auto& b = bs[i];
       iovecs.push_back(b);
     }
-    base = bs.data();
-    piece_size = bs.piece_size();
     if (auto ec = io_uring_register_buffers(&ring, iovecs.data(), bs.n_elements()); ec < 0) {
       die("Fail to register buffers, errno: {}", -ec);
     }
@@ -164,24 +167,27 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
       DEBUG("spill {} of partition {} at {}", task->buffer.actual_size(), task->buffer.partition_id(),
             (void*)task->buffer.underlying().data());
 
+      auto io = new FileIOTask{.task = task, .block = blocks.acquire()};
+      io->block->encode(*codec, reinterpret_cast<uint8_t*>(task->buffer.actual_data()), task->buffer.actual_size(),
+                        task->buffer.crc());
+
       auto sqe = io_uring_get_sqe(&ring);
 
       {
         std::unique_lock l(mu);
         c.wait(l, [&]() { return !running || files.size() == max_n_partition; });
         if (!running) {
+          blocks.release(io->block);
+          delete io;
           break;
         }
         auto& f = files[task->buffer.partition_id()];
-        // io_uring_prep_write(sqe, f.fd, task->buffer.actual_data(), task->buffer.actual_size(), f.offset);
-        auto idx = (task->buffer.underlying().data() - base) / piece_size;
-
-        io_uring_prep_write_fixed(sqe, f.fd, task->buffer.actual_data(), task->buffer.actual_size(), f.offset, idx);
-
-        f.offset += task->buffer.actual_size();
+        // a raw block points at the buffer, so the data is still written without a copy
+        io_uring_prep_writev(sqe, f.fd, io->block->iov.data(), io->block->iov.size(), f.offset);
+        f.offset += io->block->size();
       }
 
-      io_uring_sqe_set_data(sqe, task);
+      io_uring_sqe_set_data(sqe, io);
       if (auto ec = io_uring_submit(&ring); ec < 0) {
         die("Fail to submit sqe, errno: {}", -ec);
       }
@@ -253,7 +259,8 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
         break;
       }
 
-      auto task = reinterpret_cast<SpillTask*>(io_uring_cqe_get_data(cqe));
+      auto io = reinterpret_cast<FileIOTask*>(io_uring_cqe_get_data(cqe));
+      auto task = io->task;
 
       DEBUG("spill {} of partition {}, res {}", task->buffer.actual_size(), task->buffer.partition_id(), cqe->res);
 
@@ -262,6 +269,8 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
       } else {
         task->res.set_value(cqe->res);
       }
+      blocks.release(io->block);
+      delete io;
       io_uring_cqe_seen(&ring, cqe);
       issued_io--;
     }
@@ -272,6 +281,10 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
     size_t partition_id = -1;
     size_t offset = 0;
   };
+  struct FileIOTask {
+    SpillTask* task;
+    SpillBlock* block;
+  };
 
   bool mounted = false;
 
@@ -286,9 +299,9 @@ class DirectSpillWorker : public Worker<Backend::DOCA_Comch, MountRpc, UmountRpc
   size_t issued_io = 0;
 
   std::vector<iovec> iovecs;
-  uint8_t* base = nullptr;
-  size_t piece_size = 0;
   std::vector<PartitionFile> files;
+  const Codec* codec = nullptr;  // raw if none is given, every buffer is spilled as one checksummed block
+  SpillBlockPool blocks;         // of the writes in flight, only touched by the io fibers
 };
 
 template <Backend b, Rpc... rpcs>
@@ -339,8 +352,12 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
  public:
   HostSpillWorker(doca::Device& dev, const ConnectionParam<Backend::DOCA_Comch>& param, const Config& trans_conf,
                   std::string spill_dir_, size_t max_n_partition_, std::latch& start_point_, std::atomic_bool& running_,
-                  size_t core_idx)
-      : Base(dev, param, trans_conf, running_), io_q(64), spill_dir(spill_dir_), max_n_partition(max_n_partition_) {
+                  size_t core_idx, const Codec* codec_ = nullptr)
+      : Base(dev, param, trans_conf, running_),
+        io_q(64),
+        spill_dir(spill_dir_),
+        max_n_partition(max_n_partition_),
+        codec(codec_ != nullptr ? codec_ : &codec_of(CodecType::Raw)) {
     if (auto ec = io_uring_queue_init(64, &ring, 0); ec < 0) {
       die("Fail to init ring, errno: {}", -ec);
     }
@@ -387,7 +404,7 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
         INFO("open {}", fname);
         f.partition_id = i;
         if (need_header) {
-          uint32_t magic_number_and_version = 0x0500edac;
+          uint32_t magic_number_and_version = partition_file_magic;
           write(f.fd, &magic_number_and_version, sizeof(uint32_t));
           f.offset = sizeof(uint32_t);
         } else {
@@ -432,6 +449,10 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
 
       DEBUG("spill {} of partition {} at {}", task->buffer->size(), header->partition_id, (void*)task->buffer->data());
 
+      task->block = blocks.acquire();
+      task->block->encode(*codec, task->buffer->data() + sizeof(PartitionDataHeader),
+                          task->buffer->size() - sizeof(PartitionDataHeader), PartitionBuffer((*task->buffer)[0]).crc());
+
       auto sqe = io_uring_get_sqe(&ring);
       {
         std::unique_lock l(mu);
@@ -440,9 +461,8 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
           break;
         }
         auto& f = files[header->partition_id];
-        io_uring_prep_write(sqe, f.fd, task->buffer->data() + sizeof(PartitionDataHeader),
-                            task->buffer->size() - sizeof(PartitionDataHeader), f.offset);
-        f.offset += task->buffer->size() - sizeof(PartitionDataHeader);
+        io_uring_prep_writev(sqe, f.fd, task->block->iov.data(), task->block->iov.size(), f.offset);
+        f.offset += task->block->size();
       }
 
       io_uring_sqe_set_data(sqe, task);
@@ -480,6 +500,9 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
 
       DEBUG("spill {} of partition {}, res {}", task->buffer->size(), header->partition_id, cqe->res);
 
+      // before waking the requester, the task lives on its stack
+      blocks.release(task->block);
+      task->block = nullptr;
       if (cqe->res > 0) {
         task->res.set_value(task->buffer->size());
       } else {
@@ -500,8 +523,11 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
     // }
     auto pid = *reinterpret_cast<uint32_t*>(buf.data());
     DEBUG("Fetch {} of partition {}", n_read, pid);
+    if (!PartitionBuffer(buf).verify()) {
+      die("Checksum mismatch of partition {} with length {}", pid, n_read);
+    }
     // auto task = SpillTask(buf);
-    auto task = FileIOTask{.res = {}, .buffer = &b};
+    auto task = FileIOTask{.res = {}, .buffer = &b, .block = nullptr};
     io_q.push(&task);
     size_t n_spill = task.res.get_future().get();
     if (n_spill != task.buffer->size()) {
@@ -514,6 +540,7 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
   struct FileIOTask {
     op_res_promise_t res;
     doca::Buffers* buffer;
+    SpillBlock* block;
   };
   struct PartitionFile {
     int fd = -1;
@@ -528,6 +555,8 @@ class HostSpillWorker : public Worker<Backend::DOCA_Comch> {
   size_t max_n_partition;
   std::vector<PartitionFile> files;
   std::atomic_bool spilling;
+  const Codec* codec = nullptr;  // raw if none is given, every buffer is spilled as one checksummed block
+  SpillBlockPool blocks;         // of the writes in flight, only touched by the io fibers
 };
 
 class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
@@ -537,12 +566,13 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
   BufferredHostSpillWorker(doca::Device& dev, const ConnectionParam<Backend::DOCA_Comch>& param,
                            const Config& trans_conf, std::string spill_dir_, size_t n_buffer, size_t buffer_size,
                            size_t max_n_partition_, std::latch& start_point_, std::atomic_bool& running_,
-                           size_t core_idx)
+                           size_t core_idx, const Codec* codec_ = nullptr)
       : Base(dev, param, trans_conf, running_),
         bp(dev, n_buffer, buffer_size, DOCA_ACCESS_FLAG_PCI_READ_WRITE),
         io_q(64),
         spill_dir(spill_dir_),
-        max_n_partition(max_n_partition_) {
+        max_n_partition(max_n_partition_),
+        codec(codec_ != nullptr ? codec_ : &codec_of(CodecType::Raw)) {
     if (auto ec = io_uring_queue_init(64, &ring, 0); ec < 0) {
       die("Fail to init ring, errno: {}", -ec);
     }
@@ -588,7 +618,7 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
         INFO("open {}", fname);
         f.partition_id = i;
         if (need_header) {
-          uint32_t magic_number_and_version = 0x0500edac;
+          uint32_t magic_number_and_version = partition_file_magic;
           write(f.fd, &magic_number_and_version, sizeof(uint32_t));
           f.offset = sizeof(uint32_t);
         } else {
@@ -633,6 +663,10 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
 
       INFO("append {} of partition {} at {} to file", header->length, header->partition_id, (void*)task->buffer.data());
 
+      task->block = blocks.acquire();
+      task->block->encode(*codec, task->buffer.data() + sizeof(PartitionDataHeader),
+                          header->length - sizeof(PartitionDataHeader), PartitionBuffer(task->buffer).crc());
+
       auto sqe = io_uring_get_sqe(&ring);
       {
         std::unique_lock l(mu);
@@ -641,9 +675,8 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
           break;
         }
         auto& f = files[header->partition_id];
-        io_uring_prep_write(sqe, f.fd, task->buffer.data() + sizeof(PartitionDataHeader),
-                            header->length - sizeof(PartitionDataHeader), f.offset);
-        f.offset += header->length - sizeof(PartitionDataHeader);
+        io_uring_prep_writev(sqe, f.fd, task->block->iov.data(), task->block->iov.size(), f.offset);
+        f.offset += task->block->size();
       }
 
       io_uring_sqe_set_data(sqe, task);
@@ -681,6 +714,9 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
 
       INFO("spill {} of partition {}, res {}", header->length, header->partition_id, cqe->res);
 
+      // before waking the requester, the task lives on its stack
+      blocks.release(task->block);
+      task->block = nullptr;
       if (cqe->res > 0) {
         task->res.set_value(header->length);
       } else {
@@ -702,10 +738,13 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
     if (header->length != n_read) {
       die("Fail to read partition buffer, expected: {}, got: {}", header->length, n_read);
     }
+    if (!PartitionBuffer(buf).verify()) {
+      die("Checksum mismatch of partition {} with length {}", header->partition_id, n_read);
+    }
     // auto pid = *reinterpret_cast<uint32_t*>(buf.data());
     // DEBUG("Fetch {} of partition {}", n_read, pid);
     // auto task = SpillTask(buf);
-    auto task = FileIOTask{.res = {}, .buffer = buf};
+    auto task = FileIOTask{.res = {}, .buffer = buf, .block = nullptr};
     io_q.push(&task);
     size_t n_spill = task.res.get_future().get();
     if (n_spill != header->length) {
@@ -724,6 +763,7 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
   struct FileIOTask {
     op_res_promise_t res;
     doca::BorrowedBuffer& buffer;
+    SpillBlock* block;
   };
   BufferPool<doca::Buffers> bp;
   rigtorp::SPSCQueue<FileIOTask*> io_q;
@@ -734,6 +774,8 @@ class BufferredHostSpillWorker : public Worker<Backend::DOCA_Comch> {
   size_t max_n_partition;
   std::vector<PartitionFile> files;
   std::atomic_bool spilling;
+  const Codec* codec = nullptr;  // raw if none is given, every buffer is spilled as one checksummed block
+  SpillBlockPool blocks;         // of the writes in flight, only touched by the io fibers
 };
 
 }  // namespace dpx
@@ -43,6 +43,7 @@ typedef int8_t basic_type_t;
 #define NULL_FLAG ((flag_t)0x1)
 #define ENUM_FLAG ((flag_t)0x2)
 #define REDIRECT_FLAG ((flag_t)0x3)
+#define CODEC_FLAG ((flag_t)0x4)  // host only, laid out by the codec of the class
 
 #define TYPE_FLAG_MASK ((flag_t)0xF0)
 #define OBJECT_FLAG ((flag_t)0x10)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sd/common/basic_type.h"
+#include "sd/common/klass_map.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,10 +14,10 @@ typedef struct {
 
 typedef struct field_info_t {
   class_id_t id;
-  uint16_t offset;    // offset after header
-  basic_type_t type;  // basic type
-  uint16_t flag;      // reserved for flag or annotation
-  uint8_t reserved;
+  uint16_t offset;            // offset after header
+  basic_type_t type;          // basic type
+  uint16_t flag;              // reserved for flag or annotation
+  klass_cache_t klass_cache;  // last hit of the klass map for the member
   uintptr_t j_field_id;
 } field_info_t;
 
@@ -36,6 +37,8 @@ typedef struct class_info_t {
   // uint8_t n_ref_field;
   // uint8_t n_pri_field;
   uint16_t sig_off;
+  uint16_t prim_off;  // primitive fields are packed in [prim_off, prim_off + prim_len) of the body
+  uint16_t prim_len;  // 0 if there is no primitive field or the block is interleaved with references
   field_info_t fields[];
 } class_info_t;
 
@@ -46,10 +49,23 @@ typedef struct class_info_t {
 /* ... meta footer ... */
 
 typedef struct meta_header_t {
-  uint64_t total_length;
+  uint32_t total_length;
+  uint32_t index_offset;  // of the element index of the root array, 0 if there is none
   // uint32_t object_end_offset;
 } meta_header_t;
 
+// NOTICE:
+//  element index of a large root object array, 8 bytes aligned after the last record, so that a reader can revive
+//  ranges of elements without parsing the records before them. offsets[i] is the offset of element i * stride.
+typedef struct element_index_t {
+  uint32_t length;  // of the array
+  uint32_t stride;
+  uint32_t n;
+  uint32_t offsets[];
+} element_index_t;
+
+#define ELEMENT_INDEX_STRIDE 1024
+
 // typedef struct meta_footer_t {
 //   uint32_t n_type;
 //   uint32_t n_instance;
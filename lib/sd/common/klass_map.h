@@ -0,0 +1,108 @@
+#pragma once
+
+#include "sd/common/basic_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NOTICE:
+//  fixed layout open addressing map from compressed klass pointer to class id, shared by the host and the
+//  kernel, so that the host can build it and copy it to the device as is.
+//   | capacity | n | slot 0 | slot 1 | ... | slot capacity - 1 |
+//  capacity is a power of 2 and the map is kept at most half full, so a lookup ends at an empty slot.
+//  the compressed klass pointer 0 is never a valid klass, so it marks an empty slot.
+
+#define KLASS_MAP_EMPTY 0u
+
+typedef struct klass_map_slot_t {
+  uint32_t klass_cptr;
+  class_id_t id;
+  uint16_t reserved;
+} klass_map_slot_t;
+
+typedef struct klass_map_t {
+  uint32_t capacity;
+  uint32_t n;
+  klass_map_slot_t slots[];
+} klass_map_t;
+
+// last hit of a call site, e.g. a reference field, packed as | klass cptr | id | so that it is read and
+// written at once by concurrent walkers
+typedef uint64_t klass_cache_t;
+
+#define KLASS_CACHE_EMPTY 0ull
+
+static inline uint32_t klass_map_capacity_for(uint32_t n) {
+  uint32_t c = 16;
+  while (c < n * 2) {
+    c <<= 1;
+  }
+  return c;
+}
+
+static inline uint64_t klass_map_size(uint32_t capacity) {
+  return sizeof(klass_map_t) + (uint64_t)capacity * sizeof(klass_map_slot_t);
+}
+
+static inline uint32_t klass_map_hash(uint32_t klass_cptr, uint32_t capacity) {
+  // fibonacci hashing, klass pointers are aligned so the low bits carry little entropy
+  return (uint32_t)(((uint64_t)klass_cptr * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+static inline void klass_map_init(klass_map_t *m, uint32_t capacity) {
+  m->capacity = capacity;
+  m->n = 0;
+  for (uint32_t i = 0; i < capacity; i++) {
+    m->slots[i].klass_cptr = KLASS_MAP_EMPTY;
+    m->slots[i].id = UNREGISTERED_CLASS_ID;
+    m->slots[i].reserved = 0;
+  }
+}
+
+// return 0 if the klass exists or the map is half full
+static inline int klass_map_insert(klass_map_t *m, uint32_t klass_cptr, class_id_t id) {
+  if ((m->n + 1) * 2 > m->capacity) {
+    return 0;
+  }
+  uint32_t i = klass_map_hash(klass_cptr, m->capacity);
+  while (m->slots[i].klass_cptr != KLASS_MAP_EMPTY) {
+    if (m->slots[i].klass_cptr == klass_cptr) {
+      return 0;
+    }
+    i = (i + 1) & (m->capacity - 1);
+  }
+  m->slots[i].klass_cptr = klass_cptr;
+  m->slots[i].id = id;
+  m->n++;
+  return 1;
+}
+
+// return UNREGISTERED_CLASS_ID if not found
+static inline class_id_t klass_map_lookup(const klass_map_t *m, uint32_t klass_cptr) {
+  uint32_t i = klass_map_hash(klass_cptr, m->capacity);
+  while (m->slots[i].klass_cptr != KLASS_MAP_EMPTY) {
+    if (m->slots[i].klass_cptr == klass_cptr) {
+      return m->slots[i].id;
+    }
+    i = (i + 1) & (m->capacity - 1);
+  }
+  return UNREGISTERED_CLASS_ID;
+}
+
+// monomorphic call sites hit the cache and skip the probe
+static inline class_id_t klass_map_lookup_cached(const klass_map_t *m, klass_cache_t *c, uint32_t klass_cptr) {
+  klass_cache_t last = __atomic_load_n(c, __ATOMIC_RELAXED);
+  if ((uint32_t)(last >> 32) == klass_cptr) {
+    return (class_id_t)(uint16_t)last;
+  }
+  class_id_t id = klass_map_lookup(m, klass_cptr);
+  if (id != UNREGISTERED_CLASS_ID) {
+    __atomic_store_n(c, ((klass_cache_t)klass_cptr << 32) | (uint16_t)id, __ATOMIC_RELAXED);
+  }
+  return id;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,13 +9,53 @@ extern "C" {
 typedef struct {
   class_info_t **class_infos_by_id;
   uint64_t class_infos_by_id_len;
-  class_info_t **class_infos_by_klass;
-  uint64_t class_infos_by_klass_len;
+  klass_map_t *klass_map;
+  uint64_t klass_map_len;  // in bytes
   void *class_infos_base;
   uint64_t class_infos_lim;
   char __reserved__[16];
 } meta_idx_t;
 
+// NOTICE:
+//  the device copy of the class table is laid out once, for the most classes that fit in the class info region
+//   | class infos | class infos by id | klass map |
+//  so that an export only appends what is registered since the last one, see class_infos_delta_t.
+
+static inline uint64_t meta_max_class_infos(uint64_t class_infos_lim) {
+  // the smallest info is an instance class without field
+  return class_infos_lim / (sizeof(class_info_t) + MAX_SIGNATURE_LENGTH);
+}
+
+static inline uint64_t meta_klass_map_offset(uint64_t class_infos_lim) {
+  return class_infos_lim + meta_max_class_infos(class_infos_lim) * sizeof(uint64_t);
+}
+
+static inline uint64_t meta_size(uint64_t class_infos_lim) {
+  return meta_klass_map_offset(class_infos_lim) +
+         klass_map_size(klass_map_capacity_for(meta_max_class_infos(class_infos_lim)));
+}
+
+// NOTICE:
+//  the classes registered since the last export, as one stream
+//   | class_infos_delta_t | infos | by id offsets | id patches | klass map |
+//  infos are the bytes allocated since the last export, and the offsets are those of the new classes in the
+//  class info region. a patch is a field of an exported class whose class is registered later. the klass map
+//  is sent as a whole, as it is rehashed when it grows.
+typedef struct {
+  uint64_t infos_offset;
+  uint64_t infos_len;
+  uint64_t n_exported;  // classes on the device before the delta
+  uint64_t n_class_infos;
+  uint64_t n_patch;
+  uint64_t klass_map_len;  // in bytes
+} class_infos_delta_t;
+
+typedef struct {
+  uint32_t offset;  // of the id in the class info region
+  class_id_t id;
+  uint16_t reserved;
+} class_id_patch_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,217 @@
+#include "sd/harness/heap_shapes.hxx"
+
+#include <algorithm>
+#include <bit>
+
+namespace dpx::sd {
+
+HeapShapes::HeapShapes(SyntheticHeap &h_) : h(h_), g(42) {
+  using F = SyntheticHeap::Field;
+  object_k = h.define_class("java/lang/Object", {}, false);
+  object_array_k = h.define_array_class(object_k);
+  char_array_k = h.define_array_class(T_CHAR);
+  string_k = h.define_class("java/lang/String", {F{"value", "[C"}, F{"hash", "I"}}, true);
+  string_array_k = h.define_array_class(string_k);
+  integer_k = h.define_class("java/lang/Integer", {F{"value", "I"}}, true);
+  flat_k = h.define_class("synthetic/Flat",
+                          {F{"l0", "J"}, F{"l1", "J"}, F{"d0", "D"}, F{"i0", "I"}, F{"i1", "I"}, F{"f0", "F"},
+                           F{"s0", "S"}, F{"c0", "C"}, F{"b0", "B"}, F{"z0", "Z"}},
+                          true);
+  flat_array_k = h.define_array_class(flat_k);
+  abstract_list_k = h.define_class("java/util/AbstractList", {F{"modCount", "I"}}, false);
+  list_k = h.define_class("java/util/ArrayList", {F{"elementData", "[Ljava/lang/Object;"}, F{"size", "I"}}, false,
+                          abstract_list_k);
+  node_k = h.define_class("java/util/HashMap$Node",
+                          {F{"hash", "I"}, F{"key", "Ljava/lang/Object;"}, F{"value", "Ljava/lang/Object;"},
+                           F{"next", "Ljava/util/HashMap$Node;"}},
+                          false);
+  node_array_k = h.define_array_class(node_k);
+  // interfaces are registered as classes without fields, as InterfaceTypeMapping does
+  h.define_class("java/util/Set", {}, false);
+  h.define_class("java/util/Collection", {}, false);
+  abstract_map_k =
+      h.define_class("java/util/AbstractMap", {F{"keySet", "Ljava/util/Set;"}, F{"values", "Ljava/util/Collection;"}},
+                     false);
+  map_k = h.define_class("java/util/HashMap",
+                         {F{"table", "[Ljava/util/HashMap$Node;"}, F{"size", "I"}, F{"modCount", "I"},
+                          F{"threshold", "I"}, F{"loadFactor", "F"}},
+                         false, abstract_map_k);
+  tree_k = h.define_class("synthetic/Tree",
+                          {F{"value", "I"}, F{"left", "Lsynthetic/Tree;"}, F{"right", "Lsynthetic/Tree;"}}, true);
+
+  string_value_off = h.field_offset(string_k, "value");
+  string_hash_off = h.field_offset(string_k, "hash");
+  integer_value_off = h.field_offset(integer_k, "value");
+  auto cp = flat_k->constant_pool;
+  for (uint32_t i = 0; i < (uint32_t)flat_k->java_fields_count; i++) {
+    auto &f = flat_k->field(i);
+    flat_fields.emplace_back(f.offset(), type_size(f.type(cp)));
+  }
+  list_mod_count_off = h.field_offset(abstract_list_k, "modCount");
+  list_element_data_off = h.field_offset(list_k, "elementData");
+  list_size_off = h.field_offset(list_k, "size");
+  node_hash_off = h.field_offset(node_k, "hash");
+  node_key_off = h.field_offset(node_k, "key");
+  node_value_off = h.field_offset(node_k, "value");
+  node_next_off = h.field_offset(node_k, "next");
+  map_table_off = h.field_offset(map_k, "table");
+  map_size_off = h.field_offset(map_k, "size");
+  map_threshold_off = h.field_offset(map_k, "threshold");
+  map_load_factor_off = h.field_offset(map_k, "loadFactor");
+  tree_value_off = h.field_offset(tree_k, "value");
+  tree_left_off = h.field_offset(tree_k, "left");
+  tree_right_off = h.field_offset(tree_k, "right");
+}
+
+FakeObject *HeapShapes::string(uint32_t length, bool latin1) {
+  auto value = h.new_array(char_array_k, length);
+  auto chars = h.elements<uint16_t>(value);
+  // String.hashCode wraps around, so hash in unsigned
+  uint32_t hash = 0;
+  for (uint32_t i = 0; i < length; i++) {
+    // cjk for the rest, so that the latin-1 check fails somewhere in the middle
+    chars[i] = latin1 || i < length / 2 ? 'a' + g() % 26 : 0x4E00 + g() % 0x5000;
+    hash = 31 * hash + chars[i];
+  }
+  auto s = h.new_object(string_k);
+  h.set_reference(s, string_value_off, value);
+  h.set_field<int32_t>(s, string_hash_off, (int32_t)hash);
+  return s;
+}
+
+FakeObject *HeapShapes::integer(int32_t value) {
+  auto i = h.new_object(integer_k);
+  h.set_field(i, integer_value_off, value);
+  return i;
+}
+
+FakeObject *HeapShapes::tree_node(int32_t value, const FakeObject *left, const FakeObject *right) {
+  auto t = h.new_object(tree_k);
+  h.set_field(t, tree_value_off, value);
+  h.set_reference(t, tree_left_off, left);
+  h.set_reference(t, tree_right_off, right);
+  return t;
+}
+
+FakeObject *HeapShapes::flat_records(uint32_t n) {
+  auto array = h.new_array(flat_array_k, n);
+  for (uint32_t i = 0; i < n; i++) {
+    auto r = h.new_object(flat_k);
+    for (auto [offset, size] : flat_fields) {
+      auto v = g();
+      memcpy(r->raw(offset), &v, size);
+    }
+    h.set_element(array, i, r);
+  }
+  return array;
+}
+
+FakeObject *HeapShapes::strings(uint32_t n, uint32_t length) {
+  auto array = h.new_array(string_array_k, n);
+  for (uint32_t i = 0; i < n; i++) {
+    h.set_element(array, i, string(length));
+  }
+  return array;
+}
+
+FakeObject *HeapShapes::list(uint32_t n, uint32_t length) {
+  // grown by half from 10, the tail is null
+  uint32_t capacity = 10;
+  while (capacity < n) {
+    capacity += capacity >> 1;
+  }
+  auto data = h.new_array(object_array_k, capacity);
+  for (uint32_t i = 0; i < n; i++) {
+    h.set_element(data, i, string(length));
+  }
+  auto l = h.new_object(list_k);
+  h.set_reference(l, list_element_data_off, data);
+  h.set_field<int32_t>(l, list_size_off, n);
+  h.set_field<int32_t>(l, list_mod_count_off, n);
+  return l;
+}
+
+FakeObject *HeapShapes::map(uint32_t n, uint32_t length) {
+  uint32_t capacity = std::bit_ceil(std::max<uint32_t>(16, n * 4 / 3 + 1));
+  auto table = h.new_array(node_array_k, capacity);
+  auto buckets = h.elements<uint32_t>(table);
+  for (uint32_t i = 0; i < n; i++) {
+    auto key = string(length);
+    int32_t hash = key->parse_at<int32_t>(string_hash_off);
+    hash ^= (uint32_t)hash >> 16;
+    auto node = h.new_object(node_k);
+    h.set_field(node, node_hash_off, hash);
+    h.set_reference(node, node_key_off, key);
+    h.set_reference(node, node_value_off, integer(i));
+    // push at the head of the bucket
+    auto &bucket = buckets[hash & (capacity - 1)];
+    node->place_at<uint32_t>(node_next_off, bucket);
+    bucket = JVMArgs::compress_heap_ptr(node);
+  }
+  auto m = h.new_object(map_k);
+  h.set_reference(m, map_table_off, table);
+  h.set_field<int32_t>(m, map_size_off, n);
+  h.set_field<int32_t>(m, map_threshold_off, capacity * 3 / 4);
+  h.set_field<float>(m, map_load_factor_off, 0.75f);
+  return m;
+}
+
+FakeObject *HeapShapes::tree(uint32_t depth) {
+  if (depth == 0) {
+    return nullptr;
+  }
+  auto left = tree(depth - 1);
+  auto right = tree(depth - 1);
+  return tree_node(g(), left, right);
+}
+
+FakeObject *HeapShapes::chain(uint32_t n) {
+  FakeObject *head = nullptr;
+  for (uint32_t i = 0; i < n; i++) {
+    head = tree_node(i, head, nullptr);
+  }
+  return head;
+}
+
+FakeObject *HeapShapes::random(uint32_t n) {
+  auto array = h.new_array(object_array_k, n);
+  for (uint32_t i = 0; i < n; i++) {
+    FakeObject *e = nullptr;
+    switch (g() % 10) {
+      case 0:
+        break;  // null
+      case 1:
+        e = string(g() % 64);
+        break;
+      case 2:
+        e = string(1 + g() % 64, false);
+        break;
+      case 3:
+        e = integer(g());
+        break;
+      case 4:
+        e = flat_records(g() % 8);
+        break;
+      case 5:
+        e = list(g() % 16, g() % 16);
+        break;
+      case 6:
+        e = map(g() % 16, 1 + g() % 16);
+        break;
+      case 7:
+        e = tree(g() % 6);
+        break;
+      case 8:
+        e = chain(g() % 256);
+        break;
+      case 9:
+        // shared with an earlier element, a redirect if references are tracked
+        e = i > 0 ? FakeObject::from_cptr(h.elements<uint32_t>(array)[g() % i]) : nullptr;
+        break;
+    }
+    h.set_element(array, i, e);
+  }
+  return array;
+}
+
+}  // namespace dpx::sd
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "sd/harness/synthetic_heap.hxx"
+
+namespace dpx::sd {
+
+// generators of common shapes on a synthetic heap, the classes mirror their jdk 8 counterparts, including the
+// fields of their super classes.
+class HeapShapes : Noncopyable, Nonmovable {
+ public:
+  explicit HeapShapes(SyntheticHeap &h);
+  ~HeapShapes() = default;
+
+  void register_classes(ClassResolver &r) const { h.register_classes(r); }
+
+  // Flat[] of records with primitive fields only
+  FakeObject *flat_records(uint32_t n);
+  // String[] of ascii strings
+  FakeObject *strings(uint32_t n, uint32_t length);
+  // ArrayList<String>, with the spare capacity of a grown list
+  FakeObject *list(uint32_t n, uint32_t length);
+  // HashMap<String, Integer>, colliding keys are chained
+  FakeObject *map(uint32_t n, uint32_t length);
+  // complete binary Tree of the given depth
+  FakeObject *tree(uint32_t depth);
+  // Tree of n nodes linked by left only, as deep as it gets
+  FakeObject *chain(uint32_t n);
+  // Object[] of n random shapes, with nulls, non latin-1 strings and shared members, for fuzzing
+  FakeObject *random(uint32_t n);
+
+  void seed(uint64_t s) { g.seed(s); }
+
+ private:
+  FakeObject *string(uint32_t length, bool latin1 = true);
+  FakeObject *integer(int32_t value);
+  FakeObject *tree_node(int32_t value, const FakeObject *left, const FakeObject *right);
+
+  SyntheticHeap &h;
+  std::mt19937_64 g;
+
+  const FakeInstanceKlass *object_k;
+  const FakeArrayKlass *object_array_k;
+  const FakeArrayKlass *char_array_k;
+  const FakeInstanceKlass *string_k;
+  const FakeArrayKlass *string_array_k;
+  const FakeInstanceKlass *integer_k;
+  const FakeInstanceKlass *flat_k;
+  const FakeArrayKlass *flat_array_k;
+  const FakeInstanceKlass *abstract_list_k;
+  const FakeInstanceKlass *list_k;
+  const FakeInstanceKlass *node_k;
+  const FakeArrayKlass *node_array_k;
+  const FakeInstanceKlass *abstract_map_k;
+  const FakeInstanceKlass *map_k;
+  const FakeInstanceKlass *tree_k;
+
+  uint32_t string_value_off, string_hash_off;
+  uint32_t integer_value_off;
+  std::vector<std::pair<uint32_t, uint32_t>> flat_fields;  // offset and size
+  uint32_t list_mod_count_off, list_element_data_off, list_size_off;
+  uint32_t node_hash_off, node_key_off, node_value_off, node_next_off;
+  uint32_t map_table_off, map_size_off, map_threshold_off, map_load_factor_off;
+  uint32_t tree_value_off, tree_left_off, tree_right_off;
+};
+
+}  // namespace dpx::sd
@@ -0,0 +1,205 @@
+#include "sd/harness/synthetic_heap.hxx"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <format>
+#include <new>
+
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/upper_align.hxx"
+
+namespace dpx::sd {
+
+namespace {
+
+uint8_t *map_at(uint64_t addr, size_t size) {
+  auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE;
+  auto p = mmap((void *)addr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (p == MAP_FAILED || (uint64_t)p != addr) {
+    die("Fail to map {} bytes at {:X}", size, addr);
+  }
+  return (uint8_t *)p;
+}
+
+uint32_t log2_of(uint32_t x) { return 31 - __builtin_clz(x); }
+
+// see LayoutHelper
+int32_t array_layout_helper(bool is_type_array, basic_type_t elem_type, uint32_t elem_size) {
+  uint32_t tag = is_type_array ? 0xC0 : 0x80;
+  return (int32_t)((tag << 24) | (SyntheticHeap::ARRAY_HEADER_SIZE << 16) | ((uint32_t)elem_type << 8) |
+                   log2_of(elem_size));
+}
+
+}  // namespace
+
+SyntheticHeap::SyntheticHeap(size_t heap_size_, size_t class_space_size_)
+    : class_space_size(class_space_size_), heap_size(heap_size_) {
+  if (CLASS_SPACE_BASE + class_space_size > HEAP_BASE || HEAP_BASE + heap_size > (4_GB << SHIFT)) {
+    die("Synthetic heap of {} bytes is out of the zero based range", heap_size);
+  }
+  class_space = map_at(CLASS_SPACE_BASE, class_space_size);
+  heap = map_at(HEAP_BASE, heap_size);
+  saved_args = JVMArgs::jvm_args;
+  auto &a = JVMArgs::jvm_args;
+  a.h_heap_base = HEAP_BASE;
+  a.h_heap_size = heap_size;
+  a.h_compressed_class_space_base = CLASS_SPACE_BASE;
+  a.h_compressed_class_space_size = class_space_size;
+  a.heap_compress_ptr_mode = JVM_COMPRESS_PTR_MODE_ZERO_BASED;
+  a.metaspace_compress_ptr_mode = JVM_COMPRESS_PTR_MODE_ZERO_BASED;
+  a.heap_compress_ptr_shift = SHIFT;
+  a.metaspace_compress_ptr_shift = SHIFT;
+}
+
+SyntheticHeap::~SyntheticHeap() {
+  JVMArgs::jvm_args = saved_args;
+  munmap(heap, heap_size);
+  munmap(class_space, class_space_size);
+}
+
+void *SyntheticHeap::allocate_metadata(size_t size) {
+  size = upper_align(size, 8);
+  if (class_space_top + size > class_space_size) {
+    die("Synthetic class space is full");
+  }
+  auto p = class_space + class_space_top;
+  class_space_top += size;
+  return memset(p, 0, size);
+}
+
+void *SyntheticHeap::allocate_object(size_t size) {
+  size = upper_align(size, 1 << SHIFT);
+  if (heap_top + size > heap_size) {
+    die("Synthetic heap is full, {} bytes used", heap_top);
+  }
+  auto p = heap + heap_top;
+  heap_top += size;
+  return memset(p, 0, size);
+}
+
+FakeSymbol *SyntheticHeap::new_symbol(std::string_view s) {
+  auto symbol = (FakeSymbol *)allocate_metadata(sizeof(FakeSymbol) + s.length());
+  symbol->length = s.length();
+  symbol->refcount = 1;
+  s.copy(symbol->raw, s.length());
+  return symbol;
+}
+
+const FakeInstanceKlass *SyntheticHeap::define_class(std::string_view name, const std::vector<Field> &fields,
+                                                     bool is_final, const FakeInstanceKlass *super) {
+  auto n = (uint32_t)fields.size();
+  // NOTICE: the default layout of jdk 8, longs and doubles, ints and floats, shorts and chars, bytes and booleans,
+  // then references. a 4 bytes field fills the gap after the header if longs come first. fields of a subclass
+  // start at the aligned end of the super class.
+  std::vector<uint32_t> sizes(n);
+  std::vector<uint32_t> order(n);
+  for (uint32_t i = 0; i < n; i++) {
+    auto t = char2type(fields[i].signature[0]);
+    sizes[i] = type_size(t);
+    order[i] = i;
+  }
+  auto rank = [&](uint32_t i) { return is_reference_type(char2type(fields[i].signature[0])) ? 0 : sizes[i]; };
+  std::ranges::stable_sort(order, std::greater<uint32_t>(), rank);
+  std::vector<uint32_t> offsets(n, 0);
+  uint32_t offset = super != nullptr ? super->lh.object_size() : OBJECT_HEADER_SIZE;
+  if (n > 0 && sizes[order[0]] == 8 && offset % 8 != 0) {
+    if (auto iter = std::ranges::find_if(order, [&](uint32_t i) { return rank(i) == 4; }); iter != order.end()) {
+      offsets[*iter] = offset;
+      offset += 4;
+    }
+  }
+  for (auto i : order) {
+    if (offsets[i] != 0) {
+      continue;
+    }
+    offset = upper_align(offset, sizes[i]);
+    offsets[i] = offset;
+    offset += sizes[i];
+  }
+
+  auto cp = (FakeConstantPool *)allocate_metadata(sizeof(FakeConstantPool) + (1 + 2 * n) * sizeof(FakeSymbol *));
+  cp->length = 1 + 2 * n;
+  auto infos = (FakeFieldInfoArray *)allocate_metadata(sizeof(FakeFieldInfoArray) + n * sizeof(FakeFieldInfo));
+  infos->length = n * sizeof(FakeFieldInfo) / sizeof(uint16_t);
+  for (uint32_t i = 0; i < n; i++) {
+    cp->symbol_array[1 + 2 * i] = new_symbol(fields[i].name);
+    cp->symbol_array[2 + 2 * i] = new_symbol(fields[i].signature);
+    auto &f = infos->infos[i];
+    f.access_flags = JVM_ACC_PRIVATE;
+    f.name_index_offset = 1 + 2 * i;
+    f.signature_index_offset = 2 + 2 * i;
+    // see FakeFieldInfo::offset
+    uint32_t packed = (offsets[i] << 2) | 1;
+    f.low_packed_offset = packed & 0xFFFF;
+    f.high_packed_offset = packed >> 16;
+  }
+
+  auto klass = new (allocate_metadata(sizeof(FakeInstanceKlass))) FakeInstanceKlass();
+  klass->lh.lh = upper_align(offset, 8);
+  klass->symbol = new_symbol(name);
+  klass->super = const_cast<FakeInstanceKlass *>(super);
+  klass->constant_pool = cp;
+  klass->java_fields_count = n;
+  klass->field_info_array = infos;
+  klasses.emplace_back(klass, is_final);
+  TRACE("define {} with {} fields, size: {}", name, n, klass->lh.object_size());
+  return klass;
+}
+
+const FakeArrayKlass *SyntheticHeap::define_array_class(basic_type_t elem_type) {
+  assert(is_primitive_type(elem_type));
+  auto klass = new (allocate_metadata(sizeof(FakeTypeArrayKlass))) FakeTypeArrayKlass();
+  klass->lh.lh = array_layout_helper(true, elem_type, type_size(elem_type));
+  klass->symbol = new_symbol(std::string("[") + type2sig(elem_type));
+  klass->dimension = 1;
+  klass->max_length = INT32_MAX;
+  klasses.emplace_back(klass, true);
+  return klass;
+}
+
+const FakeArrayKlass *SyntheticHeap::define_array_class(const FakeInstanceKlass *elem_klass) {
+  auto klass = new (allocate_metadata(sizeof(FakeObjectArrayKlass))) FakeObjectArrayKlass();
+  klass->lh.lh = array_layout_helper(false, T_OBJECT, sizeof(uint32_t));
+  klass->symbol = new_symbol(std::format("[L{};", elem_klass->signature()));
+  klass->dimension = 1;
+  klass->element_klass = const_cast<FakeInstanceKlass *>(elem_klass);
+  klass->bottom_klass = klass->element_klass;
+  // finality follows the element, see ClassWalker::walk_array_klass
+  klasses.emplace_back(klass, false);
+  return klass;
+}
+
+void SyntheticHeap::register_classes(ClassResolver &r) const {
+  for (auto [klass, is_final] : klasses) {
+    r.register_class(klass, is_final);
+  }
+}
+
+uint32_t SyntheticHeap::field_offset(const FakeInstanceKlass *klass, std::string_view name) const {
+  auto cp = klass->constant_pool;
+  for (uint32_t i = 0; i < (uint32_t)klass->java_fields_count; i++) {
+    if (klass->field(i).name_view(cp) == name) {
+      return klass->field(i).offset();
+    }
+  }
+  die("{} has no field {}", klass->signature(), name);
+}
+
+FakeObject *SyntheticHeap::new_object(const FakeInstanceKlass *klass) {
+  auto obj = (FakeObject *)allocate_object(klass->lh.object_size());
+  obj->mark = 1;  // unlocked
+  obj->place_at<uint32_t>(sizeof(FakeObject), JVMArgs::compress_metaspace_ptr(klass));
+  return obj;
+}
+
+FakeObject *SyntheticHeap::new_array(const FakeArrayKlass *klass, uint32_t length) {
+  auto obj = (FakeObject *)allocate_object(ARRAY_HEADER_SIZE + (uint64_t)length * klass->lh.element_size());
+  obj->mark = 1;
+  obj->place_at<uint32_t>(sizeof(FakeObject), JVMArgs::compress_metaspace_ptr(klass));
+  obj->place_at<uint32_t>(ARRAY_HEADER_SIZE - sizeof(uint32_t), length);
+  return obj;
+}
+
+}  // namespace dpx::sd
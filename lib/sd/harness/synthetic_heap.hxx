@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "sd/common/args.h"
+#include "sd/native/class_resolver.hxx"
+#include "sd/native/fake.hxx"
+#include "util/literal.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+
+namespace dpx::sd {
+
+// NOTICE:
+//  a hotspot shaped heap in plain memory, so that the walker can be benchmarked and fuzzed without a jvm.
+//  klasses, symbols, constant pools and field infos are laid out as the fake structs read them, objects have
+//  a mark word and a compressed klass pointer, and references are compressed oops.
+//  both spaces are mapped at fixed addresses below 32 GB, so that the zero based modes of jdk 8 apply:
+//   | ... | class space at CLASS_SPACE_BASE | ... | heap at HEAP_BASE | ... |
+//  the heap takes over JVMArgs::jvm_args while it lives, so never mix it with a live jvm in one process.
+class SyntheticHeap : Noncopyable, Nonmovable {
+ public:
+  struct Field {
+    std::string name;
+    std::string signature;  // field descriptor, e.g. I, [C or Ljava/lang/String;
+  };
+
+  constexpr static uint64_t CLASS_SPACE_BASE = 8_GB;
+  constexpr static uint64_t HEAP_BASE = 16_GB;
+  constexpr static uint32_t SHIFT = 3;
+  constexpr static uint32_t OBJECT_HEADER_SIZE = 12;  // mark and compressed klass pointer
+  constexpr static uint32_t ARRAY_HEADER_SIZE = 16;   // and length
+
+  explicit SyntheticHeap(size_t heap_size, size_t class_space_size = 16_MB);
+  ~SyntheticHeap();
+
+  // name is in internal form, e.g. java/lang/String, fields are laid out as hotspot does by default, after those of
+  // the super class if any
+  const FakeInstanceKlass *define_class(std::string_view name, const std::vector<Field> &fields, bool is_final,
+                                        const FakeInstanceKlass *super = nullptr);
+  const FakeArrayKlass *define_array_class(basic_type_t elem_type);
+  const FakeArrayKlass *define_array_class(const FakeInstanceKlass *elem_klass);
+  // in definition order, so define elements before their arrays
+  void register_classes(ClassResolver &r) const;
+  // offset from the object base, die if absent
+  uint32_t field_offset(const FakeInstanceKlass *klass, std::string_view name) const;
+
+  FakeObject *new_object(const FakeInstanceKlass *klass);
+  FakeObject *new_array(const FakeArrayKlass *klass, uint32_t length);
+
+  template <typename T>
+  void set_field(FakeObject *obj, uint32_t offset, T value) {
+    obj->place_at(offset, value);
+  }
+  void set_reference(FakeObject *obj, uint32_t offset, const FakeObject *member) {
+    obj->place_at<uint32_t>(offset, member != nullptr ? JVMArgs::compress_heap_ptr(member) : 0);
+  }
+  void set_element(FakeObject *array, uint32_t i, const FakeObject *member) {
+    set_reference(array, ARRAY_HEADER_SIZE + i * sizeof(uint32_t), member);
+  }
+  template <typename T>
+  T *elements(FakeObject *array) {
+    return (T *)array->raw(ARRAY_HEADER_SIZE);
+  }
+
+  // drop all objects and keep the classes
+  void clear_objects() { heap_top = 0; }
+  size_t heap_used() const { return heap_top; }
+
+ private:
+  void *allocate_metadata(size_t size);
+  void *allocate_object(size_t size);
+  FakeSymbol *new_symbol(std::string_view s);
+
+  uint8_t *class_space;
+  size_t class_space_size;
+  size_t class_space_top = 0;
+  uint8_t *heap;
+  size_t heap_size;
+  size_t heap_top = 0;
+  std::vector<std::pair<const FakeKlass *, bool>> klasses;  // with finality, in definition order
+  jvm_args_t saved_args;
+};
+
+}  // namespace dpx::sd
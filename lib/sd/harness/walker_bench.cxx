@@ -0,0 +1,321 @@
+#include <args.hxx>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "sd/harness/heap_shapes.hxx"
+#include "sd/native/chunked_buffer.hxx"
+#include "sd/native/key_hasher.hxx"
+#include "sd/native/object_walker.hxx"
+#include "sd/native/parallel_walker.hxx"
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+args::ArgumentParser p("DPX Object Walker Benchmark on Synthetic Heaps");
+args::HelpFlag help(p, "help", "display this help menu", {'h', "help"});
+args::ValueFlag<std::string> shape(p, "shape", "flat, strings, list, map, tree, chain or random", {"shape"}, "flat");
+args::ValueFlag<uint32_t> n(p, "n", "n records, nodes or entries", {"n"}, 1 << 16);
+args::ValueFlag<uint32_t> length(p, "length", "string length", {"length"}, 16);
+args::ValueFlag<uint32_t> depth(p, "depth", "tree depth", {"depth"}, 16);
+args::ValueFlag<uint32_t> n_round(p, "n round", "n walks of the same root", {"n_round"}, 100);
+args::ValueFlag<uint32_t> n_case(p, "n case", "n random roots to fuzz, only for the random shape", {"n_case"}, 1);
+args::ValueFlag<uint64_t> seed(p, "seed", "seed of the first case", {"seed"}, 42);
+args::ValueFlag<size_t> heap_size(p, "heap size", "synthetic heap size in MB", {"heap_size"}, 1024);
+args::ValueFlag<uint32_t> n_thread(p, "n thread", "also walk root arrays on n threads and compare", {"n_thread"}, 1);
+args::ValueFlag<uint32_t> min_parallel(p, "min parallel", "min root array length to walk on threads",
+                                       {"min_parallel"}, 1 << 16);
+args::Flag compact(p, "compact", "use the compact format", {"compact"});
+args::Flag track_references(p, "track references", "track shared references", {"track_references"});
+args::Flag latin1(p, "latin1", "store latin-1 char arrays as bytes", {"latin1"});
+args::Flag utf8(p, "utf8", "convert char arrays to utf-8", {"utf8"});
+args::Flag element_index(p, "element index", "end large root arrays with an element index", {"index"});
+args::Flag codecs(p, "codecs", "lay out strings and boxes by hand", {"codecs"});
+args::ValueFlag<size_t> chunk_size(p, "chunk size", "output chunk size in bytes, small to cross chunks often",
+                                   {"chunk_size"}, 4096);
+
+void parse_args(int argc, char* argv[]) {
+  try {
+    p.ParseCLI(argc, argv);
+  } catch (args::Help) {
+    std::cout << p;
+    exit(0);
+  } catch (args::ParseError e) {
+    std::cerr << e.what() << std::endl << p;
+    exit(1);
+  }
+}
+
+using namespace dpx::sd;
+
+// the chunks laid end to end must be the flat output
+bool same_bytes(const dpx::ChunkedBuffer& out, const std::vector<uint8_t>& flat, size_t total_length) {
+  if (out.offset() != total_length) {
+    return false;
+  }
+  size_t off = 0;
+  for (auto& v : out.iovecs()) {
+    if (memcmp(v.iov_base, flat.data() + off, v.iov_len) != 0) {
+      return false;
+    }
+    off += v.iov_len;
+  }
+  return off == total_length;
+}
+
+// entries must be in order, inside the records, and one per stride
+void check_index(const std::vector<uint8_t>& b, const FakeObject* root, ClassResolver& r, const Options& o) {
+  auto header = (const meta_header_t*)b.data();
+  if (!ObjectWalker::has_element_index(root, r, o)) {
+    if (header->index_offset != 0) {
+      die("Unexpected element index at {}", header->index_offset);
+    }
+    return;
+  }
+  auto index = (const element_index_t*)(b.data() + header->index_offset);
+  auto info = r.get_class_info(root->klass_cptr());
+  if (index->length != root->array_length(info.array_header_size()) ||
+      index->n != (index->length + index->stride - 1) / index->stride) {
+    die("Mismatched element index of {} entries for {} elements", index->n, index->length);
+  }
+  for (uint32_t i = 0; i < index->n; i++) {
+    if (index->offsets[i] >= header->index_offset || (i > 0 && index->offsets[i] <= index->offsets[i - 1])) {
+      die("Corrupted element index entry {} at {}", i, index->offsets[i]);
+    }
+  }
+}
+
+// hashCode in java of the strings, integers and arrays of them on the synthetic heap, none for the rest
+std::optional<int32_t> expected_hash(const FakeObject* obj, const ClassResolver& r) {
+  if (obj == nullptr) {
+    return 0;
+  }
+  auto info = r.get_class_info(obj->klass_cptr());
+  auto& plan = r.get_class_plan(info.id());
+  uint32_t h = 0;
+  if (info.is_array()) {
+    // only object arrays are reachable from the roots
+    h = 1;
+    for (uint32_t i = 0; i < obj->array_length(info.array_header_size()); i++) {
+      auto e = expected_hash(obj->array_elem_ref(info.array_header_size(), i), r);
+      if (!e.has_value()) {
+        return std::nullopt;
+      }
+      h = 31 * h + *e;
+    }
+  } else if (plan.codec == ClassPlan::BOX_CODEC) {
+    h = obj->parse_at<int32_t>(info.object_header_size() + plan.codec_offset);
+  } else if (info.signature() == "Ljava/lang/String;") {
+    auto value = obj->reference_at(info.object_header_size() + plan.refs[0].offset);
+    for (uint32_t i = 0; i < value->array_length(value->array_header_size()); i++) {
+      h = 31 * h + value->array_elem_at<uint16_t>(value->array_header_size(), i);
+    }
+  } else {
+    return std::nullopt;
+  }
+  return h;
+}
+
+// the key hasher must agree with the heap on the elements of a root array, including those past the index
+void check_hashes(const std::vector<uint8_t>& b, const FakeObject* root, ClassResolver& r, const Options& o,
+                  Off2Id& off2id) {
+  auto info = r.get_class_info(root->klass_cptr());
+  if (!info.is_array() || !is_reference_type(info.get_field(0).type)) {
+    return;
+  }
+  auto in = dpx::naive::BorrowedBuffer(const_cast<uint8_t*>(b.data()), b.size());
+  uint32_t length = root->array_length(info.array_header_size());
+  for (uint32_t i = 0; i < length; i = i < 64 ? i + 1 : i * 2 + 1) {
+    uint32_t path[] = {i};
+    auto h = KeyHasher::hash(r, o, path, in, &off2id);
+    auto expected = expected_hash(root->array_elem_ref(info.array_header_size(), i), r);
+    if (h != expected) {
+      die("Mismatched hash of element {}, {} != {}", i, h.value_or(-1), expected.value_or(-1));
+    }
+  }
+}
+
+// the device table rebuilt from the deltas as the kernel does must match the resolver, including a field of an
+// exported class and its inherited copy in a subclass, which are resolved by a later registration
+void check_class_infos_delta(SyntheticHeap& h, ClassResolver& r, const Options& o) {
+  auto lim = o.max_class_info_size;
+  std::vector<uint64_t> table((meta_size(lim) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+  auto base = (uint8_t*)table.data();
+  auto by_id = (uint64_t*)(base + lim);
+  auto m = (const klass_map_t*)(base + meta_klass_map_offset(lim));
+  uint64_t n = 0;
+  auto apply = [&]() {
+    auto stream = r.take_class_infos_delta();
+    if (stream.empty()) {
+      return false;
+    }
+    auto p = stream.data();
+    auto delta = (const class_infos_delta_t*)p;
+    if (delta->n_exported != n || delta->infos_offset + delta->infos_len > lim) {
+      die("Corrupted class infos delta after {} classes", n);
+    }
+    p += sizeof(class_infos_delta_t);
+    memcpy(base + delta->infos_offset, p, delta->infos_len);
+    p += delta->infos_len;
+    memcpy(by_id + n, p, delta->n_class_infos * sizeof(uint64_t));
+    p += delta->n_class_infos * sizeof(uint64_t);
+    for (uint64_t i = 0; i < delta->n_patch; i++) {
+      auto patch = (const class_id_patch_t*)p;
+      *(class_id_t*)(base + patch->offset) = patch->id;
+      p += sizeof(class_id_patch_t);
+    }
+    memcpy((void*)m, p, delta->klass_map_len);
+    n += delta->n_class_infos;
+    return true;
+  };
+  auto check = [&]() {
+    for (uint64_t i = 0; i < n; i++) {
+      auto info = r.get_class_info((class_id_t)(i + MIN_CLASS_ID));
+      auto size = info.i->sig_off + info.signature().size() + 1;
+      if (memcmp(base + by_id[i], info.i, size) != 0 || klass_map_lookup(m, info.klass_cptr()) != info.id()) {
+        die("Mismatched class info of {} on the device", info.signature());
+      }
+    }
+  };
+
+  if (!apply() || apply()) {
+    die("Expect one delta of the registered classes");
+  }
+  check();
+  using F = SyntheticHeap::Field;
+  auto late = h.define_class("synthetic/Late", {F{"next", "Lsynthetic/Later;"}}, true);
+  r.register_class(late, true);
+  auto late_child = h.define_class("synthetic/LateChild", {F{"value", "J"}}, true, late);
+  r.register_class(late_child, true);
+  apply();
+  check();
+  auto later = h.define_class("synthetic/Later", {F{"value", "I"}}, true);
+  r.register_class(later, true);
+  apply();
+  check();
+  auto child_info = r.get_class_info(late_child);
+  if (n != r.get_class_info(later).id() - MIN_CLASS_ID + 1uz ||
+      r.get_class_info(late).get_field(0).id != r.get_class_info(later).id() ||
+      child_info.n_non_static_field() != 2 || child_info.get_field(0).id != r.get_class_info(later).id() ||
+      child_info.object_header_size() + child_info.get_field(0).offset != h.field_offset(late, "next")) {
+    die("Mismatched late classes");
+  }
+}
+
+FakeObject* build(HeapShapes& s) {
+  auto& name = args::get(shape);
+  if (name == "flat") {
+    return s.flat_records(args::get(n));
+  } else if (name == "strings") {
+    return s.strings(args::get(n), args::get(length));
+  } else if (name == "list") {
+    return s.list(args::get(n), args::get(length));
+  } else if (name == "map") {
+    return s.map(args::get(n), args::get(length));
+  } else if (name == "tree") {
+    return s.tree(args::get(depth));
+  } else if (name == "chain") {
+    return s.chain(args::get(n));
+  } else if (name == "random") {
+    return s.random(args::get(n));
+  }
+  die("Unknown shape {}", name);
+}
+
+int main(int argc, char* argv[]) {
+  parse_args(argc, argv);
+  Options o;
+  o.compact_format = compact;
+  o.track_references = track_references;
+  o.enable_latin1_chars = latin1;
+  o.enable_utf16_to_utf8 = utf8;
+  o.index_large_arrays = element_index;
+  o.enable_codecs = codecs;
+  o.max_class_info_size = 1_MB;
+  o.max_host_threads = args::get(n_thread);
+  o.min_parallel_array_length = args::get(min_parallel);
+  o.out_chunk_size = args::get(chunk_size);
+
+  SyntheticHeap h(args::get(heap_size) * 1_MB);
+  HeapShapes s(h);
+  ClassResolver r(o);
+  s.register_classes(r);
+  check_class_infos_delta(h, r, o);
+  dpx::ChunkPool chunk_pool(o.out_chunk_size, 2 * o.max_host_threads);
+  HostPool hosts(o.max_host_threads);
+  std::unique_ptr<ParallelWalker> pw;
+  if (o.max_host_threads > 1) {
+    pw = std::make_unique<ParallelWalker>(r, o, chunk_pool, hosts);
+  }
+  Ref2Off ref2off;
+  Off2Id off2id;
+  std::vector<uint8_t> ctx(o.max_task_ctx_buffer_size);
+  dpx::ChunkedBuffer out(chunk_pool);
+  std::vector<uint8_t> check;
+
+  for (uint32_t c = 0; c < args::get(n_case); c++) {
+    h.clear_objects();
+    s.seed(args::get(seed) + c);
+    auto root = build(s);
+    // a record is at most twice its object, e.g. a null element takes 8 bytes instead of 4
+    check.assign(h.heap_used() * 2 + 4_KB, 0);
+    auto walk = [&](dpx::ChunkedBuffer& b) {
+      return ObjectWalker::walk(root, r, o, dpx::naive::BorrowedBuffer(ctx.data(), ctx.size()), b, &ref2off);
+    };
+    // the output must be deterministic and in bounds, so that fuzzing catches layout bugs without a reviver.
+    // the flat walk dies on overflow, the chunked one must lay out the same bytes across chunk boundaries
+    dpx::ChunkedBuffer flat(dpx::naive::BorrowedBuffer(check.data(), check.size()));
+    auto total_length = walk(flat);
+    check_index(check, root, r, o);
+    check_hashes(check, root, r, o, off2id);
+    dpx::Timer t;
+    for (uint32_t i = 0; i < args::get(n_round); i++) {
+      if (walk(out) != total_length) {
+        die("Case {} mismatched length", c);
+      }
+    }
+    auto elapsed_ns = t.elapsed_ns();
+    if (!same_bytes(out, check, total_length)) {
+      die("Case {} mismatched output", c);
+    }
+    // in place as Context::serialize_to, half the output spills to chunks, and the exact length gets it back to back
+    for (auto capacity : {total_length / 2, total_length}) {
+      std::vector<uint8_t> dst(capacity);
+      dpx::ChunkedBuffer in_place(dpx::naive::BorrowedBuffer(dst.data(), dst.size()), chunk_pool);
+      if (walk(in_place) != total_length || !same_bytes(in_place, check, total_length)) {
+        die("Case {} mismatched output in place of {} bytes", c, capacity);
+      }
+      if (capacity == total_length) {
+        in_place.copy_to(dst.data());
+        if (memcmp(dst.data(), check.data(), total_length) != 0) {
+          die("Case {} mismatched output copied back in place", c);
+        }
+      }
+    }
+    INFO("{} case {}: heap {} bytes, output {} bytes in {} chunks, {:.2f} us/walk, {:.2f} MB/s", args::get(shape), c,
+         h.heap_used(), total_length, out.iovecs().size(), elapsed_ns / 1e3 / args::get(n_round),
+         (double)total_length * args::get(n_round) / elapsed_ns * 1e3);
+    // the parallel walk must lay out the same bytes
+    if (pw == nullptr || !ParallelWalker::accept(root, r, o)) {
+      continue;
+    }
+    // poison the output, so that bytes left unwritten do not match by chance
+    for (auto& v : out.iovecs()) {
+      memset(v.iov_base, 0xFF, v.iov_len);
+    }
+    t.reset();
+    for (uint32_t i = 0; i < args::get(n_round); i++) {
+      if (pw->walk(root, out) != total_length) {
+        die("Case {} mismatched length on {} threads", c, o.max_host_threads);
+      }
+    }
+    auto parallel_elapsed_ns = t.elapsed_ns();
+    if (!same_bytes(out, check, total_length)) {
+      die("Case {} mismatched output on {} threads", c, o.max_host_threads);
+    }
+    INFO("{} case {}: {} threads, {:.2f} us/walk, {:.2f}x", args::get(shape), c, o.max_host_threads,
+         parallel_elapsed_ns / 1e3 / args::get(n_round), (double)elapsed_ns / parallel_elapsed_ns);
+  }
+  return 0;
+}
@@ -30,26 +30,23 @@ typedef struct {
 } se_task_ctx_t;
 
 // meta
-UNUSED __forceinline class_info_t *get_class_info_by_klass(void *klass) {
-  LOG_DBG("search %lX", (uint64_t)klass);
-  uint32_t l = 0;
-  uint32_t r = meta_idx.class_infos_by_klass_len;
-  uint32_t m = 0;
-  class_info_t *info = 0;
-  LOG_DBG("%d %d", l, r);
-  while (l < r) {
-    m = (r - l) / 2 + l;
-    info = meta_idx.class_infos_by_klass[m];
-    if (info->klass == klass) {
-      return info;
-    } else if (info->klass < klass) {
-      l = m + 1;
-    } else {
-      r = m;
-    }
+__forceinline class_info_t *get_class_info_by_id(class_id_t id) {
+  return meta_idx.class_infos_by_id[id - MIN_CLASS_ID];
+}
+
+// cache is the last hit of the call site, 0 for the root object
+UNUSED __forceinline class_info_t *
+get_class_info_by_klass_cptr(uint32_t klass_cptr, klass_cache_t *cache) {
+  LOG_DBG("search %X", klass_cptr);
+  class_id_t id =
+      cache != 0
+          ? klass_map_lookup_cached(meta_idx.klass_map, cache, klass_cptr)
+          : klass_map_lookup(meta_idx.klass_map, klass_cptr);
+  if (id == UNREGISTERED_CLASS_ID) {
+    UNREACHABLE_CRIT;
+    return 0;
   }
-  UNREACHABLE_CRIT;
-  return 0;
+  return get_class_info_by_id(id);
 }
 
 UNUSED __forceinline uint64_t get_enum(class_info_t *info, uint32_t ordinal) {
@@ -68,11 +65,13 @@ __forceinline void show_class_infos(void) {
     class_info_t *info = meta_idx.class_infos_by_id[i];
     LOG_INFO("%d %s", info->id, ((const char *)(info) + info->sig_off));
   }
-  LOG_INFO("sorted by klass, %ld", meta_idx.class_infos_by_klass_len);
-  for (uint32_t i = 0; i < meta_idx.class_infos_by_klass_len; i++) {
-    class_info_t *info = meta_idx.class_infos_by_klass[i];
-    LOG_INFO("%lX %s", (uint64_t)info->klass,
-             ((const char *)(info) + info->sig_off));
+  LOG_INFO("klass map, %d in %d slots", meta_idx.klass_map->n,
+           meta_idx.klass_map->capacity);
+  for (uint32_t i = 0; i < meta_idx.klass_map->capacity; i++) {
+    klass_map_slot_t *slot = &meta_idx.klass_map->slots[i];
+    if (slot->klass_cptr != KLASS_MAP_EMPTY) {
+      LOG_INFO("%X %d", slot->klass_cptr, slot->id);
+    }
   }
 }
 
@@ -163,6 +162,9 @@ UNUSED __forceinline uint32_t compress_metaspace_ptr(uint64_t ptr) {
 UNUSED __forceinline void *get_klass_pointer(void *d_object) {
   return parse_metaspace_cptr(parse_u32_at(d_object, sizeof(uint64_t)));
 }
+__forceinline uint32_t get_klass_cptr(void *d_object) {
+  return parse_u32_at(d_object, sizeof(uint64_t));
+}
 static uint32_t get_enum_ordinal(void *d_object) {
   return parse_u32_at(d_object, sizeof(uint64_t) + sizeof(uint32_t));
 }
@@ -316,7 +318,8 @@ __forceinline void fill_next_align_8(buffer_t *b) {
 // forward declaration
 __forceinline uint32_t _do_serialize_recur(se_task_ctx_t *ctx,
                                            uint64_t h_object,
-                                           class_id_t expected_id);
+                                           class_id_t expected_id,
+                                           klass_cache_t *cache);
 
 __forceinline void _do_serialize_object(se_task_ctx_t *ctx, uint64_t h_object,
                                         class_info_t *info) {
@@ -336,14 +339,15 @@ __forceinline void _do_serialize_object(se_task_ctx_t *ctx, uint64_t h_object,
   // TICK2;
   // PRINT_TICK(2);
   for (uint32_t i = 0; i < info->n_non_static_field; i++) {
-    const field_info_t *f = &info->fields[i];
+    field_info_t *f = &info->fields[i];
     if (is_primitive_type(f->type)) {
       continue;
     }
     uint32_t f_offset = obj_base + f->offset;
     uint32_t h_member_cptr = get_u32_at(&ctx->outbuf, f_offset);
     uint64_t h_member = (uint64_t)parse_heap_cptr(h_member_cptr);
-    uint32_t member_offset = _do_serialize_recur(ctx, h_member, f->id);
+    uint32_t member_offset =
+        _do_serialize_recur(ctx, h_member, f->id, &f->klass_cache);
     put_u32_at(&ctx->outbuf, member_offset, f_offset);
   }
 }
@@ -364,12 +368,13 @@ __forceinline void _do_serialize_array(se_task_ctx_t *ctx, uint64_t h_array,
   // put_u64(&ctx->outbuf, u64);
   fill_next_align_8(&ctx->outbuf);
   // TICK1;
-  const field_info_t *elem = &info->fields[0];
+  field_info_t *elem = &info->fields[0];
   if (is_reference_type(elem->type)) {
     for (uint32_t i = 0; i < length; i++) {
       uint32_t h_elem_cptr = get_array_elem_cptr(d_array, info->header_size, i);
       uint64_t h_elem = (uint64_t)parse_heap_cptr(h_elem_cptr);
-      uint32_t elem_offset UNUSED = _do_serialize_recur(ctx, h_elem, elem->id);
+      uint32_t elem_offset UNUSED =
+          _do_serialize_recur(ctx, h_elem, elem->id, &elem->klass_cache);
     }
   } else if (is_primitive_type(elem->type)) {
     const char *d_src = (const char *)d_array + info->header_size;
@@ -382,7 +387,8 @@ __forceinline void _do_serialize_array(se_task_ctx_t *ctx, uint64_t h_array,
 
 __forceinline uint32_t _do_serialize_recur(se_task_ctx_t *ctx,
                                            uint64_t h_object,
-                                           class_id_t expected_id) {
+                                           class_id_t expected_id,
+                                           klass_cache_t *cache) {
   LOG_DBG("_do_serialize_recur");
   // TICK0;
   fill_next_align_8(&ctx->outbuf);
@@ -413,7 +419,8 @@ __forceinline uint32_t _do_serialize_recur(se_task_ctx_t *ctx,
   void *d_object = h2d(h_object);
   // TICK2;
   // check resovled
-  class_info_t *info = get_class_info_by_klass(get_klass_pointer(d_object));
+  class_info_t *info =
+      get_class_info_by_klass_cptr(get_klass_cptr(d_object), cache);
   // TICK3;
   // int ok = map_insert(&ctx->ref2off, h_object, base);
   // if (!ok) {
@@ -445,9 +452,10 @@ __forceinline uint32_t _do_serialize_recur(se_task_ctx_t *ctx,
 __forceinline uint64_t _do_serialize(se_task_ctx_t *ctx, uint64_t h_object) {
   LOG_DBG("_do_serialize");
 
-  _do_serialize_recur(ctx, h_object, UNREGISTERED_CLASS_ID);
+  _do_serialize_recur(ctx, h_object, UNREGISTERED_CLASS_ID, 0);
   meta_header_t *header = (meta_header_t *)(ctx->outbuf.p);
   header->total_length = ctx->outbuf.cur_p - ctx->outbuf.p;
+  header->index_offset = 0;
   return header->total_length;
 }
 
@@ -519,50 +527,52 @@ __forceinline void comch_prod_comp(dpa_thread_args_t *p) {
 
 // RPCs
 
+// apply a class_infos_delta_t, the table is laid out by the first one, see meta_size
 __dpa_rpc__ static uint64_t
-register_class_infos(doca_dpa_dev_uintptr_t dev_class_infos_p,
-                     doca_dpa_dev_mmap_t host_class_infos_h,
-                     doca_dpa_dev_uintptr_t host_class_infos_base,
-                     uint64_t class_infos_len, uint64_t n_class_infos,
-                     doca_dpa_dev_mmap_t host_by_id_offsets_h,
-                     doca_dpa_dev_uintptr_t host_by_id_offsets_base,
-                     doca_dpa_dev_mmap_t host_by_klass_offsets_h,
-                     doca_dpa_dev_uintptr_t host_by_klass_offsets_base) {
-  uint64_t offsets_length = n_class_infos * sizeof(uint64_t);
-
-  meta_idx.class_infos_base = (void *)dev_class_infos_p;
-  meta_idx.class_infos_lim = class_infos_len;
-  meta_idx.class_infos_by_id =
-      (class_info_t **)(dev_class_infos_p + class_infos_len);
-  meta_idx.class_infos_by_id_len = n_class_infos;
-  meta_idx.class_infos_by_klass =
-      (class_info_t **)(dev_class_infos_p + class_infos_len + offsets_length);
-  meta_idx.class_infos_by_klass_len = n_class_infos;
-
-  uint8_t *host_class_infos_base_ptr =
-      (uint8_t *)doca_dpa_dev_mmap_get_external_ptr(host_class_infos_h,
-                                                    host_class_infos_base);
-  d_memcpy(meta_idx.class_infos_base, host_class_infos_base_ptr,
-           class_infos_len);
-  uint64_t *host_by_id_offsets_base_ptr =
-      (uint64_t *)doca_dpa_dev_mmap_get_external_ptr(host_by_id_offsets_h,
-                                                     host_by_id_offsets_base);
-  d_memcpy(meta_idx.class_infos_by_id, host_by_id_offsets_base_ptr,
-           offsets_length);
-  uint64_t *host_by_klass_offsets_base_ptr =
-      (uint64_t *)doca_dpa_dev_mmap_get_external_ptr(
-          host_by_klass_offsets_h, host_by_klass_offsets_base);
-  d_memcpy(meta_idx.class_infos_by_klass, host_by_klass_offsets_base_ptr,
-           offsets_length);
-
-  for (uint32_t i = 0; i < n_class_infos; i++) {
-    LOG_DBG("%lX %lX", (uintptr_t)meta_idx.class_infos_by_id[i],
-            (uintptr_t)meta_idx.class_infos_by_klass[i]);
+append_class_infos(doca_dpa_dev_uintptr_t dev_class_infos_p,
+                   uint64_t class_infos_lim, doca_dpa_dev_mmap_t host_delta_h,
+                   doca_dpa_dev_uintptr_t host_delta_base) {
+  uint8_t *host_delta_ptr = (uint8_t *)doca_dpa_dev_mmap_get_external_ptr(
+      host_delta_h, host_delta_base);
+  class_infos_delta_t delta;
+  d_memcpy(&delta, host_delta_ptr, sizeof(delta));
+  host_delta_ptr += sizeof(delta);
+
+  if (delta.n_exported == 0) {
+    meta_idx.class_infos_base = (void *)dev_class_infos_p;
+    meta_idx.class_infos_lim = class_infos_lim;
+    meta_idx.class_infos_by_id =
+        (class_info_t **)(dev_class_infos_p + class_infos_lim);
+    meta_idx.class_infos_by_id_len = 0;
+    meta_idx.klass_map =
+        (klass_map_t *)(dev_class_infos_p +
+                        meta_klass_map_offset(class_infos_lim));
+  }
+
+  d_memcpy((uint8_t *)meta_idx.class_infos_base + delta.infos_offset,
+           host_delta_ptr, delta.infos_len);
+  host_delta_ptr += delta.infos_len;
+  d_memcpy(&meta_idx.class_infos_by_id[delta.n_exported], host_delta_ptr,
+           delta.n_class_infos * sizeof(uint64_t));
+  host_delta_ptr += delta.n_class_infos * sizeof(uint64_t);
+  for (uint32_t i = delta.n_exported;
+       i < delta.n_exported + delta.n_class_infos; i++) {
+    LOG_DBG("%lX", (uintptr_t)meta_idx.class_infos_by_id[i]);
     *(uintptr_t *)(&meta_idx.class_infos_by_id[i]) += dev_class_infos_p;
-    *(uintptr_t *)(&meta_idx.class_infos_by_klass[i]) += dev_class_infos_p;
-    LOG_DBG("%lX %lX", (uintptr_t)meta_idx.class_infos_by_id[i],
-            (uintptr_t)meta_idx.class_infos_by_klass[i]);
+    LOG_DBG("%lX", (uintptr_t)meta_idx.class_infos_by_id[i]);
+  }
+  for (uint32_t i = 0; i < delta.n_patch; i++) {
+    class_id_patch_t patch;
+    d_memcpy(&patch, host_delta_ptr, sizeof(patch));
+    host_delta_ptr += sizeof(patch);
+    *(class_id_t *)((uintptr_t)meta_idx.class_infos_base + patch.offset) =
+        patch.id;
   }
+  // the klass map holds class ids only, so it is copied as is
+  d_memcpy(meta_idx.klass_map, host_delta_ptr, delta.klass_map_len);
+  meta_idx.klass_map_len = delta.klass_map_len;
+  // new ids are only in use once their infos are in place
+  meta_idx.class_infos_by_id_len = delta.n_exported + delta.n_class_infos;
 
   show_class_infos();
 
@@ -10,6 +10,17 @@ inline bool is_primitive_type(basic_type_t t) { return t >= T_BOOLEAN && t <= T_
 
 inline bool is_reference_type(basic_type_t t) { return t >= T_OBJECT && t <= T_ARRAY; }
 
+// encoding tag of a char array body, see ObjectWalker::try_cvt_to_latin1
+constexpr uint8_t CHAR_CODER_LATIN1 = 0;
+constexpr uint8_t CHAR_CODER_UTF16 = 1;
+
+// kind of a record head in the compact format, see ObjectWalker::visit_compact
+constexpr uint8_t COMPACT_NULL = 0;
+constexpr uint8_t COMPACT_REDIRECT = 1;
+constexpr uint8_t COMPACT_PRESENT = 2;
+constexpr uint32_t COMPACT_KIND_BITS = 2;
+constexpr uint8_t COMPACT_KIND_MASK = (1 << COMPACT_KIND_BITS) - 1;
+
 inline uint32_t type_size(uint16_t t) {
   switch (t) {
     case T_BOOLEAN:
@@ -140,5 +151,6 @@ inline bool is_object_f(flag_t f) { return (f & TYPE_FLAG_MASK) == OBJECT_FLAG;
 inline bool is_array_f(flag_t f) { return (f & TYPE_FLAG_MASK) == ARRAY_FLAG; }
 inline bool is_enum_f(flag_t f) { return is_object_f(f) && (f & CTRL_FLAG_MASK) == ENUM_FLAG; }
 inline bool is_redirect_f(flag_t f) { return (f & CTRL_FLAG_MASK) == REDIRECT_FLAG; }
+inline bool is_codec_f(flag_t f) { return is_object_f(f) && (f & CTRL_FLAG_MASK) == CODEC_FLAG; }
 
 }  // namespace dpx::sd
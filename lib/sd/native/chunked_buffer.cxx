@@ -0,0 +1,131 @@
+#include "sd/native/chunked_buffer.hxx"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+
+namespace dpx {
+
+void ChunkedBuffer::grow(size_t n) {
+  if (pool == nullptr) {
+    die("Output of at least {} bytes overflows the buffer of {} bytes", offset() + n, chunks[0].capacity);
+  }
+  // offsets in the output are 32 bits
+  if (offset() + n > UINT32_MAX) {
+    die("Output of at least {} bytes is too large", offset() + n);
+  }
+  if (!chunks.empty()) {
+    chunks.back().length = cur - begin;
+  }
+  auto c = n <= pool->piece_size() ? pool->acquire() : new naive::OwnedBuffer(n, 8);
+  chunks.push_back({.owned = c, .data = c->data(), .capacity = c->size(), .base = offset(), .length = 0});
+  TRACE("chunk {} of {} bytes at offset {}", chunks.size() - 1, c->size(), offset());
+  base = offset();
+  begin = cur = c->data();
+  end = c->data() + c->size();
+}
+
+void ChunkedBuffer::put_slow(const uint8_t *src, size_t length) {
+  while (length > 0) {
+    if (cur == end) {
+      grow(1);
+    }
+    auto n = std::min(length, (size_t)(end - cur));
+    memcpy(cur, src, n);
+    cur += n;
+    src += n;
+    length -= n;
+  }
+}
+
+size_t ChunkedBuffer::locate(size_t offset) const {
+  assert(!chunks.empty() && offset < this->offset());
+  auto it = std::upper_bound(chunks.begin(), chunks.end(), offset,
+                             [](size_t offset, const Chunk &c) { return offset < c.base; });
+  return it - chunks.begin() - 1;
+}
+
+void ChunkedBuffer::put_at_slow(const void *src, size_t length, size_t offset) {
+  assert(offset + length <= this->offset());
+  auto p = (const uint8_t *)src;
+  for (auto i = locate(offset); length > 0; i++) {
+    auto n = std::min(length, chunks[i].base + length_of(i) - offset);
+    memcpy(chunks[i].data + (offset - chunks[i].base), p, n);
+    p += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+void ChunkedBuffer::get_at_slow(void *dst, size_t length, size_t offset) const {
+  assert(offset + length <= this->offset());
+  auto p = (uint8_t *)dst;
+  for (auto i = locate(offset); length > 0; i++) {
+    auto n = std::min(length, chunks[i].base + length_of(i) - offset);
+    memcpy(p, chunks[i].data + (offset - chunks[i].base), n);
+    p += n;
+    offset += n;
+    length -= n;
+  }
+}
+
+void ChunkedBuffer::put(const ChunkedBuffer &src, size_t offset, size_t length) {
+  if (length == 0) {
+    return;
+  }
+  assert(offset + length <= src.offset());
+  for (auto i = src.locate(offset); length > 0; i++) {
+    auto n = std::min(length, src.chunks[i].base + src.length_of(i) - offset);
+    put(src.chunks[i].data + (offset - src.chunks[i].base), n);
+    offset += n;
+    length -= n;
+  }
+}
+
+std::vector<iovec> ChunkedBuffer::iovecs() const {
+  std::vector<iovec> v;
+  v.reserve(chunks.size());
+  for (auto i = 0uz; i < chunks.size(); i++) {
+    if (auto length = length_of(i); length > 0) {
+      v.push_back({.iov_base = chunks[i].data, .iov_len = length});
+    }
+  }
+  return v;
+}
+
+void ChunkedBuffer::copy_to(uint8_t *dst) const {
+  for (auto i = 0uz; i < chunks.size(); i++) {
+    auto length = length_of(i);
+    if (dst != chunks[i].data) {
+      memcpy(dst, chunks[i].data, length);
+    }
+    dst += length;
+  }
+}
+
+void ChunkedBuffer::clear() {
+  for (auto &c : chunks) {
+    if (c.owned == nullptr) {
+      continue;
+    }
+    if (c.owned->size() == pool->piece_size()) {
+      pool->release(c.owned);
+    } else {
+      delete c.owned;
+    }
+  }
+  if (!chunks.empty() && chunks[0].owned == nullptr) {
+    // the borrowed buffer stays
+    chunks.resize(1);
+    begin = cur = chunks[0].data;
+    end = chunks[0].data + chunks[0].capacity;
+  } else {
+    chunks.clear();
+    begin = cur = end = nullptr;
+  }
+  base = 0;
+}
+
+}  // namespace dpx
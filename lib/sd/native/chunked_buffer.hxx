@@ -0,0 +1,203 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "memory/naive_buffer.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/upper_align.hxx"
+
+namespace dpx {
+
+// chunks of one size shared by the outputs of a context and its walker threads, at most max_free of them are kept
+// after use, so a context shrinks back after an unusually large object
+class ChunkPool : Noncopyable, Nonmovable {
+ public:
+  ChunkPool(size_t chunk_size_, size_t max_free_) : chunk_size(upper_align(chunk_size_, 8)), max_free(max_free_) {}
+  ~ChunkPool() {
+    for (auto c : q) {
+      delete c;
+    }
+  }
+
+  size_t piece_size() const { return chunk_size; }
+
+  naive::OwnedBuffer *acquire() {
+    {
+      std::lock_guard l(m);
+      if (!q.empty()) {
+        auto c = q.back();
+        q.pop_back();
+        return c;
+      }
+    }
+    return new naive::OwnedBuffer(chunk_size, 8);
+  }
+
+  void release(naive::OwnedBuffer *c) {
+    {
+      std::lock_guard l(m);
+      if (q.size() < max_free) {
+        q.push_back(c);
+        return;
+      }
+    }
+    delete c;
+  }
+
+ private:
+  std::mutex m;
+  std::vector<naive::OwnedBuffer *> q;
+  size_t chunk_size;
+  size_t max_free;
+};
+
+// NOTICE:
+//  output of the walker as a chain of chunks, offsets are those of the chunks laid end to end. a put reserves its
+//  bytes with one branch and moves to a new chunk only if they do not fit, so values up to MAX_RESERVE bytes, e.g.
+//  heads and varints, never span two chunks, while bulk bytes flow over. an output either grows on demand with
+//  chunks of a pool, larger reserves get a chunk of their own, or starts in a borrowed buffer, which either dies on
+//  overflow instead of writing past it or goes on with chunks of a pool. the result is handed off as iovecs, or
+//  copied out at once.
+class ChunkedBuffer : Noncopyable, Nonmovable {
+ public:
+  constexpr static size_t MAX_RESERVE = 16;
+
+  explicit ChunkedBuffer(ChunkPool &pool_) : pool(&pool_) {}
+  explicit ChunkedBuffer(naive::BorrowedBuffer b) : pool(nullptr) { borrow(b); }
+  // in place, the bytes past b go to chunks of overflow, see overflowed
+  ChunkedBuffer(naive::BorrowedBuffer b, ChunkPool &overflow) : pool(&overflow) { borrow(b); }
+  ~ChunkedBuffer() { clear(); }
+
+  // n contiguous bytes at offset(), to be written by the caller and then committed
+  uint8_t *reserve(size_t n) {
+    if (n > (size_t)(end - cur)) [[unlikely]] {
+      grow(n);
+    }
+    return cur;
+  }
+
+  void commit(size_t n) {
+    assert(n <= (size_t)(end - cur));
+    cur += n;
+  }
+
+  template <typename T>
+  void put(T value) {
+    static_assert(sizeof(T) <= MAX_RESERVE);
+    memcpy(reserve(sizeof(T)), &value, sizeof(T));
+    cur += sizeof(T);
+  }
+
+  void put(const void *src, size_t length) {
+    if (length <= (size_t)(end - cur)) [[likely]] {
+      memcpy(cur, src, length);
+      cur += length;
+      return;
+    }
+    put_slow((const uint8_t *)src, length);
+  }
+
+  // append [offset, offset + length) of another output
+  void put(const ChunkedBuffer &src, size_t offset, size_t length);
+
+  // LEB128, as RWBuffer::put_varint
+  void put_varint(uint64_t value) {
+    auto p = reserve(10);
+    while (value >= 0x80) {
+      *p++ = (uint8_t)(value | 0x80);
+      value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    cur = p;
+  }
+
+  void put_zigzag(int64_t value) { put_varint((uint64_t)value << 1 ^ (uint64_t)(value >> 63)); }
+
+  // over bytes already written, e.g. a patched reference field, which may be in an earlier chunk
+  template <typename T>
+  void put_at(T value, size_t offset) {
+    if (offset >= base && offset + sizeof(T) <= this->offset()) [[likely]] {
+      memcpy(begin + (offset - base), &value, sizeof(T));
+    } else {
+      put_at_slow(&value, sizeof(T), offset);
+    }
+  }
+
+  template <typename T>
+  T get_at(size_t offset) const {
+    T value;
+    if (offset >= base && offset + sizeof(T) <= this->offset()) [[likely]] {
+      memcpy(&value, begin + (offset - base), sizeof(T));
+    } else {
+      get_at_slow(&value, sizeof(T), offset);
+    }
+    return value;
+  }
+
+  // zeroed bytes to be written later with put_at
+  void skip(size_t n) {
+    assert(n <= MAX_RESERVE);
+    memset(reserve(n), 0, n);
+    cur += n;
+  }
+
+  void fill_next_align_8() {
+    size_t len = upper_align(offset(), 8) - offset();
+    if (len == 0) {
+      return;
+    }
+    memset(reserve(len), 0, len);
+    cur += len;
+  }
+
+  size_t offset() const { return base + (cur - begin); }
+
+  // the output left the first chunk, so it is not contiguous in a borrowed buffer even if it fits there, as a reserve
+  // that does not fit the tail moves on to the next chunk
+  bool overflowed() const { return chunks.size() > 1; }
+
+  // the written bytes chunk by chunk, valid until the next put or clear
+  std::vector<iovec> iovecs() const;
+  // dst must have at least offset() bytes, it may be the borrowed buffer, which then gets the bytes back to back
+  void copy_to(uint8_t *dst) const;
+  // back to offset 0, chunks go back to the pool
+  void clear();
+
+ private:
+  struct Chunk {
+    naive::OwnedBuffer *owned;  // nullptr if borrowed
+    uint8_t *data;
+    size_t capacity;
+    size_t base;    // offset of data[0]
+    size_t length;  // of a sealed chunk, the current one is cur - begin
+  };
+
+  void borrow(naive::BorrowedBuffer b) {
+    chunks.push_back({.owned = nullptr, .data = b.data(), .capacity = b.size(), .base = 0, .length = 0});
+    begin = cur = b.data();
+    end = b.data() + b.size();
+  }
+  void grow(size_t n);
+  void put_slow(const uint8_t *src, size_t length);
+  void put_at_slow(const void *src, size_t length, size_t offset);
+  void get_at_slow(void *dst, size_t length, size_t offset) const;
+  // the chunk that holds offset
+  size_t locate(size_t offset) const;
+  size_t length_of(size_t i) const { return i + 1 == chunks.size() ? cur - begin : chunks[i].length; }
+
+  ChunkPool *pool;  // nullptr if the output is one borrowed buffer only
+  std::vector<Chunk> chunks;
+  uint8_t *begin = nullptr;
+  uint8_t *cur = nullptr;
+  uint8_t *end = nullptr;
+  size_t base = 0;  // offset of begin
+};
+
+}  // namespace dpx
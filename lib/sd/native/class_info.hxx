@@ -24,6 +24,10 @@ struct ClassInfo {
   void set_id(class_id_t id) { i->id = id; }
   void set_header_size(uint8_t size) { i->header_size = size; }
   void set_obj_size(uint16_t size) { i->obj_size = size; }
+  void set_primitive_block(uint16_t offset, uint16_t length) {
+    i->prim_off = offset;
+    i->prim_len = length;
+  }
   void set_enum(uint32_t ordinal, const FakeObject *enum_instance, jobject global_handle) {
     auto &obj_with_handle = ((obj_with_handle_t *)raw(i->enum_ref_arr_off))[ordinal];
     obj_with_handle.object = (uint64_t)enum_instance;
@@ -48,6 +52,10 @@ struct ClassInfo {
   uint32_t object_size() const { return i->obj_size; }
   uint32_t object_header_size() const { return i->header_size; }
   uint32_t object_body_size() const { return i->obj_size - i->header_size; }
+  // contiguous primitive fields, which can be restored with one copy
+  bool has_primitive_block() const { return i->prim_len != 0; }
+  uint32_t primitive_block_offset() const { return i->prim_off; }
+  uint32_t primitive_block_size() const { return i->prim_len; }
 
   uint32_t array_size(uint32_t length) const { return i->header_size + array_body_size(length); }
   uint32_t array_header_size() const { return i->header_size; }
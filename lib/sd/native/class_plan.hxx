@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "sd/native/class_info.hxx"
+
+namespace dpx::sd {
+
+// NOTICE: a host only digest of ClassInfo, compiled at registration, so that the walker and the reviver
+// do not interpret the field metadata per object.
+struct ClassPlan {
+  enum Flag : uint8_t {
+    FINAL = 1 << 0,  // the runtime class of a reference to it is always itself
+    LEAF = 1 << 1,   // no reference field or reference element
+    IMMUTABLE = 1 << 2,  // never overwritten in place by ObjectReviver::revive_into, e.g. String or enums
+  };
+
+  struct RefSlot {
+    uint16_t offset;  // offset after header, 0 for the array element
+    class_id_t id;    // declared class
+    bool exact;       // the declared class is final, skip the klass lookup
+    uintptr_t j_field_id;
+    mutable klass_cache_t klass_cache = KLASS_CACHE_EMPTY;  // last hit of the klass map
+  };
+
+  // hand written layouts of the few classes most shuffle records are made of, see ObjectWalker::do_walk_codec
+  enum Codec : uint8_t {
+    NO_CODEC,
+    STRING_CODEC,  // compact strings, the value bytes and the coder, or the chars of a String of char[]
+    BOX_CODEC,     // boxed primitives, the value only
+    TUPLE2_CODEC,  // scala.Tuple2, the members only
+  };
+
+  // adjacent primitive fields, the compact format packs them without the holes of the instance layout
+  struct PrimRun {
+    uint16_t offset;  // offset after header
+    uint16_t size;
+  };
+
+  ClassInfo info;
+  uint8_t flags = 0;
+  std::vector<RefSlot> refs;  // by offset
+  std::vector<PrimRun> prims;  // by offset, empty for arrays and enums
+  Codec codec = NO_CODEC;
+  uint16_t codec_offset = 0;            // offset after header of the value of a box or the coder of a string
+  basic_type_t codec_type = T_ILLEGAL;  // type of the field at codec_offset, T_CHAR for a String of char[]
+  uintptr_t codec_field_id = 0;         // j_field_id of the field at codec_offset
+
+  bool is_final() const { return flags & FINAL; }
+  bool is_leaf() const { return flags & LEAF; }
+  bool is_immutable() const { return flags & IMMUTABLE; }
+  bool has_codec() const { return codec != NO_CODEC; }
+  // see ClassInfo::has_primitive_block
+  bool has_primitive_block() const { return info.has_primitive_block(); }
+  uint32_t primitive_block_offset() const { return info.primitive_block_offset(); }
+  uint32_t primitive_block_size() const { return info.primitive_block_size(); }
+};
+
+}  // namespace dpx::sd
@@ -1,5 +1,7 @@
 #include "sd/native/class_resolver.hxx"
 
+#include <algorithm>
+
 #include "doca/buffer.hxx"
 #include "sd/native/class_walker.hxx"
 #include "sd/native/jenv_util.hxx"
@@ -20,9 +22,13 @@ void ClassResolver::show_class_infos() const {
   INFO(result);
 }
 
-ClassInfo ClassResolver::from_instance_klass(const FakeInstanceKlass *klass, bool is_enum) {
+ClassInfo ClassResolver::from_instance_klass(const FakeInstanceKlass *klass, bool is_enum,
+                                             uint32_t n_inherited_field) {
   auto [n_field, n_static_field] = klass->fields_count();
-  uint8_t n_non_static_field = n_field - n_static_field;
+  if (n_field - n_static_field + n_inherited_field > UINT8_MAX) {
+    die("Too many fields in {}, {} inherited", klass->signature(), n_inherited_field);
+  }
+  uint8_t n_non_static_field = n_field - n_static_field + n_inherited_field;
   TRACE("n field: {}, n static field: {}, n non static field: {}", (int)n_field, (int)n_static_field,
         (int)n_non_static_field);
 
@@ -52,6 +58,8 @@ ClassInfo ClassResolver::from_instance_klass(const FakeInstanceKlass *klass, boo
   info->klass = (void *)klass;
   info->sig_off = sig_off;
   info->enum_ref_arr_off = enum_ref_arr_off;
+  info->prim_off = 0;
+  info->prim_len = 0;
   info->klass_cptr = JVMArgs::compress_metaspace_ptr(klass);
   // set sig
   auto sig = klass->signature();
@@ -82,6 +90,8 @@ ClassInfo ClassResolver::from_array_klass(const FakeArrayKlass *klass) {
   info->klass = (void *)klass;
   info->sig_off = sizeof(class_info_t) + sizeof(field_info_t);
   info->enum_ref_arr_off = 0;
+  info->prim_off = 0;
+  info->prim_len = 0;
   info->klass_cptr = JVMArgs::compress_metaspace_ptr(klass);
   // set sig
   auto sig = klass->signature();
@@ -95,18 +105,26 @@ ClassInfo ClassResolver::from_array_klass(const FakeArrayKlass *klass) {
   info->fields[0].type = T_ILLEGAL;  // to be set
   info->fields[0].id = -1;           // to be set
   info->fields[0].offset = 0;
+  info->fields[0].klass_cache = KLASS_CACHE_EMPTY;
   return ClassInfo{info};
 }
 
 void ClassResolver::register_classes(JNIEnv *j_env, jobject j_set_classes) {
   auto classes = java_object_hashset_cvt_stl_vector(j_env, j_set_classes).value();
   for (auto cls : classes) {
-    register_class(j_env, (jclass)cls);
+    walk_class(j_env, (jclass)cls);
     j_env->DeleteLocalRef(cls);
   }
+  link_class_plans();
 }
 
 class_id_t ClassResolver::register_class(JNIEnv *j_env, const jclass j_class) {
+  auto id = walk_class(j_env, j_class);
+  link_class_plans();
+  return id;
+}
+
+class_id_t ClassResolver::walk_class(JNIEnv *j_env, const jclass j_class) {
   auto target_klass = FakeKlass::from_clazz(j_class);
   TRACE("register {}", target_klass->signature());
   if (auto info = get_class_info(target_klass); !info.is_dummy()) {
@@ -114,52 +132,290 @@ class_id_t ClassResolver::register_class(JNIEnv *j_env, const jclass j_class) {
     return info.id();  // registered
   }
   ClassWalker w(*this);
+  class_id_t id = UNREGISTERED_CLASS_ID;
   if (target_klass->lh.is_instance()) {
     auto instance = (const FakeInstanceKlass *)target_klass;
     if (instance->is_enum()) {
-      return w.walk_enum_klass(j_env, instance, j_class);
+      id = w.walk_enum_klass(j_env, instance, j_class);
     } else {
-      return w.walk_instance_klass(j_env, instance);
+      id = w.walk_instance_klass(j_env, instance);
     }
   } else if (target_klass->lh.is_array()) {
-    return w.walk_array_klass(j_env, (const FakeObjectArrayKlass *)target_klass);
+    id = w.walk_array_klass(j_env, (const FakeObjectArrayKlass *)target_klass);
   } else {
     unreachable();
   }
+  return id;
 }
 
-extern "C" doca_dpa_func_t register_class_infos;
+class_id_t ClassResolver::register_class(const FakeKlass *klass, bool is_final) {
+  TRACE("register synthetic {}", klass->signature());
+  if (auto info = get_class_info(klass); !info.is_dummy()) {
+    return info.id();  // registered
+  }
+  ClassWalker w(*this);
+  class_id_t id = UNREGISTERED_CLASS_ID;
+  if (klass->lh.is_instance()) {
+    id = w.walk_instance_klass(nullptr, (const FakeInstanceKlass *)klass);
+    if (is_final) {
+      plan_by_id[id2index(id)].flags |= ClassPlan::FINAL;
+    }
+  } else if (klass->lh.is_array()) {
+    id = w.walk_array_klass(nullptr, (const FakeArrayKlass *)klass);
+  } else {
+    unreachable();
+  }
+  link_class_plans();
+  return id;
+}
 
-void ClassResolver::export_class_infos(doca::Device &dev, doca::DPABuffer &dev_class_infos) {
-  INFO("export class infos to device");
-  dev_class_infos.device_memset(0);
-
-  doca::MappedRegion mapped_infos(dev, infos.data(), infos.size(), DOCA_ACCESS_FLAG_PCI_READ_WRITE);
-
-  doca::OwnedBuffer class_infos_by_id_offsets(dev, sizeof(uint64_t) * info_by_id.size(),
-                                              DOCA_ACCESS_FLAG_PCI_READ_WRITE);
-  {
-    uint64_t *offsets = reinterpret_cast<uint64_t *>(class_infos_by_id_offsets.data());
-    for (auto i = 0uz; i < info_by_id.size(); ++i) {
-      offsets[i] = reinterpret_cast<uint8_t *>(info_by_id[i].i) - infos.data();
-      TRACE("{:X}", offsets[i]);
+void ClassResolver::rebuild_klass_map(uint32_t capacity) {
+  klass_map_buffer.assign((klass_map_size(capacity) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+  auto m = (klass_map_t *)klass_map_buffer.data();
+  klass_map_init(m, capacity);
+  for (auto &info : info_by_id) {
+    [[maybe_unused]] auto ok = klass_map_insert(m, info.klass_cptr(), info.id());
+    assert(ok);
+  }
+  TRACE("klass map: {} in {} slots", m->n, m->capacity);
+}
+
+namespace {
+
+// instances of these may be shared or cached, e.g. interned strings or the boxed values of valueOf, so reviving
+// into them would change other holders too
+constexpr std::string_view IMMUTABLE_CLASSES[] = {
+    "Ljava/lang/String;",
+    "Ljava/lang/Boolean;",
+    "Ljava/lang/Byte;",
+    "Ljava/lang/Character;",
+    "Ljava/lang/Short;",
+    "Ljava/lang/Integer;",
+    "Ljava/lang/Long;",
+    "Ljava/lang/Float;",
+    "Ljava/lang/Double;",
+    "Ljava/math/BigInteger;",
+    "Ljava/math/BigDecimal;",
+};
+
+struct CodecClass {
+  std::string_view signature;
+  ClassPlan::Codec codec;
+};
+
+constexpr CodecClass CODEC_CLASSES[] = {
+    {"Ljava/lang/String;", ClassPlan::STRING_CODEC},
+    {"Ljava/lang/Boolean;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Byte;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Character;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Short;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Integer;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Long;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Float;", ClassPlan::BOX_CODEC},
+    {"Ljava/lang/Double;", ClassPlan::BOX_CODEC},
+    {"Lscala/Tuple2;", ClassPlan::TUPLE2_CODEC},
+};
+
+}  // namespace
+
+void ClassResolver::link_codec(ClassPlan &plan) const {
+  // a codec only depends on resolved fields, so once found it stays
+  auto info = plan.info;
+  if (plan.has_codec() || !info.is_object() || info.is_enum()) {
+    return;
+  }
+  auto iter = std::ranges::find(CODEC_CLASSES, info.signature(), &CodecClass::signature);
+  if (iter == std::end(CODEC_CLASSES)) {
+    return;
+  }
+  // NOTICE: the codecs assume the layouts of hotspot, a class laid out otherwise is walked as usual
+  auto find_field = [&](basic_type_t type) -> const field_info_t * {
+    const field_info_t *found = nullptr;
+    for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
+      if (info.get_field(i).type == type) {
+        if (found != nullptr) {
+          return nullptr;
+        }
+        found = &info.get_field(i);
+      }
+    }
+    return found;
+  };
+  switch (iter->codec) {
+    case ClassPlan::STRING_CODEC: {
+      if (plan.refs.size() != 1 || plan.refs[0].id == UNREGISTERED_CLASS_ID) {
+        return;
+      }
+      auto value = get_class_info(plan.refs[0].id).signature();
+      if (value == "[C") {
+        // before jdk 9, the chars only, the cached hash is recomputed on demand
+        plan.codec_type = T_CHAR;
+        break;
+      }
+      auto coder = find_field(T_BYTE);
+      if (value != "[B" || coder == nullptr) {
+        return;
+      }
+      plan.codec_offset = coder->offset;
+      plan.codec_type = T_BYTE;
+      plan.codec_field_id = coder->j_field_id;
+      break;
+    }
+    case ClassPlan::BOX_CODEC: {
+      if (info.n_non_static_field() != 1 || !is_primitive_type(info.get_field(0).type)) {
+        return;
+      }
+      plan.codec_offset = info.get_field(0).offset;
+      plan.codec_type = info.get_field(0).type;
+      plan.codec_field_id = info.get_field(0).j_field_id;
+      break;
+    }
+    case ClassPlan::TUPLE2_CODEC: {
+      if (plan.refs.size() != 2 || !plan.prims.empty()) {
+        return;
+      }
+      break;
+    }
+    default: {
+      unreachable();
+    }
+  }
+  plan.codec = iter->codec;
+}
+
+void ClassResolver::link_class_plans() {
+  std::ranges::sort(relink);
+  auto [first, last] = std::ranges::unique(relink);
+  relink.erase(first, last);
+  for (auto id : relink) {
+    // the new ones are linked as a whole below
+    if (id2index(id) < n_linked) {
+      relink_class_plan(plan_by_id[id2index(id)]);
+    }
+  }
+  relink.clear();
+  for (; n_linked < plan_by_id.size(); n_linked++) {
+    link_class_plan(plan_by_id[n_linked]);
+  }
+}
+
+void ClassResolver::link_class_plan(ClassPlan &plan) {
+  auto info = plan.info;
+  if (info.is_enum()) {
+    // no field to follow
+  } else if (info.is_object()) {
+    for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
+      auto &f = info.get_field(i);
+      if (is_reference_type(f.type)) {
+        plan.refs.push_back({.offset = f.offset, .id = f.id, .exact = false, .j_field_id = f.j_field_id});
+      } else if (is_primitive_type(f.type)) {
+        plan.prims.push_back({.offset = f.offset, .size = (uint16_t)type_size(f.type)});
+      }
+    }
+    std::ranges::sort(plan.prims, std::less<uint16_t>(), &ClassPlan::PrimRun::offset);
+    auto n_run = 0uz;
+    for (auto &run : plan.prims) {
+      if (n_run > 0 && plan.prims[n_run - 1].offset + plan.prims[n_run - 1].size == run.offset) {
+        plan.prims[n_run - 1].size += run.size;
+      } else {
+        plan.prims[n_run++] = run;
+      }
     }
+    plan.prims.resize(n_run);
+  } else if (info.is_array()) {
+    auto &elem = info.get_field(0);
+    if (is_reference_type(elem.type)) {
+      plan.refs.push_back({.offset = 0, .id = elem.id, .exact = false, .j_field_id = 0});
+    }
+  } else {
+    unreachable();
+  }
+  if (plan.refs.empty()) {
+    plan.flags |= ClassPlan::LEAF;
+  }
+  if (info.is_enum() || std::ranges::find(IMMUTABLE_CLASSES, info.signature()) != std::end(IMMUTABLE_CLASSES)) {
+    plan.flags |= ClassPlan::IMMUTABLE;
   }
+  relink_class_plan(plan);
+}
 
-  doca::OwnedBuffer class_infos_by_klass_offsets(dev, sizeof(uint64_t) * info_by_klass.size(),
-                                                 DOCA_ACCESS_FLAG_PCI_READ_WRITE);
-  {
-    uint64_t *offsets = reinterpret_cast<uint64_t *>(class_infos_by_klass_offsets.data());
-    for (auto i = 0uz; i < info_by_klass.size(); ++i) {
-      offsets[i] = reinterpret_cast<uint8_t *>(info_by_klass[i].i) - infos.data();
-      TRACE("{:X}", offsets[i]);
+void ClassResolver::relink_class_plan(ClassPlan &plan) {
+  // NOTICE: the plan may be in use by walkers of other threads, so only the slots are patched, never resized.
+  // the slots follow the reference fields in order, and a field id only goes from unregistered to registered.
+  auto info = plan.info;
+  auto k = 0uz;
+  for (uint32_t i = 0; i < info.n_non_static_field() && k < plan.refs.size(); i++) {
+    auto &f = info.get_field(i);
+    if (is_reference_type(f.type)) {
+      auto &ref = plan.refs[k++];
+      ref.id = f.id;
+      ref.exact = f.id != UNREGISTERED_CLASS_ID && plan_by_id[id2index(f.id)].is_final();
     }
   }
+  link_codec(plan);
+  TRACE("plan of {}: flags: 0b{:03b}, codec: {}, n ref: {}, n prim run: {}", info.signature(), plan.flags,
+        (int)plan.codec, plan.refs.size(), plan.prims.size());
+}
+
+std::vector<uint8_t> ClassResolver::take_class_infos_delta() {
+  if (!has_unexported_class_infos()) {
+    assert(unexported_ids.empty());
+    return {};
+  }
+  class_infos_delta_t delta = {
+      .infos_offset = exported_infos_len,
+      .infos_len = a.allocated() - exported_infos_len,
+      .n_exported = n_exported,
+      .n_class_infos = info_by_id.size() - n_exported,
+      .n_patch = unexported_ids.size(),
+      .klass_map_len = klass_map_size(klass_map()->capacity),
+  };
+  std::vector<uint8_t> stream(sizeof(delta) + delta.infos_len + delta.n_class_infos * sizeof(uint64_t) +
+                              delta.n_patch * sizeof(class_id_patch_t) + delta.klass_map_len);
+  auto p = stream.data();
+  auto put = [&p](const void *src, size_t len) {
+    memcpy(p, src, len);
+    p += len;
+  };
+  put(&delta, sizeof(delta));
+  put(infos.data() + exported_infos_len, delta.infos_len);
+  for (auto i = n_exported; i < info_by_id.size(); i++) {
+    uint64_t offset = reinterpret_cast<uint8_t *>(info_by_id[i].i) - infos.data();
+    put(&offset, sizeof(offset));
+  }
+  for (auto offset : unexported_ids) {
+    class_id_patch_t patch = {.offset = offset, .id = *(class_id_t *)(infos.data() + offset), .reserved = 0};
+    put(&patch, sizeof(patch));
+  }
+  put(klass_map(), delta.klass_map_len);
+  assert(p == stream.data() + stream.size());
+
+  TRACE("class infos delta: {} bytes of {} classes after {}, {} patches", delta.infos_len, delta.n_class_infos,
+        delta.n_exported, delta.n_patch);
+  exported_infos_len = a.allocated();
+  n_exported = info_by_id.size();
+  unexported_ids.clear();
+  return stream;
+}
+
+extern "C" doca_dpa_func_t append_class_infos;
+
+void ClassResolver::export_class_infos(doca::Device &dev, doca::DPABuffer &dev_class_infos) {
+  auto stream = take_class_infos_delta();
+  if (stream.empty()) {
+    return;
+  }
+  auto delta = (const class_infos_delta_t *)stream.data();
+  INFO("export {} class infos to device, {} exported", delta->n_class_infos, delta->n_exported);
+  if (delta->n_exported == 0) {
+    dev_class_infos.device_memset(0);
+  }
+
+  doca::OwnedBuffer mapped_delta(dev, stream.size(), DOCA_ACCESS_FLAG_PCI_READ_WRITE);
+  memcpy(mapped_delta.data(), stream.data(), stream.size());
 
-  doca::launch_rpc(dev, register_class_infos, dev_class_infos.handle(), mapped_infos.get_mmap_handle(),
-                   mapped_infos.handle(), a.allocated(), info_by_id.size(),
-                   class_infos_by_id_offsets.get_mmap_handle(dev), class_infos_by_id_offsets.handle(),
-                   class_infos_by_klass_offsets.get_mmap_handle(dev), class_infos_by_klass_offsets.handle());
+  doca::launch_rpc(dev, append_class_infos, dev_class_infos.handle(), o.max_class_info_size,
+                   mapped_delta.get_mmap_handle(dev), mapped_delta.handle());
 }
 
 }  // namespace dpx::sd
@@ -3,7 +3,9 @@
 #include "doca/dpa_buffer.hxx"
 #include "memory/naive_buffer.hxx"
 #include "memory/simple_allocator.hxx"
+#include "sd/common/meta.h"
 #include "sd/native/class_info.hxx"
+#include "sd/native/class_plan.hxx"
 #include "sd/native/fake.hxx"
 #include "sd/native/options.hxx"
 #include "util/string_hash.hxx"
@@ -16,13 +18,31 @@ namespace dpx::sd {
 class ClassResolver : Noncopyable, Nonmovable {
   friend class ClassWalker;
 
+  // a reference field of owner whose declared class is not registered yet
+  struct UnresolvedField {
+    field_info_t *field;
+    ClassInfo owner;
+  };
+
  public:
-  ClassResolver(Options &o_) : o(o_), infos(o.max_class_info_size, 64), a(infos) {}
+  ClassResolver(Options &o_) : o(o_), infos(o.max_class_info_size, 64), a(infos) {
+    // every info takes at least this much of infos, so the plans are never moved by a later registration while
+    // walkers of other threads hold references to them
+    auto max_n_class = o.max_class_info_size / (sizeof(class_info_t) + MAX_SIGNATURE_LENGTH);
+    info_by_id.reserve(max_n_class);
+    plan_by_id.reserve(max_n_class);
+    rebuild_klass_map(klass_map_capacity_for(0));
+  }
   ~ClassResolver() = default;
 
   // setter
+  // NOTICE: plans are linked once per call, after all classes of the set are registered
   void register_classes(JNIEnv *j_env, jobject j_set_classes);
   class_id_t register_class(JNIEnv *j_env, const jclass j_class);
+  // NOTICE: for klasses laid out in plain memory instead of a jvm, e.g. the synthetic heap of the harness.
+  // there are no jni field ids, and finality is given by the caller. register elements before their arrays,
+  // as an array is only final if its element is.
+  class_id_t register_class(const FakeKlass *klass, bool is_final);
 
   // getters
   const ClassInfo get_class_info(class_id_t id) const {
@@ -34,21 +54,44 @@ class ClassResolver : Noncopyable, Nonmovable {
     return iter != sig2id.end() ? info_by_id[id2index(iter->second)] : ClassInfo::dummy();
   }
   const ClassInfo get_class_info(const FakeKlass *klass) const {
-    auto iter = std::ranges::lower_bound(info_by_klass, klass, std::less<const FakeKlass *>(),
-                                         [](const ClassInfo &i) -> const FakeKlass * { return i.klass(); });
-    return iter != info_by_klass.end() ? ((*iter).klass() == klass ? *iter : ClassInfo::dummy()) : ClassInfo::dummy();
+    return get_class_info(JVMArgs::compress_metaspace_ptr(klass));
   }
   const ClassInfo get_class_info(uint32_t klass_cptr) const {
-    return get_class_info((const FakeKlass *)JVMArgs::parse_metaspace_cptr(klass_cptr));
+    auto id = klass_map_lookup(klass_map(), klass_cptr);
+    return id != UNREGISTERED_CLASS_ID ? info_by_id[id2index(id)] : ClassInfo::dummy();
+  }
+  // cache is the last hit of a call site, see klass_map.h
+  const ClassInfo get_class_info(uint32_t klass_cptr, klass_cache_t *cache) const {
+    auto id = klass_map_lookup_cached(klass_map(), cache, klass_cptr);
+    return id != UNREGISTERED_CLASS_ID ? info_by_id[id2index(id)] : ClassInfo::dummy();
   }
 
+  // NOTICE: the plan is only valid for registered id. a registration only links the new plans and patches the
+  // reference slots of the plans whose fields it resolves, in place, so plans in use are never rebuilt
+  const ClassPlan &get_class_plan(class_id_t id) const { return plan_by_id[id2index(id)]; }
+
+  // NOTICE: only the classes registered since the last export are sent, into a table laid out by the first
+  // export, so the device buffer must be of device_class_infos_size and kept across exports
   void export_class_infos(doca::Device &dev, doca::DPABuffer &dev_class_infos);
+  // the classes registered since the last call as a class_infos_delta_t stream, empty if there is none
+  std::vector<uint8_t> take_class_infos_delta();
+  bool has_unexported_class_infos() const { return n_exported < info_by_id.size(); }
+  static size_t device_class_infos_size(const Options &o) { return meta_size(o.max_class_info_size); }
 
   void show_class_infos() const;
 
  private:  // for walker
-  ClassInfo from_instance_klass(const FakeInstanceKlass *klass, bool is_enum);
+  // n_inherited_field fields of the super klasses come before the declared ones, see ClassWalker::inherit_field
+  ClassInfo from_instance_klass(const FakeInstanceKlass *klass, bool is_enum, uint32_t n_inherited_field = 0);
   ClassInfo from_array_klass(const FakeArrayKlass *klass);
+  class_id_t walk_class(JNIEnv *j_env, const jclass j_class);
+  // link the plans registered since the last call, and relink the ones in relink
+  void link_class_plans();
+  void link_class_plan(ClassPlan &plan);
+  void relink_class_plan(ClassPlan &plan);
+  void link_codec(ClassPlan &plan) const;
+  void rebuild_klass_map(uint32_t capacity);
+  const klass_map_t *klass_map() const { return (const klass_map_t *)klass_map_buffer.data(); }
 
   // NOTICE class_id > BasicType
   static size_t id2index(class_id_t id) {
@@ -66,12 +109,20 @@ class ClassResolver : Noncopyable, Nonmovable {
   SimpleAllocator a;
 
   std::vector<ClassInfo> info_by_id;
-  std::vector<ClassInfo> info_by_klass;
+  std::vector<uint64_t> klass_map_buffer;  // klass_map_t, 8 bytes aligned
+  std::vector<ClassPlan> plan_by_id;
+  size_t n_linked = 0;             // plans before it are linked
+  std::vector<class_id_t> relink;  // linked plans with fields resolved since the last link
+
+  // what the device has, see take_class_infos_delta
+  uint64_t exported_infos_len = 0;
+  size_t n_exported = 0;
+  std::vector<uint32_t> unexported_ids;  // offsets of the ids resolved in exported infos
 
   // TODO replace with ART
   std::unordered_map<std::string, class_id_t, string_hash, std::equal_to<>> sig2id;
   // TODO use unordered_dense
-  std::unordered_map<std::string, std::vector<field_info_t *>, string_hash, std::equal_to<>> unresolved;
+  std::unordered_map<std::string, std::vector<UnresolvedField>, string_hash, std::equal_to<>> unresolved;
 };
 
 }  // namespace dpx::sd
@@ -2,6 +2,7 @@
 
 #include "sd/native/class_info.hxx"
 #include "sd/native/class_resolver.hxx"
+#include "sd/native/jenv_util.hxx"
 
 namespace dpx::sd {
 
@@ -52,14 +53,28 @@ class_id_t ClassWalker::walk_instance_klass(JNIEnv *j_env, const FakeInstanceKla
     return info.id();  // registered
   }
 
-  // TODO super klass
+  // NOTICE: fields of the super klasses are flattened into the layout. hotspot keeps their offsets in the
+  // subclasses, so the resolved fields of the registered super class are shared instead of walked again.
+  auto super_info = ClassInfo::dummy();
+  if (klass->super != nullptr && klass->super->signature() != "java/lang/Object") {
+    super_info = r.get_class_info(walk_instance_klass(j_env, (const FakeInstanceKlass *)klass->super));
+  }
+  uint32_t n_inherited_field = super_info.is_dummy() ? 0 : super_info.n_non_static_field();
   auto cp = klass->constant_pool;
-  auto info = r.from_instance_klass(klass, false);
-  TRACE("{} with {} fields", info.signature(), info.n_field());
-  std::vector<uint32_t> idx;
+  auto info = r.from_instance_klass(klass, false, n_inherited_field);
+  TRACE("{} with {} fields, {} inherited", info.signature(), info.n_field(), n_inherited_field);
+  // offset from the object base and index of the field, inherited ones first, then the declared ones
+  std::vector<std::pair<uint32_t, uint32_t>> idx;
   idx.reserve(info.n_non_static_field());
+  for (uint32_t i = 0; i < n_inherited_field; i++) {
+    auto offset = super_info.object_header_size() + super_info.get_field(i).offset;
+    idx.emplace_back(offset, i);
+    if (offset < info.object_header_size()) {
+      info.set_header_size(offset);
+    }
+  }
   // collect all non-static fields and calculate field offset
-  for (uint32_t i = 0; i < info.n_field(); i++) {
+  for (uint32_t i = 0; i < info.n_field() - n_inherited_field; i++) {
     auto &jfield = klass->field(i);
     if (jfield.is_internal()) {
       // WARN do not touch
@@ -70,7 +85,7 @@ class_id_t ClassWalker::walk_instance_klass(JNIEnv *j_env, const FakeInstanceKla
     } else {
       // non-static
       TRACE("non-static field {}, signature: {}, offset: {}", i, jfield.signature_view(cp), jfield.offset());
-      idx.push_back(i);
+      idx.emplace_back(jfield.offset(), n_inherited_field + i);
       // the minimum of field.offset() is the object header size.
       auto offset = jfield.offset();
       if (offset < info.object_header_size()) {
@@ -80,59 +95,118 @@ class_id_t ClassWalker::walk_instance_klass(JNIEnv *j_env, const FakeInstanceKla
   }
   TRACE("object header size: {}", info.object_header_size());
 
-  // sort by field offset
-  std::ranges::sort(
-      idx, [klass](uint32_t l, uint32_t r) -> bool { return klass->field(l).offset() < klass->field(r).offset(); });
+  // sort by field offset, declared fields may fill the gaps of the super klasses
+  std::ranges::sort(idx);
 
   // resolve fields
   for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
     auto &field = info.field(i);
-    auto &jfield = klass->field(idx[i]);
+    if (idx[i].second < n_inherited_field) {
+      inherit_field(field, super_info.get_field(idx[i].second), info);
+      // remove header size here
+      field.offset = idx[i].first - info.object_header_size();
+      TRACE("inherit field {}, offset: {}, type: {}", field.id, field.offset, type2str(field.type));
+      continue;
+    }
+    auto &jfield = klass->field(idx[i].second - n_inherited_field);
     // remove header size here
     field.offset = jfield.offset() - info.object_header_size();
     field.type = jfield.type(cp);
     field.flag = jfield.access_flags;
+    field.klass_cache = KLASS_CACHE_EMPTY;
     TRACE("resolve field {}, offset: {}, type: {}", field.id, field.offset, type2str(field.type));
     if (is_reference_type(field.type)) {
       auto sig = jfield.signature(cp);
       auto name = jfield.name(cp);
-      auto j_field_id = j_env->GetFieldID(klass->clazz(), name.c_str(), sig.c_str());
+      auto j_field_id = j_env != nullptr ? j_env->GetFieldID(klass->clazz(), name.c_str(), sig.c_str()) : nullptr;
       TRACE("name: {}, signature: {}, j_field_id: {:X}", name, sig, (uintptr_t)j_field_id);
       field.j_field_id = (uintptr_t)j_field_id;
-      auto info = r.get_class_info(sig);
-      if (info.is_dummy()) {
+      auto field_info = r.get_class_info(sig);
+      if (field_info.is_dummy()) {
         field.id = UNREGISTERED_CLASS_ID;
         if (auto iter = r.unresolved.find(sig); iter != r.unresolved.end()) {
-          iter->second.push_back(&field);
+          iter->second.push_back({&field, info});
         } else {
-          r.unresolved.emplace(std::string(sig), std::vector<field_info_t *>{&field});
+          r.unresolved.emplace(std::string(sig), std::vector<ClassResolver::UnresolvedField>{{&field, info}});
         }
       } else {
-        field.id = info.id();
+        field.id = field_info.id();
       }
     } else if (is_primitive_type(field.type)) {
-      field.j_field_id = (uintptr_t)j_env->GetFieldID(klass->clazz(), jfield.name(cp).c_str(), type2sig(field.type));
+      field.j_field_id =
+          j_env != nullptr
+              ? (uintptr_t)j_env->GetFieldID(klass->clazz(), jfield.name(cp).c_str(), type2sig(field.type))
+              : 0;
     } else {
       unreachable();
     }
   }
+  resolve_primitive_block(info);
 
-  register_class_info(info);
+  // a synthetic klass has no mirror to ask, its resolver sets the flag instead
+  register_class_info(info, j_env != nullptr && is_final_class(j_env, klass->clazz()) ? ClassPlan::FINAL : 0);
   return info.id();
 }
 
+void ClassWalker::inherit_field(field_info_t &field, const field_info_t &super_field, ClassInfo owner) {
+  // the jni field id of the super klass is valid for the subclass, and is not shadowed by a declared field
+  field = super_field;
+  field.klass_cache = KLASS_CACHE_EMPTY;
+  if (is_reference_type(field.type) && field.id == UNREGISTERED_CLASS_ID) {
+    // resolved along with the field of the super klass
+    for (auto &[sig, fields] : r.unresolved) {
+      if (std::ranges::find(fields, &super_field, &ClassResolver::UnresolvedField::field) != fields.end()) {
+        fields.push_back({&field, owner});
+        break;
+      }
+    }
+  }
+}
+
+void ClassWalker::resolve_primitive_block(ClassInfo info) {
+  // hotspot groups the primitive fields, so they usually span one block before or after the references
+  uint32_t begin = UINT32_MAX;
+  uint32_t end = 0;
+  for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
+    auto &f = info.get_field(i);
+    if (is_primitive_type(f.type)) {
+      begin = std::min<uint32_t>(begin, f.offset);
+      end = std::max<uint32_t>(end, f.offset + type_size(f.type));
+    }
+  }
+  if (begin >= end) {
+    return;  // no primitive field
+  }
+  for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
+    auto &f = info.get_field(i);
+    if (is_reference_type(f.type) && f.offset >= begin && f.offset < end) {
+      TRACE("{} has a reference at {} inside primitive fields [{}, {})", info.signature(), f.offset, begin, end);
+      return;
+    }
+  }
+  TRACE("{} primitive block: [{}, {})", info.signature(), begin, end);
+  info.set_primitive_block(begin, end - begin);
+}
+
 class_id_t ClassWalker::walk_array_klass(JNIEnv *j_env, const FakeArrayKlass *klass) {
   if (auto info = r.get_class_info(klass); !info.is_dummy()) {
     return info.id();  // registered
   }
   auto info = r.from_array_klass(klass);
   auto &elem_info = info.field(0);
+  // an array is exact if its element is, e.g. int[] or String[]
+  uint8_t plan_flags = 0;
   if (klass->dimension == 1) {  // 1-dim array is special
     auto t = klass->lh.element_type();
     elem_info.type = t;
-    if (t == T_OBJECT) {
+    if (is_primitive_type(t)) {
+      plan_flags = ClassPlan::FINAL;
+    } else if (t == T_OBJECT) {
       auto elem_klass = ((const FakeObjectArrayKlass *)klass)->element_klass;
       if (elem_klass->is_enum()) {
+        if (j_env == nullptr) {
+          die("Synthetic enum {} is not supported", elem_klass->signature());
+        }
         elem_info.id = walk_enum_klass(j_env, elem_klass, elem_klass->clazz());
       } else {
         elem_info.id = walk_instance_klass(j_env, elem_klass);
@@ -142,24 +216,36 @@ class_id_t ClassWalker::walk_array_klass(JNIEnv *j_env, const FakeArrayKlass *kl
     elem_info.type = T_ARRAY;
     elem_info.id = walk_array_klass(j_env, klass->lower_dimension);
   }
-  register_class_info(info);
+  if (elem_info.type == T_OBJECT || elem_info.type == T_ARRAY) {
+    plan_flags = r.get_class_plan(elem_info.id).flags & ClassPlan::FINAL;
+  }
+  register_class_info(info, plan_flags);
   return info.id();
 }
 
-void ClassWalker::register_class_info(ClassInfo info) {
+void ClassWalker::register_class_info(ClassInfo info, uint8_t plan_flags) {
   TRACE("register {}, klass: {:}, id: {}", info.signature(), (void *)info.klass(), info.id());
   // WARN: do not check registered info
   info.set_id(ClassResolver::index2id(r.info_by_id.size()));
   r.info_by_id.push_back(info);
-  r.info_by_klass.insert(
-      std::ranges::lower_bound(r.info_by_klass, info,
-                               [](const ClassInfo &l, const ClassInfo &r) -> bool { return l.klass() < r.klass(); }),
-      info);
+  // references are linked once the registration is done
+  r.plan_by_id.push_back(ClassPlan{.info = info, .flags = plan_flags, .refs = {}});
+  // the map is kept at most half full, rebuild a larger one if needed
+  auto m = (klass_map_t *)r.klass_map_buffer.data();
+  if (!klass_map_insert(m, info.klass_cptr(), info.id())) {
+    r.rebuild_klass_map(klass_map_capacity_for(r.info_by_id.size()));
+  }
   r.sig2id.emplace(std::string(info.signature()), info.id());
 
   if (auto iter = r.unresolved.find(info.signature()); iter != r.unresolved.end()) {
-    for (auto f : iter->second) {
+    for (auto [f, owner] : iter->second) {
       f->id = info.id();
+      // an exported class learns the id with the next export
+      if ((uint8_t *)f < r.infos.data() + r.exported_infos_len) {
+        r.unexported_ids.push_back((uint8_t *)&f->id - r.infos.data());
+      }
+      // the owner is registered, or is this class, and its plan learns the id with the next link
+      r.relink.push_back(owner.id());
     }
     r.unresolved.erase(iter);
   }
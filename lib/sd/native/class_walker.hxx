@@ -15,6 +15,7 @@ struct FakeArrayKlass;
 struct FakeInstanceKlass;
 
 // TODO: take jenv into more consideration
+// NOTICE: j_env is nullptr for synthetic klasses, which are not backed by a jvm, see ClassResolver::register_class
 
 class ClassWalker : Noncopyable, Nonmovable {
   friend class ClassResolver;
@@ -24,7 +25,10 @@ class ClassWalker : Noncopyable, Nonmovable {
   class_id_t walk_instance_klass(JNIEnv *j_env, const FakeInstanceKlass *klass);
   class_id_t walk_enum_klass(JNIEnv *j_env, const FakeInstanceKlass *klass, const jclass j_class);
 
-  void register_class_info(ClassInfo info);
+  void register_class_info(ClassInfo info, uint8_t plan_flags = 0);
+  void resolve_primitive_block(ClassInfo info);
+  // owner is the class of field, an unresolved one is resolved along with super_field
+  void inherit_field(field_info_t &field, const field_info_t &super_field, ClassInfo owner);
 
   // only construct by resolver
   ClassWalker(ClassResolver &resolver) : r(resolver) {}
@@ -0,0 +1,177 @@
+#include "sd/native/context_pool.hxx"
+
+#include <algorithm>
+#include <atomic>
+
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+
+namespace dpx::sd {
+
+namespace {
+
+std::atomic_uint64_t next_epoch = 1;
+
+JavaVM *get_vm(JNIEnv *j_env) {
+  JavaVM *vm = nullptr;
+  if (j_env->GetJavaVM(&vm) != JNI_OK) {
+    die("Fail to get jvm");
+  }
+  return vm;
+}
+
+// pools by epoch, so that an exiting thread only goes back to the pools that are still there
+std::mutex live_mu;
+std::unordered_map<uint64_t, ContextPool *> live;
+
+}  // namespace
+
+// NOTICE: the pools a thread keeps idle contexts in, and its local context. the destructor runs when the thread
+// exits and holds live_mu throughout, so that none of the pools is destroyed in the middle.
+struct ContextPool::ThreadState {
+  uint64_t local_epoch = 0;
+  Context *local = nullptr;
+  std::vector<uint64_t> epochs;
+
+  ~ThreadState() {
+    std::lock_guard l(live_mu);
+    for (auto e : epochs) {
+      if (auto it = live.find(e); it != live.end()) {
+        it->second->exit_thread(e == local_epoch ? local : nullptr);
+      }
+    }
+  }
+
+  void enter(uint64_t epoch) {
+    if (std::ranges::find(epochs, epoch) == epochs.end()) [[unlikely]] {
+      epochs.push_back(epoch);
+    }
+  }
+};
+
+ContextPool::ContextPool(JNIEnv *j_env, Options &o_, ClassResolver &r_)
+    : o(o_),
+      r(r_),
+      epoch(next_epoch.fetch_add(1, std::memory_order_relaxed)),
+      vm(get_vm(j_env)),
+      hosts(
+          o.max_host_threads,
+          [this](uint32_t idx) {
+            JNIEnv *env = nullptr;
+            if (vm->AttachCurrentThreadAsDaemon((void **)&env, nullptr) != JNI_OK) {
+              die("Fail to attach host thread {}", idx);
+            }
+          },
+          [this](uint32_t) { vm->DetachCurrentThread(); }) {
+  std::lock_guard l(live_mu);
+  live.emplace(epoch, this);
+  DEBUG("context pool {} keeps at most {} idle contexts per thread", epoch, o.max_idle_contexts);
+}
+
+ContextPool::~ContextPool() {
+  {
+    std::lock_guard l(live_mu);
+    live.erase(epoch);
+  }
+  DEBUG("context pool {} frees {} contexts", epoch, all.size());
+  for (auto [ctx, _] : all) {
+    delete ctx;
+  }
+}
+
+ContextPool::ThreadState &ContextPool::thread_state() {
+  thread_local ThreadState s;
+  return s;
+}
+
+Context *ContextPool::take(State state) {
+  {
+    std::lock_guard l(mu);
+    if (auto it = idle.find(std::this_thread::get_id()); it != idle.end() && !it->second.empty()) {
+      auto ctx = it->second.back();
+      it->second.pop_back();
+      all[ctx] = state;
+      return ctx;
+    }
+  }
+  // allocate out of the lock, a context is large
+  auto ctx = new Context(o, r, hosts);
+  std::lock_guard l(mu);
+  all.emplace(ctx, state);
+  return ctx;
+}
+
+Context *ContextPool::acquire() { return take(State::LEASED); }
+
+bool ContextPool::release(Context *ctx) {
+  {
+    std::lock_guard l(mu);
+    auto it = all.find(ctx);
+    if (it == all.end() || it->second != State::LEASED) [[unlikely]] {
+      return false;
+    }
+    if (auto &v = idle[std::this_thread::get_id()]; v.size() < o.max_idle_contexts) {
+      it->second = State::IDLE;
+      v.push_back(ctx);
+      thread_state().enter(epoch);
+      return true;
+    }
+    all.erase(it);
+  }
+  delete ctx;
+  return true;
+}
+
+Context &ContextPool::local() {
+  // NOTICE: one local context per thread, so only one pool at a time serves static entries, i.e. that of SD.
+  // a new pool replaces the context on the next call, the old one has been freed along with its pool
+  auto &s = thread_state();
+  if (s.local_epoch != epoch) [[unlikely]] {
+    s.local = take(State::LOCAL);
+    s.local_epoch = epoch;
+    s.enter(epoch);
+  }
+  return *s.local;
+}
+
+void ContextPool::exit_thread(Context *local) {
+  std::vector<Context *> victims;
+  {
+    std::lock_guard l(mu);
+    if (auto it = idle.find(std::this_thread::get_id()); it != idle.end()) {
+      victims = std::move(it->second);
+      idle.erase(it);
+    }
+    if (local != nullptr) {
+      victims.push_back(local);
+    }
+    for (auto ctx : victims) {
+      all.erase(ctx);
+    }
+  }
+  for (auto ctx : victims) {
+    delete ctx;
+  }
+  DEBUG("context pool {} frees {} contexts of an exiting thread", epoch, victims.size());
+}
+
+size_t ContextPool::trim() {
+  std::vector<Context *> victims;
+  {
+    std::lock_guard l(mu);
+    for (auto &[_, v] : idle) {
+      for (auto ctx : v) {
+        all.erase(ctx);
+        victims.push_back(ctx);
+      }
+    }
+    idle.clear();
+  }
+  for (auto ctx : victims) {
+    delete ctx;
+  }
+  DEBUG("context pool {} trims {} idle contexts", epoch, victims.size());
+  return victims.size();
+}
+
+}  // namespace dpx::sd
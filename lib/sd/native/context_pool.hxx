@@ -0,0 +1,63 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "sd/native/sd.hxx"
+
+namespace dpx::sd {
+
+// NOTICE:
+//  a context carries the ctx buffer, the output chunks and the maps of the walker and the reviver, so short lived
+//  java handles borrow warm contexts instead of allocating their own. idle contexts are kept per thread, as a
+//  context is warm in the caches of the thread that used it last, at most max_idle_contexts each, the rest are
+//  deleted on release and trim deletes all of them. a thread that exits gives back its idle contexts and its local
+//  one, so threads that come and go do not leave contexts behind. the pool owns every context it creates, so
+//  destroying it frees the borrowed ones as well. the host threads that walk and revive large arrays are shared by
+//  all contexts of the pool, spawned on first use and attached to the jvm, instead of max_host_threads - 1 per
+//  context.
+class ContextPool : Noncopyable, Nonmovable {
+ public:
+  ContextPool(JNIEnv *j_env, Options &o, ClassResolver &r);
+  ~ContextPool();
+
+  // an idle context of the calling thread, or a new one, leased until release
+  Context *acquire();
+  // idle again on the calling thread, or deleted if the thread already keeps max_idle_contexts. a context that is
+  // not leased from this pool, e.g. a handle of a destroyed pool or one closed twice, is left alone and false is
+  // returned
+  bool release(Context *ctx);
+  // the context the calling thread keeps for static entries, created on first use and deleted when the thread exits
+  Context &local();
+  // delete the idle contexts of all threads, return how many
+  size_t trim();
+
+ private:
+  enum class State : uint8_t {
+    IDLE,
+    LEASED,
+    LOCAL,
+  };
+
+  // what the calling thread keeps in the pools, see context_pool.cxx
+  struct ThreadState;
+
+  static ThreadState &thread_state();
+
+  Context *take(State state);
+  // delete the idle contexts of the calling thread and local, which is nullptr if it has none here
+  void exit_thread(Context *local);
+
+  Options &o;
+  ClassResolver &r;
+  const uint64_t epoch;  // tells the local contexts of this pool from those of a destroyed one
+  std::mutex mu;
+  std::unordered_map<Context *, State> all;
+  std::unordered_map<std::thread::id, std::vector<Context *>> idle;
+  JavaVM *vm;
+  LazyHostPool hosts;  // outlives the contexts, which are deleted by the destructor
+};
+
+}  // namespace dpx::sd
@@ -240,6 +240,7 @@ struct FakeObject {
   const FakeObject *reference_at(uint32_t offset) const { return const_cast<FakeObject *>(this)->reference_at(offset); }
 
   // klass pointer must be placed after the mark
+  uint32_t klass_cptr() const { return parse_at<uint32_t>(sizeof(FakeObject)); }
   FakeKlass *klass_pointer() {
     return (FakeKlass *)JVMArgs::parse_metaspace_cptr(parse_at<uint32_t>(sizeof(FakeObject)));
   }
@@ -0,0 +1,93 @@
+#include "sd/native/host_pool.hxx"
+
+namespace dpx::sd {
+
+HostPool::HostPool(uint32_t n_thread, Job enter, Job exit) {
+  for (uint32_t i = 1; i < n_thread; i++) {
+    threads.emplace_back([this, i, enter, exit]() { loop(i, enter, exit); });
+  }
+}
+
+HostPool::~HostPool() {
+  {
+    std::lock_guard l(mu);
+    stop = true;
+  }
+  start_cv.notify_all();
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+void HostPool::run(const Job &job_) {
+  std::unique_lock busy(run_mu, std::try_to_lock);
+  if (!busy.owns_lock() || threads.empty()) {
+    job_(0);
+    return;
+  }
+  {
+    std::lock_guard l(mu);
+    job = &job_;
+    epoch++;
+    n_running = threads.size();
+  }
+  start_cv.notify_all();
+  try {
+    job_(0);
+  } catch (...) {
+    fail(std::current_exception());
+  }
+  std::exception_ptr e;
+  {
+    // the others still use job_, wait for them before it goes out of scope
+    std::unique_lock l(mu);
+    done_cv.wait(l, [this]() { return n_running == 0; });
+    job = nullptr;
+    std::swap(e, error);
+  }
+  if (e != nullptr) {
+    std::rethrow_exception(e);
+  }
+}
+
+void HostPool::fail(std::exception_ptr e) {
+  std::lock_guard l(mu);
+  if (error == nullptr) {
+    error = e;
+  }
+}
+
+void HostPool::loop(uint32_t idx, Job enter, Job exit) {
+  if (enter != nullptr) {
+    enter(idx);
+  }
+  uint64_t seen = 0;
+  while (true) {
+    const Job *current = nullptr;
+    {
+      std::unique_lock l(mu);
+      start_cv.wait(l, [&]() { return stop || epoch != seen; });
+      if (stop) {
+        break;
+      }
+      seen = epoch;
+      current = job;
+    }
+    try {
+      (*current)(idx);
+    } catch (...) {
+      fail(std::current_exception());
+    }
+    {
+      std::lock_guard l(mu);
+      if (--n_running == 0) {
+        done_cv.notify_one();
+      }
+    }
+  }
+  if (exit != nullptr) {
+    exit(idx);
+  }
+}
+
+}  // namespace dpx::sd
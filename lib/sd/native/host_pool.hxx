@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+
+namespace dpx::sd {
+
+// fixed host threads that run one job together, the caller takes part as thread 0, so a pool of n threads
+// spawns n - 1. enter and exit run on each spawned thread, e.g. to attach it to the jvm. a pool is shared by the
+// contexts of a ContextPool, one job runs at a time and a caller that finds the threads busy runs its job alone.
+class HostPool : Noncopyable, Nonmovable {
+ public:
+  using Job = std::function<void(uint32_t)>;
+
+  explicit HostPool(uint32_t n_thread, Job enter = nullptr, Job exit = nullptr);
+  ~HostPool();
+
+  uint32_t n_thread() const { return threads.size() + 1; }
+
+  // run job(idx) on every thread, return once all of them are done, even if one throws, and rethrow the first
+  // exception on the caller. if another job is running, only job(0) runs, on the caller, so a job must not count on
+  // the other threads to make progress
+  void run(const Job &job);
+
+ private:
+  void loop(uint32_t idx, Job enter, Job exit);
+  void fail(std::exception_ptr e);
+
+  std::vector<std::thread> threads;
+  std::mutex run_mu;  // held by the caller of the running job
+  std::mutex mu;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  const Job *job = nullptr;
+  uint64_t epoch = 0;
+  uint32_t n_running = 0;
+  bool stop = false;
+  std::exception_ptr error;  // the first one thrown by a job of this run
+};
+
+// a HostPool spawned on first use, so that a ContextPool that never meets a large array keeps no threads
+class LazyHostPool : Noncopyable, Nonmovable {
+ public:
+  explicit LazyHostPool(uint32_t n_thread_, HostPool::Job enter_ = nullptr, HostPool::Job exit_ = nullptr)
+      : n_thread(n_thread_), enter(std::move(enter_)), exit(std::move(exit_)) {}
+  ~LazyHostPool() = default;
+
+  HostPool &get() {
+    std::call_once(once, [this]() { pool = std::make_unique<HostPool>(n_thread, enter, exit); });
+    return *pool;
+  }
+
+ private:
+  uint32_t n_thread;
+  HostPool::Job enter;
+  HostPool::Job exit;
+  std::once_flag once;
+  std::unique_ptr<HostPool> pool;
+};
+
+}  // namespace dpx::sd
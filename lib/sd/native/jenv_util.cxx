@@ -124,6 +124,13 @@ std::optional<std::vector<jobject>> java_object_hashset_cvt_stl_vector(JNIEnv *j
   return v;
 }
 
+bool is_final_class(JNIEnv *j_env, jclass j_class) {
+  jclass classClass = j_env->FindClass("java/lang/Class");
+  jmethodID getModifiersMethod = j_env->GetMethodID(classClass, "getModifiers", "()I");
+  jint modifiers = j_env->CallIntMethod(j_class, getModifiersMethod);
+  j_env->DeleteLocalRef(classClass);
+  return (modifiers & JVM_ACC_FINAL) != 0;
+}
 
 jarray new_array(JNIEnv *j_env, basic_type_t t, uint32_t length) {
   switch (t) {
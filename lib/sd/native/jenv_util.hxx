@@ -17,6 +17,9 @@ std::optional<std::unordered_map<std::string, std::string>> java_str2str_hashmap
 
 std::optional<std::vector<jobject>> java_object_hashset_cvt_stl_vector(JNIEnv *j_env, jobject j_hash_set);
 
+// Class.getModifiers() has ACC_FINAL
+bool is_final_class(JNIEnv *j_env, jclass j_class);
+
 // primitive array
 jarray new_array(JNIEnv *j_env, basic_type_t t, uint32_t length);
 
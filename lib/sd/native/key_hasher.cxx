@@ -0,0 +1,492 @@
+#include "sd/native/key_hasher.hxx"
+
+#include <simdutf.h>
+
+#include <cassert>
+#include <cmath>
+
+#include "sd/native/class_resolver.hxx"
+
+namespace dpx::sd {
+
+namespace {
+
+// primitives are little endian in the output, as in the heap
+uint64_t load_bits(const uint8_t *raw, uint32_t size) {
+  uint64_t bits = 0;
+  memcpy(&bits, raw, size);
+  return bits;
+}
+
+// hashCode of the box of a primitive, whose bits are zero extended, in unsigned as hashCode wraps around
+uint32_t box_hash(basic_type_t type, uint64_t bits) {
+  switch (type) {
+    case T_BOOLEAN:
+      return (uint8_t)bits != 0 ? 1231 : 1237;
+    case T_BYTE:
+      return (int8_t)bits;
+    case T_CHAR:
+      return (uint16_t)bits;
+    case T_SHORT:
+      return (int16_t)bits;
+    case T_INT:
+      return (uint32_t)bits;
+    case T_FLOAT: {
+      // floatToIntBits collapses nans into one
+      float f = 0;
+      memcpy(&f, &bits, sizeof(f));
+      return std::isnan(f) ? 0x7FC00000u : (uint32_t)bits;
+    }
+    case T_DOUBLE: {
+      double d = 0;
+      memcpy(&d, &bits, sizeof(d));
+      if (std::isnan(d)) {
+        bits = 0x7FF8000000000000ull;
+      }
+      return (uint32_t)(bits ^ bits >> 32);
+    }
+    case T_LONG:
+      return (uint32_t)(bits ^ bits >> 32);
+    default:
+      unreachable();
+  }
+}
+
+// String.hashCode over the value bytes of a compact string
+uint32_t string_hash(const uint8_t *value, uint32_t length, uint8_t coder) {
+  uint32_t h = 0;
+  if (coder == CHAR_CODER_LATIN1) {
+    for (uint32_t i = 0; i < length; i++) {
+      h = 31 * h + value[i];
+    }
+  } else {
+    for (uint32_t i = 0; i + 1 < length; i += 2) {
+      h = 31 * h + (uint16_t)load_bits(value + i, sizeof(char16_t));
+    }
+  }
+  return h;
+}
+
+}  // namespace
+
+KeyHasher::KeyHasher(const ClassResolver &r, const Options &o, naive::BorrowedBuffer in, Off2Id *off2id)
+    : r(r), o(o), b(in), off2id(o.track_references ? off2id : nullptr) {}
+
+std::vector<KeyHasher::Slot> &KeyHasher::local_pending() {
+  thread_local std::vector<Slot> pending;
+  return pending;
+}
+
+std::vector<char16_t> &KeyHasher::local_chars() {
+  thread_local std::vector<char16_t> chars;
+  return chars;
+}
+
+KeyHasher::Head KeyHasher::read_head(Slot slot) {
+  if (o.compact_format) {
+    auto base = (uint32_t)b.offset();
+    auto head = b.get_varint();
+    switch (head & COMPACT_KIND_MASK) {
+      case COMPACT_NULL:
+        return {.kind = Kind::NUL, .base = base, .id = slot.id, .value = 0};
+      case COMPACT_REDIRECT:
+        return {.kind = Kind::REDIRECT, .base = base, .id = slot.id, .value = (uint32_t)b.get_varint()};
+      case COMPACT_PRESENT:
+        break;
+      default:
+        die("Corrupted head {:X} at {}", head, base);
+    }
+    auto id = slot.exact ? slot.id : (class_id_t)((head >> COMPACT_KIND_BITS) + MIN_CLASS_ID);
+    return present(base, id, o.enable_codecs && r.get_class_plan(id).has_codec());
+  }
+  b.skip_next_align_8();
+  auto base = (uint32_t)b.offset();
+  auto id = b.get<class_id_t>();
+  auto flag = b.get<flag_t>();
+  if (is_null_f(flag)) {
+    return {.kind = Kind::NUL, .base = base, .id = id, .value = 0};
+  }
+  if (is_redirect_f(flag)) {
+    return {.kind = Kind::REDIRECT, .base = base, .id = id, .value = b.get<uint32_t>()};
+  }
+  return present(base, id, is_codec_f(flag));
+}
+
+KeyHasher::Head KeyHasher::present(uint32_t base, class_id_t id, bool codec) {
+  auto info = r.get_class_info(id);
+  assert(!info.is_dummy());
+  if (info.is_enum()) {
+    uint32_t ordinal = o.compact_format ? b.get_varint() : b.get<uint32_t>();
+    return {.kind = Kind::ENUM, .base = base, .id = id, .value = ordinal};
+  }
+  // enums are never redirected to, as the walker does not track them
+  if (off2id != nullptr) {
+    off2id->insert(base, id);
+  }
+  if (codec) {
+    return {.kind = Kind::CODEC, .base = base, .id = id, .value = 0};
+  }
+  if (info.is_object()) {
+    if (!o.compact_format) {
+      b.skip_next_align_8();
+    }
+    return {.kind = Kind::OBJECT, .base = base, .id = id, .value = 0};
+  }
+  uint32_t length = 0;
+  if (o.compact_format) {
+    length = b.get_varint();
+  } else {
+    length = b.get<uint32_t>();
+    b.skip_next_align_8();
+  }
+  return {.kind = Kind::ARRAY, .base = base, .id = id, .value = length};
+}
+
+KeyHasher::Head KeyHasher::follow(const Head &head) {
+  TRACE("redirect offset: {}", head.value);
+  if (off2id == nullptr) {
+    die("Meet redirect at {}, but references are not tracked", head.base);
+  }
+  auto [id, found] = off2id->lookup(head.value);
+  if (!found) {
+    die("Dangling redirect at {} to {}", head.base, head.value);
+  }
+  b.seek(head.value);
+  // the record may be in an exact slot, whose compact head has no id
+  return read_head({.id = id, .exact = true});
+}
+
+std::optional<KeyHasher::Slot> KeyHasher::enter(const Head &head, uint32_t step, const element_index_t *index) {
+  if (head.kind == Kind::OBJECT || head.kind == Kind::CODEC) {
+    auto &plan = r.get_class_plan(head.id);
+    if ((head.kind == Kind::CODEC && plan.codec != ClassPlan::TUPLE2_CODEC) || step >= plan.refs.size()) {
+      return std::nullopt;
+    }
+    if (head.kind == Kind::OBJECT) {
+      b.skip(body_size(plan));
+    }
+    for (uint32_t i = 0; i < step; i++) {
+      skip_record({.id = plan.refs[i].id, .exact = plan.refs[i].exact});
+    }
+    return Slot{.id = plan.refs[step].id, .exact = plan.refs[step].exact};
+  }
+  if (head.kind == Kind::ARRAY) {
+    auto &plan = r.get_class_plan(head.id);
+    auto &elem = plan.info.get_field(0);
+    if (!is_reference_type(elem.type) || step >= head.value) {
+      return std::nullopt;
+    }
+    Slot slot = {.id = elem.id, .exact = plan.refs[0].exact};
+    uint32_t i = 0;
+    if (index != nullptr) {
+      // start from the last indexed element before the key
+      i = step / index->stride * index->stride;
+      b.seek(index->offsets[step / index->stride]);
+    }
+    for (; i < step; i++) {
+      skip_record(slot);
+    }
+    return slot;
+  }
+  return std::nullopt;
+}
+
+void KeyHasher::skip_record(Slot slot) {
+  // NOTICE: no recursion, the skipped records may be as deep as a long linked list
+  auto &pending = local_pending();
+  auto bottom = pending.size();
+  pending.push_back(slot);
+  while (pending.size() > bottom) {
+    auto next = pending.back();
+    pending.pop_back();
+    skip_body(read_head(next), pending);
+  }
+}
+
+void KeyHasher::skip_body(const Head &head, std::vector<Slot> &pending) {
+  switch (head.kind) {
+    case Kind::NUL:
+    case Kind::REDIRECT:
+    case Kind::ENUM: {
+      return;
+    }
+    case Kind::OBJECT: {
+      auto &plan = r.get_class_plan(head.id);
+      b.skip(body_size(plan));
+      push_members(plan, pending);
+      return;
+    }
+    case Kind::CODEC: {
+      // see ObjectWalker::do_walk_codec
+      auto &plan = r.get_class_plan(head.id);
+      if (plan.codec == ClassPlan::STRING_CODEC) {
+        b.skip(o.compact_format ? b.get_varint() >> 1 : b.get<uint32_t>() + sizeof(uint8_t));
+      } else if (plan.codec == ClassPlan::BOX_CODEC) {
+        get_box(plan);
+      } else {
+        push_members(plan, pending);
+      }
+      return;
+    }
+    case Kind::ARRAY: {
+      auto &plan = r.get_class_plan(head.id);
+      auto &elem = plan.info.get_field(0);
+      if (is_reference_type(elem.type)) {
+        pending.insert(pending.end(), head.value, Slot{.id = elem.id, .exact = plan.refs[0].exact});
+      } else if (elem.type == T_CHAR) {
+        skip_chars(head.value);
+      } else {
+        b.skip(plan.info.array_body_size(head.value));
+      }
+      return;
+    }
+  }
+  unreachable();
+}
+
+void KeyHasher::push_members(const ClassPlan &plan, std::vector<Slot> &pending) {
+  // in reverse, so that the first member is skipped first
+  for (auto iter = plan.refs.rbegin(); iter != plan.refs.rend(); iter++) {
+    pending.push_back({.id = iter->id, .exact = iter->exact});
+  }
+}
+
+void KeyHasher::skip_chars(uint32_t length) {
+  // see ObjectWalker::try_cvt_to_latin1 and ObjectWalker::cvt_utf16_to_utf8
+  if (o.enable_latin1_chars && b.get<uint8_t>() == CHAR_CODER_LATIN1) {
+    b.skip(length);
+  } else if (o.enable_utf16_to_utf8) {
+    b.skip(sizeof(uint32_t));
+    b.skip(b.get<uint32_t>());
+  } else {
+    b.skip(length * sizeof(char16_t));
+  }
+}
+
+std::optional<int32_t> KeyHasher::hash_record(Slot slot) {
+  auto head = read_head(slot);
+  if (head.kind != Kind::REDIRECT) {
+    return hash_body(head);
+  }
+  // hash the earlier record, then come back after the redirect
+  auto back = b.offset();
+  auto h = hash_body(follow(head));
+  b.seek(back);
+  return h;
+}
+
+std::optional<int32_t> KeyHasher::hash_body(const Head &head) {
+  switch (head.kind) {
+    case Kind::NUL:
+      return 0;
+    case Kind::ENUM:
+      return std::nullopt;  // an identity hash
+    case Kind::OBJECT:
+      return hash_object(r.get_class_plan(head.id));
+    case Kind::CODEC:
+      return hash_codec(r.get_class_plan(head.id));
+    case Kind::ARRAY:
+      return hash_array(r.get_class_plan(head.id), head.value);
+    case Kind::REDIRECT:
+      break;
+  }
+  unreachable();
+}
+
+std::optional<int32_t> KeyHasher::hash_object(const ClassPlan &plan) {
+  auto body = b.offset();
+  b.skip(body_size(plan));
+  if (plan.codec == ClassPlan::BOX_CODEC) {
+    auto value = b.raw_at(body + body_offset(plan, plan.codec_offset));
+    return (int32_t)box_hash(plan.codec_type, load_bits(value, type_size(plan.codec_type)));
+  }
+  // a String laid out otherwise has no codec, see ClassResolver::link_codec
+  if (plan.codec != ClassPlan::STRING_CODEC &&
+      (plan.refs.size() != 1 || plan.info.signature() != "Ljava/lang/String;")) {
+    return std::nullopt;
+  }
+  // the value array follows as a record of its own
+  auto head = read_head({.id = plan.refs[0].id, .exact = plan.refs[0].exact});
+  auto back = 0uz;
+  if (head.kind == Kind::REDIRECT) {
+    back = b.offset();
+    head = follow(head);
+  }
+  std::optional<int32_t> h = std::nullopt;
+  if (head.kind == Kind::ARRAY) {
+    auto elem_type = r.get_class_info(head.id).get_field(0).type;
+    if (elem_type == T_BYTE && plan.codec == ClassPlan::STRING_CODEC) {
+      auto coder = *b.raw_at(body + body_offset(plan, plan.codec_offset));
+      h = (int32_t)string_hash(b.raw(), head.value, coder);
+      b.skip(head.value);
+    } else if (elem_type == T_CHAR) {
+      h = (int32_t)hash_chars(head.value, 0);
+    }
+  }
+  if (back != 0) {
+    b.seek(back);
+  }
+  return h;
+}
+
+std::optional<int32_t> KeyHasher::hash_codec(const ClassPlan &plan) {
+  switch (plan.codec) {
+    case ClassPlan::STRING_CODEC: {
+      uint32_t length = 0;
+      uint8_t coder = 0;
+      if (o.compact_format) {
+        auto head = b.get_varint();
+        length = head >> 1;
+        coder = head & 1;
+      } else {
+        length = b.get<uint32_t>();
+        coder = b.get<uint8_t>();
+      }
+      auto h = string_hash(b.raw(), length, coder);
+      b.skip(length);
+      return (int32_t)h;
+    }
+    case ClassPlan::BOX_CODEC: {
+      return (int32_t)box_hash(plan.codec_type, get_box(plan));
+    }
+    case ClassPlan::TUPLE2_CODEC: {
+      return std::nullopt;  // scala hashes products by murmur3 of the members
+    }
+    default: {
+      unreachable();
+    }
+  }
+}
+
+std::optional<int32_t> KeyHasher::hash_array(const ClassPlan &plan, uint32_t length) {
+  // Arrays.deepHashCode for object arrays, Arrays.hashCode for primitive ones
+  auto &elem = plan.info.get_field(0);
+  uint32_t h = 1;
+  if (is_reference_type(elem.type)) {
+    Slot slot = {.id = elem.id, .exact = plan.refs[0].exact};
+    for (uint32_t i = 0; i < length; i++) {
+      auto e = hash_record(slot);
+      if (!e.has_value()) {
+        return std::nullopt;
+      }
+      h = 31 * h + (uint32_t)*e;
+    }
+    return (int32_t)h;
+  }
+  if (elem.type == T_CHAR) {
+    return (int32_t)hash_chars(length, h);
+  }
+  auto size = type_size(elem.type);
+  auto raw = b.raw();
+  for (uint32_t i = 0; i < length; i++) {
+    h = 31 * h + box_hash(elem.type, load_bits(raw + i * size, size));
+  }
+  b.skip(plan.info.array_body_size(length));
+  return (int32_t)h;
+}
+
+uint32_t KeyHasher::hash_chars(uint32_t length, uint32_t h) {
+  // see skip_chars
+  if (o.enable_latin1_chars && b.get<uint8_t>() == CHAR_CODER_LATIN1) {
+    auto latin1 = b.raw();
+    for (uint32_t i = 0; i < length; i++) {
+      h = 31 * h + latin1[i];
+    }
+    b.skip(length);
+    return h;
+  }
+  if (o.enable_utf16_to_utf8) {
+    b.skip(sizeof(uint32_t));
+    auto byte_size = b.get<uint32_t>();
+    auto &chars = local_chars();
+    chars.resize(length);
+    [[maybe_unused]] auto n =
+        simdutf::convert_utf8_to_utf16le(reinterpret_cast<const char *>(b.raw()), byte_size, chars.data());
+    assert(n == length);
+    for (auto c : chars) {
+      h = 31 * h + c;
+    }
+    b.skip(byte_size);
+    return h;
+  }
+  // unaligned in the compact format
+  auto raw = b.raw();
+  for (uint32_t i = 0; i < length; i++) {
+    h = 31 * h + (uint16_t)load_bits(raw + i * sizeof(char16_t), sizeof(char16_t));
+  }
+  b.skip(length * sizeof(char16_t));
+  return h;
+}
+
+uint64_t KeyHasher::get_box(const ClassPlan &plan) {
+  // see ObjectWalker::do_walk_codec
+  if (o.compact_format &&
+      (plan.codec_type == T_SHORT || plan.codec_type == T_INT || plan.codec_type == T_LONG)) {
+    return b.get_zigzag();
+  }
+  auto size = type_size(plan.codec_type);
+  auto bits = load_bits(b.raw(), size);
+  b.skip(size);
+  return bits;
+}
+
+uint32_t KeyHasher::body_size(const ClassPlan &plan) const {
+  if (!o.compact_format) {
+    return plan.info.object_body_size();
+  }
+  uint32_t size = 0;
+  for (auto &run : plan.prims) {
+    size += run.size;
+  }
+  return size;
+}
+
+uint32_t KeyHasher::body_offset(const ClassPlan &plan, uint16_t offset) const {
+  if (!o.compact_format) {
+    return offset;
+  }
+  // the compact format packs the primitive runs back to back
+  uint32_t packed = 0;
+  for (auto &run : plan.prims) {
+    if (offset >= run.offset && offset < run.offset + run.size) {
+      return packed + offset - run.offset;
+    }
+    packed += run.size;
+  }
+  unreachable();
+}
+
+std::optional<int32_t> KeyHasher::hash(const ClassResolver &resolver, const Options &o,
+                                       std::span<const uint32_t> path, naive::BorrowedBuffer in, Off2Id *off2id) {
+  KeyHasher k(resolver, o, in, off2id);
+  if (k.off2id != nullptr) {
+    k.off2id->clear();
+  }
+  auto header = (const meta_header_t *)k.b.raw_at(0);
+  auto index = header->index_offset != 0 ? (const element_index_t *)k.b.raw_at(header->index_offset) : nullptr;
+  k.b.skip(OBJECT_DATA_OFFSET);
+  // the root is not exact, as in ObjectWalker::walk
+  std::optional<Slot> slot = Slot{.id = UNREGISTERED_CLASS_ID, .exact = false};
+  for (auto i = 0uz; i < path.size() && slot.has_value(); i++) {
+    auto head = k.read_head(*slot);
+    if (head.kind == Kind::REDIRECT) {
+      head = k.follow(head);
+    }
+    // only the root array may have an element index
+    slot = k.enter(head, path[i], i == 0 ? index : nullptr);
+  }
+  auto h = slot.has_value() ? k.hash_record(*slot) : std::nullopt;
+  TRACE("key hash: {}", h.has_value() ? std::to_string(*h) : "none");
+  if (k.off2id != nullptr) {
+    k.off2id->clear();
+  }
+  return h;
+}
+
+uint32_t KeyHasher::partition(int32_t hash, uint32_t n_partition) {
+  // a non negative mod
+  auto raw = (int64_t)hash % n_partition;
+  return raw < 0 ? raw + n_partition : raw;
+}
+
+}  // namespace dpx::sd
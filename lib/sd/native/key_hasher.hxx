@@ -0,0 +1,93 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "memory/naive_buffer.hxx"
+#include "sd/native/class_info.hxx"
+#include "sd/native/class_plan.hxx"
+#include "sd/native/options.hxx"
+#include "sd/native/ptr_map.hxx"
+#include "sd/native/rw_buffer.hxx"
+
+namespace dpx::sd {
+
+class ClassResolver;
+
+using Off2Id = PtrMap<uint32_t, class_id_t>;
+
+// NOTICE:
+//  hashes the key of a serialized record as hashCode in java, without a jvm, so that a native partitioner can
+//  route records as they are. the key is reached by a path of member indices from the root, an index is into
+//  ClassPlan::refs for an object, i.e. in field offset order, and an element index for an object array, e.g. {0}
+//  is _1 of a Tuple2 and {} is the root itself. the records before the key are skipped as they are laid out, so
+//  keys near the root are the cheapest, a large root array with an element index is entered by the index.
+//  known hashes are those of String, the boxed primitives and null, and of java.util.Arrays.deepHashCode for arrays
+//  of them or of primitives, as an array itself only has an identity hash. enums have none either.
+class KeyHasher : Noncopyable, Nonmovable {
+ public:
+  // nullopt if the path leads to no member or the key has no known hash
+  // NOTICE: off2id is only used if track_references is set, the hasher clears it before use
+  static std::optional<int32_t> hash(const ClassResolver &resolver, const Options &o, std::span<const uint32_t> path,
+                                     naive::BorrowedBuffer in, Off2Id *off2id = nullptr);
+  // as org.apache.spark.HashPartitioner
+  static uint32_t partition(int32_t hash, uint32_t n_partition);
+
+ private:
+  struct Slot {
+    class_id_t id;  // declared class
+    bool exact;     // see ClassPlan::RefSlot
+  };
+
+  enum class Kind : uint8_t {
+    NUL,
+    REDIRECT,
+    ENUM,
+    OBJECT,
+    CODEC,
+    ARRAY,
+  };
+
+  // a record up to its body
+  struct Head {
+    Kind kind;
+    uint32_t base;
+    class_id_t id;
+    uint32_t value;  // redirect offset, ordinal or array length
+  };
+
+  KeyHasher(const ClassResolver &r, const Options &o, naive::BorrowedBuffer in, Off2Id *off2id);
+  ~KeyHasher() = default;
+
+  static std::vector<Slot> &local_pending();
+  static std::vector<char16_t> &local_chars();
+
+  Head read_head(Slot slot);
+  Head present(uint32_t base, class_id_t id, bool codec);
+  // move to the record a redirect points to
+  Head follow(const Head &head);
+  // skip the members before index step, and return the slot of the member at step
+  std::optional<Slot> enter(const Head &head, uint32_t step, const element_index_t *index);
+  void skip_record(Slot slot);
+  void skip_body(const Head &head, std::vector<Slot> &pending);
+  void push_members(const ClassPlan &plan, std::vector<Slot> &pending);
+  void skip_chars(uint32_t length);
+  std::optional<int32_t> hash_record(Slot slot);
+  std::optional<int32_t> hash_body(const Head &head);
+  std::optional<int32_t> hash_object(const ClassPlan &plan);
+  std::optional<int32_t> hash_codec(const ClassPlan &plan);
+  std::optional<int32_t> hash_array(const ClassPlan &plan, uint32_t length);
+  uint32_t hash_chars(uint32_t length, uint32_t h);
+  uint64_t get_box(const ClassPlan &plan);
+  // size of the body of an instance, and where a primitive field of it is in the body
+  uint32_t body_size(const ClassPlan &plan) const;
+  uint32_t body_offset(const ClassPlan &plan, uint16_t offset) const;
+
+  const ClassResolver &r;
+  const Options &o;
+  RWBuffer b;
+  Off2Id *off2id;  // offset of a record to its class, nullptr if references are not tracked
+};
+
+}  // namespace dpx::sd
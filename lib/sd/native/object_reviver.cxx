@@ -7,80 +7,68 @@
 
 namespace dpx::sd {
 
-ObjWithHandle ObjectReviver::do_parse_object(uint32_t base, ClassInfo info) {
-  b.skip_next_align_8();
-  auto handle = j_env->AllocObject(info.klass()->clazz());
+ObjWithHandle ObjectReviver::do_parse_object(uint32_t base, ClassInfo info, jobject target) {
+  if (!o.compact_format) {
+    b.skip_next_align_8();
+  }
+  auto reused = can_reuse(target, info) && claim(target);
+  auto handle = reused ? j_env->NewLocalRef(target) : j_env->AllocObject(info.klass()->clazz());
   if (handle == nullptr) {
     j_env->ExceptionDescribe();
     die("Fail to allocate object");
   }
   auto obj = FakeObject::from_jobject(handle);
-  TRACE("revive at: {} object: {} handle: {}", base, (void *)obj, (void *)handle);
-  // off2ref.insert_kv(base, handle);
+  TRACE("revive at: {} object: {} handle: {} reused: {}", base, (void *)obj, (void *)handle, reused);
+  mark_revived(base, handle);
   if (root == nullptr) {
     root = handle;
   }
+  // NOTICE: the object is fresh or reused, and no member is revived yet, so we can write its primitive fields
+  // in place, as cvt_utf8_to_utf16 does. primitive stores need no barrier. out of a critical region they go
+  // through jni, as a gc may move the object under the raw pointer.
+  auto &plan = r.get_class_plan(info.id());
+  if (o.compact_format) {
+    TRACE("revive {} id: {} n prim run {}", info.signature(), info.id(), plan.prims.size());
+    if (raw_stores) {
+      for (auto &run : plan.prims) {
+        memcpy(obj->raw(info.object_header_size() + run.offset), b.raw(), run.size);
+        b.skip(run.size);
+      }
+      return do_parse_members(obj, handle, plan, reused);
+    }
+    // lay the runs out as in the instance, then store field by field
+    body.resize(info.object_body_size());
+    for (auto &run : plan.prims) {
+      memcpy(body.data() + run.offset, b.raw(), run.size);
+      b.skip(run.size);
+    }
+    for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
+      if (auto &f = info.get_field(i); is_primitive_type(f.type)) {
+        set_primitive_field(handle, (jfieldID)f.j_field_id, f.type, body.data() + f.offset);
+      }
+    }
+    return do_parse_members(obj, handle, plan, reused);
+  }
   // b.get(obj->raw(info.object_header_size()), info.object_body_size());
   // INFO("{}", Hexdump(b.raw(), info.object_body_size()));
   auto field_base = b.offset();
   b.skip(info.object_body_size());
   // INFO("field_base: {}", field_base);
   TRACE("revive {} id: {} n non static field {}", info.signature(), info.id(), info.n_non_static_field());
+  if (plan.has_primitive_block() && raw_stores) {
+    memcpy(obj->raw(info.object_header_size() + plan.primitive_block_offset()),
+           b.raw_at(field_base + plan.primitive_block_offset()), plan.primitive_block_size());
+    return do_parse_members(obj, handle, plan, reused);
+  }
   for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
     auto &f = info.get_field(i);
     TRACE("field: {} id: {} offset: {} type: {}", i, f.id, f.offset, type2str(f.type));
     if (is_primitive_type(f.type)) {
-      switch (f.type) {
-        case T_BOOLEAN: {
-          jboolean v = *(jboolean *)b.raw_at(field_base + f.offset);
-          j_env->SetBooleanField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_BYTE: {
-          jbyte v = *(jbyte *)b.raw_at(field_base + f.offset);
-          j_env->SetByteField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_CHAR: {
-          jchar v = *(jchar *)b.raw_at(field_base + f.offset);
-          j_env->SetCharField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_SHORT: {
-          jshort v = *(jshort *)b.raw_at(field_base + f.offset);
-          j_env->SetShortField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_INT: {
-          jint v = *(jint *)b.raw_at(field_base + f.offset);
-          j_env->SetIntField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_FLOAT: {
-          jfloat v = *(jfloat *)b.raw_at(field_base + f.offset);
-          j_env->SetFloatField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_LONG: {
-          jlong v = *(jlong *)b.raw_at(field_base + f.offset);
-          j_env->SetLongField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        case T_DOUBLE: {
-          jdouble v = *(jdouble *)b.raw_at(field_base + f.offset);
-          j_env->SetDoubleField(handle, (jfieldID)f.j_field_id, v);
-          break;
-        }
-        default: {
-          unreachable();
-        }
-      }
+      set_primitive_field(handle, (jfieldID)f.j_field_id, f.type, b.raw_at(field_base + f.offset));
     } else if (is_reference_type(f.type)) {
       // NOTICE: as we cannot modify the input buffer, so we have to use place_at
       // to change the reference in the object, but in dpa, we can.
-      auto [member, member_handle] = parse(f.id);
-      j_env->SetObjectField(handle, (jfieldID)f.j_field_id, member_handle);
-      j_env->DeleteLocalRef(member_handle);
+      set_member(handle, (jfieldID)f.j_field_id, f.id, false, reused);
     }
   }
   if (j_env->ExceptionCheck()) {
@@ -90,13 +78,34 @@ ObjWithHandle ObjectReviver::do_parse_object(uint32_t base, ClassInfo info) {
   return {obj, handle};
 }
 
-ObjWithHandle ObjectReviver::do_parse_array(uint32_t base, ClassInfo info) {
-  auto length = b.get<uint32_t>();
+ObjWithHandle ObjectReviver::do_parse_members(FakeObject *obj, jobject handle, const ClassPlan &plan, bool reused) {
+  for (auto &ref : plan.refs) {
+    TRACE("ref at: {} id: {}", ref.offset, ref.id);
+    set_member(handle, (jfieldID)ref.j_field_id, ref.id, ref.exact, reused);
+  }
+  if (j_env->ExceptionCheck()) {
+    j_env->ExceptionDescribe();
+    die("Meet exception");
+  }
+  return {obj, handle};
+}
+
+ObjWithHandle ObjectReviver::do_parse_array(uint32_t base, ClassInfo info, jobject target) {
+  uint32_t length = 0;
+  if (o.compact_format) {
+    length = b.get_varint();
+  } else {
+    length = b.get<uint32_t>();
+    b.skip_next_align_8();
+  }
   TRACE("revive array with length: {}", length);
-  b.skip_next_align_8();
   auto &elem = info.get_field(0);
+  auto reused =
+      can_reuse(target, info) && (uint32_t)j_env->GetArrayLength((jarray)target) == length && claim(target);
   jobject handle = nullptr;
-  if (is_primitive_type(elem.type)) {
+  if (reused) {
+    handle = j_env->NewLocalRef(target);
+  } else if (is_primitive_type(elem.type)) {
     handle = new_array(j_env, elem.type, length);
   } else {
     auto elem_info = r.get_class_info(elem.id);
@@ -107,30 +116,49 @@ ObjWithHandle ObjectReviver::do_parse_array(uint32_t base, ClassInfo info) {
     die("Fail to allocate array");
   }
   auto obj = FakeObject::from_jobject(handle);
-  TRACE("revive at: {} object: {} handle: {}", base, (void *)obj, (void *)handle);
-  // off2ref.insert_kv(base, handle);
+  TRACE("revive at: {} object: {} handle: {} reused: {}", base, (void *)obj, (void *)handle, reused);
+  mark_revived(base, handle);
   if (root == nullptr) {
     root = handle;
   }
   TRACE("revive {} id: {}", info.signature(), info.id());
   if (is_primitive_type(elem.type)) {
     assert(info.dim() == 1);
-    if (elem.type == T_CHAR && o.enable_utf16_to_utf8) {
-      cvt_utf8_to_utf16(obj, info, length);
+    if (elem.type == T_CHAR && (o.enable_latin1_chars || o.enable_utf16_to_utf8)) {
+      // widen straight into the array, or into a scratch out of a critical region
+      if (!raw_stores) {
+        chars.resize(length);
+      }
+      auto u16_raw = raw_stores ? (char16_t *)obj->raw(info.array_header_size()) : chars.data();
+      if (o.enable_latin1_chars && try_cvt_from_latin1(u16_raw, length)) {
+        // stored as latin-1
+      } else if (o.enable_utf16_to_utf8) {
+        cvt_utf8_to_utf16(u16_raw, length);
+      } else {
+        memcpy(u16_raw, b.raw(), info.array_body_size(length));
+        b.skip(info.array_body_size(length));
+      }
+      if (!raw_stores) {
+        j_env->SetCharArrayRegion((jcharArray)handle, 0, length, (const jchar *)chars.data());
+      }
     } else {
       size_t j_length = j_env->GetArrayLength((jarray)handle);
       if (length != j_length) {
         die("{} {}", length, j_length);
       }
       // b.get(obj->raw(info.array_header_size()), info.array_body_size(length));
-      j_env->SetByteArrayRegion((jbyteArray)handle, 0, length, (const jbyte *)b.raw_at(b.offset()));
+      // same as above, the array is fresh or reused, copy the elements in place instead of a region call
+      if (raw_stores) {
+        memcpy(obj->raw(info.array_header_size()), b.raw_at(b.offset()), info.array_body_size(length));
+      } else {
+        set_primitive_elements((jarray)handle, elem.type, length, b.raw());
+      }
       b.skip(info.array_body_size(length));
     }
   } else if (is_reference_type(elem.type)) {
+    auto exact = r.get_class_plan(info.id()).refs[0].exact;
     for (uint32_t i = 0; i < length; i++) {
-      auto [member, member_handle] = parse(elem.id);
-      j_env->SetObjectArrayElement((jobjectArray)handle, i, member_handle);
-      j_env->DeleteLocalRef(member_handle);
+      set_element((jobjectArray)handle, i, elem.id, exact, reused);
     }
   } else {
     unreachable();
@@ -142,7 +170,119 @@ ObjWithHandle ObjectReviver::do_parse_array(uint32_t base, ClassInfo info) {
   return {obj, handle};
 }
 
-ObjWithHandle ObjectReviver::parse(class_id_t expected_id) {
+ObjWithHandle ObjectReviver::do_parse_codec(uint32_t base, const ClassPlan &plan) {
+  auto info = plan.info;
+  auto header_size = info.object_header_size();
+  auto handle = j_env->AllocObject(info.klass()->clazz());
+  if (handle == nullptr) {
+    j_env->ExceptionDescribe();
+    die("Fail to allocate object");
+  }
+  auto obj = FakeObject::from_jobject(handle);
+  TRACE("revive at: {} object: {} handle: {} codec: {}", base, (void *)obj, (void *)handle, (int)plan.codec);
+  mark_revived(base, handle);
+  if (root == nullptr) {
+    root = handle;
+  }
+  switch (plan.codec) {
+    case ClassPlan::STRING_CODEC: {
+      uint32_t length = 0;
+      uint8_t coder = 0;
+      if (o.compact_format) {
+        auto head = b.get_varint();
+        length = head >> 1;
+        coder = head & 1;
+      } else {
+        length = b.get<uint32_t>();
+        coder = b.get<uint8_t>();
+      }
+      if (plan.codec_type == T_CHAR) {
+        parse_string_chars(handle, plan, length, coder);
+        break;
+      }
+      auto value = new_array(j_env, T_BYTE, length);
+      if (value == nullptr) {
+        j_env->ExceptionDescribe();
+        die("Fail to allocate array");
+      }
+      // the allocation may have moved the string if no critical region is held, so locate it again
+      if (raw_stores) {
+        FakeObject::from_jobject(handle)->place_at(header_size + plan.codec_offset, coder);
+        auto value_obj = FakeObject::from_jobject(value);
+        memcpy(value_obj->raw(value_obj->array_header_size()), b.raw(), length);
+      } else {
+        j_env->SetByteField(handle, (jfieldID)plan.codec_field_id, (jbyte)coder);
+        j_env->SetByteArrayRegion(value, 0, length, (const jbyte *)b.raw());
+      }
+      b.skip(length);
+      j_env->SetObjectField(handle, (jfieldID)plan.refs[0].j_field_id, value);
+      j_env->DeleteLocalRef(value);
+      break;
+    }
+    case ClassPlan::BOX_CODEC: {
+      uint8_t bits[sizeof(jlong)];
+      auto value = raw_stores ? (uint8_t *)obj->raw(header_size + plan.codec_offset) : bits;
+      if (o.compact_format && plan.codec_type == T_SHORT) {
+        *(jshort *)value = b.get_zigzag();
+      } else if (o.compact_format && plan.codec_type == T_INT) {
+        *(jint *)value = b.get_zigzag();
+      } else if (o.compact_format && plan.codec_type == T_LONG) {
+        *(jlong *)value = b.get_zigzag();
+      } else {
+        memcpy(value, b.raw(), type_size(plan.codec_type));
+        b.skip(type_size(plan.codec_type));
+      }
+      if (!raw_stores) {
+        set_primitive_field(handle, (jfieldID)plan.codec_field_id, plan.codec_type, bits);
+      }
+      break;
+    }
+    case ClassPlan::TUPLE2_CODEC: {
+      return do_parse_members(obj, handle, plan, false);
+    }
+    default: {
+      unreachable();
+    }
+  }
+  if (j_env->ExceptionCheck()) {
+    j_env->ExceptionDescribe();
+    die("Meet exception");
+  }
+  return {obj, handle};
+}
+
+void ObjectReviver::parse_string_chars(jobject handle, const ClassPlan &plan, uint32_t length, uint8_t coder) {
+  // see ObjectWalker::put_string_chars, length is that of the bytes
+  auto n = coder == CHAR_CODER_LATIN1 ? length : length / (uint32_t)sizeof(char16_t);
+  auto value = new_array(j_env, T_CHAR, n);
+  if (value == nullptr) {
+    j_env->ExceptionDescribe();
+    die("Fail to allocate array");
+  }
+  if (!raw_stores) {
+    chars.resize(n);
+  }
+  auto value_obj = FakeObject::from_jobject(value);
+  auto u16_raw = raw_stores ? (char16_t *)value_obj->raw(value_obj->array_header_size()) : chars.data();
+  if (coder == CHAR_CODER_LATIN1) {
+    [[maybe_unused]] auto actual_length =
+        simdutf::convert_latin1_to_utf16le(reinterpret_cast<const char *>(b.raw()), n, u16_raw);
+    assert(actual_length == n);
+  } else {
+    memcpy(u16_raw, b.raw(), length);
+  }
+  b.skip(length);
+  if (!raw_stores) {
+    j_env->SetCharArrayRegion((jcharArray)value, 0, n, (const jchar *)chars.data());
+  }
+  j_env->SetObjectField(handle, (jfieldID)plan.refs[0].j_field_id, value);
+  j_env->DeleteLocalRef(value);
+}
+
+ObjWithHandle ObjectReviver::parse(class_id_t expected_id, bool exact, jobject target) {
+  if (o.compact_format) {
+    return parse_compact(expected_id, exact, target);
+  }
   b.skip_next_align_8();
   auto base = b.offset();
   auto id = b.get<class_id_t>();
@@ -152,12 +292,7 @@ ObjWithHandle ObjectReviver::parse(class_id_t expected_id) {
     return {nullptr, nullptr};
   }
   if (is_redirect_f(flag)) {
-    // auto offset = b.get<uint32_t>();
-    // TRACE("redirect offset: {}", offset);
-    // auto [handle, found] = off2ref.lookup_v(offset);
-    // assert(found);
-    // return {FakeObject::from_jobject(handle), handle};
-    die("can not be redirect");
+    return parse_redirect(base, b.get<uint32_t>());
   }
   auto info = r.get_class_info(id);
   assert(!info.is_dummy());
@@ -165,37 +300,271 @@ ObjWithHandle ObjectReviver::parse(class_id_t expected_id) {
   if (info.is_enum()) {
     assert(is_enum_f(flag));
     auto h = info.get_enum(b.get<uint32_t>());
-    // off2ref.insert_kv(base, h.second);
     return h;
     return {nullptr, nullptr};
+  } else if (is_codec_f(flag)) {
+    return do_parse_codec(base, r.get_class_plan(id));
   } else if (info.is_object()) {
     assert(is_object_f(flag));
-    return do_parse_object(base, info);
+    return do_parse_object(base, info, target);
   } else if (info.is_array()) {
     assert(is_array_f(flag));
-    return do_parse_array(base, info);
+    return do_parse_array(base, info, target);
   } else {
     unreachable();
   }
 }
 
+ObjWithHandle ObjectReviver::parse_compact(class_id_t expected_id, bool exact, jobject target) {
+  auto base = b.offset();
+  auto head = b.get_varint();
+  TRACE("expected id: {} base: {}, head: {:X}", expected_id, base, head);
+  switch (head & COMPACT_KIND_MASK) {
+    case COMPACT_NULL:
+      return {nullptr, nullptr};
+    case COMPACT_REDIRECT:
+      return parse_redirect(base, b.get_varint());
+    case COMPACT_PRESENT:
+      break;
+    default:
+      die("Corrupted head {:X} at {}", head, base);
+  }
+  auto id = exact ? expected_id : (class_id_t)((head >> COMPACT_KIND_BITS) + MIN_CLASS_ID);
+  auto info = r.get_class_info(id);
+  assert(!info.is_dummy());
+  if (info.is_enum()) {
+    return info.get_enum(b.get_varint());
+  } else if (auto &plan = r.get_class_plan(id); o.enable_codecs && plan.has_codec()) {
+    return do_parse_codec(base, plan);
+  } else if (info.is_object()) {
+    return do_parse_object(base, info, target);
+  } else if (info.is_array()) {
+    return do_parse_array(base, info, target);
+  } else {
+    unreachable();
+  }
+}
+
+ObjWithHandle ObjectReviver::parse_redirect(uint32_t base, uint32_t offset) {
+  TRACE("redirect offset: {}", offset);
+  if (off2ref == nullptr) {
+    die("Meet redirect at {}, but references are not tracked", base);
+  }
+  auto [handle, found] = off2ref->lookup(offset);
+  if (!found) {
+    die("Dangling redirect at {} to {}", base, offset);
+  }
+  // the caller deletes the returned local reference
+  return {FakeObject::from_jobject(handle), j_env->NewLocalRef(handle)};
+}
+
 jobject ObjectReviver::revive(JNIEnv *j_env, const FakeKlass *klass, ClassResolver &resolver, const Options &o,
-                              naive::BorrowedBuffer ctx, naive::BorrowedBuffer in) {
+                              naive::BorrowedBuffer ctx, naive::BorrowedBuffer in, Off2Ref *off2ref) {
   auto info = resolver.get_class_info(klass);
   assert(!info.is_dummy());
-  ObjectReviver r(j_env, resolver, o, ctx, in);
+  ObjectReviver r(j_env, resolver, o, ctx, in, off2ref);
   auto h = (meta_header_t *)r.b.raw_at(0);
   r.b.skip(OBJECT_DATA_OFFSET);
   // TRACE("{}", Hexdump(in.data(), h->total_length));
-  TRACE("begin offset: {}", r.b.offset());
-  r.parse(info.id());
-  TRACE("end offset: {}", r.b.offset());
-  return r.root;
+  return r.parse_root(info.id(), nullptr);
+}
+
+jobject ObjectReviver::revive_into(JNIEnv *j_env, jobject target, ClassResolver &resolver, const Options &o,
+                                   naive::BorrowedBuffer ctx, naive::BorrowedBuffer in, ReusedSet &reused,
+                                   Off2Ref *off2ref) {
+  auto info = resolver.get_class_info(FakeObject::from_jobject(target)->klass_pointer());
+  if (info.is_dummy()) {
+    die("Deserialize into an instance of an unregistered class");
+  }
+  ObjectReviver r(j_env, resolver, o, ctx, in, off2ref);
+  reused.clear();
+  r.reused = &reused;
+  r.b.skip(OBJECT_DATA_OFFSET);
+  return r.parse_root(info.id(), target);
+}
+
+jobject ObjectReviver::parse_root(class_id_t id, jobject target) {
+  if (off2ref == nullptr) {
+    TRACE("begin offset: {}", b.offset());
+    parse(id, false, target);
+    TRACE("end offset: {}", b.offset());
+    return root;
+  }
+  // NOTICE: the references held for redirects live in a frame of their own, grown with the graph by mark_revived
+  // and popped at once, which is cheaper than a global reference per object
+  off2ref->clear();
+  if (j_env->PushLocalFrame(LOCAL_REFS_STEP) != JNI_OK) {
+    die("Fail to push local frame");
+  }
+  try {
+    TRACE("begin offset: {}", b.offset());
+    parse(id, false, target);
+    TRACE("end offset: {}", b.offset());
+  } catch (...) {
+    off2ref->clear();
+    j_env->PopLocalFrame(nullptr);
+    throw;
+  }
+  off2ref->clear();
+  return j_env->PopLocalFrame(root);
+}
+
+ClassInfo ObjectReviver::root_info(ClassResolver &resolver, const Options &o, naive::BorrowedBuffer in) {
+  RWBuffer b(in);
+  b.skip(OBJECT_DATA_OFFSET);
+  // the root is not exact, so its id is always there
+  auto id = o.compact_format ? (class_id_t)((b.get_varint() >> COMPACT_KIND_BITS) + MIN_CLASS_ID)
+                             : b.get<class_id_t>();
+  return resolver.get_class_info(id);
+}
+
+void ObjectReviver::revive_elements(JNIEnv *j_env, ClassInfo info, uint32_t n, uint32_t offset,
+                                    ClassResolver &resolver, const Options &o, naive::BorrowedBuffer in,
+                                    jobjectArray part) {
+  // out of a critical region, see raw_stores
+  ObjectReviver r(j_env, resolver, o, in, in, nullptr, false);
+  r.b.skip(offset);
+  auto &elem = info.get_field(0);
+  auto exact = resolver.get_class_plan(info.id()).refs[0].exact;
+  TRACE("revive {} elements of {} from {}", n, info.signature(), offset);
+  for (uint32_t i = 0; i < n; i++) {
+    auto [member, member_handle] = r.parse(elem.id, exact);
+    j_env->SetObjectArrayElement(part, i, member_handle);
+    j_env->DeleteLocalRef(member_handle);
+  }
+  if (j_env->ExceptionCheck()) {
+    j_env->ExceptionDescribe();
+    die("Meet exception");
+  }
+}
+
+void ObjectReviver::mark_revived(uint32_t base, jobject handle) {
+  if (off2ref != nullptr) {
+    // hold an extra local reference, as the parent deletes its own once the member is set. the frame of parse_root
+    // makes room for the next step of them, plus those the parents hold on the way down
+    if (off2ref->size() % LOCAL_REFS_STEP == 0 &&
+        j_env->EnsureLocalCapacity(off2ref->size() + 2 * LOCAL_REFS_STEP) != JNI_OK) {
+      die("Fail to ensure {} local references", off2ref->size() + 2 * LOCAL_REFS_STEP);
+    }
+    off2ref->insert(base, j_env->NewLocalRef(handle));
+  }
+}
+
+bool ObjectReviver::can_reuse(jobject target, ClassInfo info) const {
+  // immutable instances may be shared or cached, e.g. Integer.valueOf, so they are never overwritten
+  return target != nullptr && !r.get_class_plan(info.id()).is_immutable() &&
+         FakeObject::from_jobject(target)->klass_pointer() == info.klass();
+}
+
+bool ObjectReviver::claim(jobject target) {
+  // a second overwrite would leave two members of the record on one instance, or clobber an ancestor that is
+  // still being revived
+  return reused != nullptr && reused->insert(FakeObject::from_jobject(target), true);
 }
 
-void ObjectReviver::cvt_utf8_to_utf16(const FakeObject *obj, ClassInfo info, uint32_t length) {
+void ObjectReviver::set_member(jobject handle, jfieldID j_field_id, class_id_t id, bool exact, bool reused) {
+  auto current = reused ? j_env->GetObjectField(handle, j_field_id) : nullptr;
+  auto [member, member_handle] = parse(id, exact, current);
+  // a reused member is already in place
+  if (current == nullptr || !j_env->IsSameObject(current, member_handle)) {
+    j_env->SetObjectField(handle, j_field_id, member_handle);
+  }
+  j_env->DeleteLocalRef(member_handle);
+  j_env->DeleteLocalRef(current);
+}
+
+void ObjectReviver::set_element(jobjectArray handle, uint32_t i, class_id_t id, bool exact, bool reused) {
+  auto current = reused ? j_env->GetObjectArrayElement(handle, i) : nullptr;
+  auto [member, member_handle] = parse(id, exact, current);
+  if (current == nullptr || !j_env->IsSameObject(current, member_handle)) {
+    j_env->SetObjectArrayElement(handle, i, member_handle);
+  }
+  j_env->DeleteLocalRef(member_handle);
+  j_env->DeleteLocalRef(current);
+}
+
+void ObjectReviver::set_primitive_field(jobject handle, jfieldID j_field_id, basic_type_t type, const uint8_t *src) {
+  switch (type) {
+    case T_BOOLEAN: {
+      j_env->SetBooleanField(handle, j_field_id, *(const jboolean *)src);
+      break;
+    }
+    case T_BYTE: {
+      j_env->SetByteField(handle, j_field_id, *(const jbyte *)src);
+      break;
+    }
+    case T_CHAR: {
+      j_env->SetCharField(handle, j_field_id, *(const jchar *)src);
+      break;
+    }
+    case T_SHORT: {
+      j_env->SetShortField(handle, j_field_id, *(const jshort *)src);
+      break;
+    }
+    case T_INT: {
+      j_env->SetIntField(handle, j_field_id, *(const jint *)src);
+      break;
+    }
+    case T_FLOAT: {
+      j_env->SetFloatField(handle, j_field_id, *(const jfloat *)src);
+      break;
+    }
+    case T_LONG: {
+      j_env->SetLongField(handle, j_field_id, *(const jlong *)src);
+      break;
+    }
+    case T_DOUBLE: {
+      j_env->SetDoubleField(handle, j_field_id, *(const jdouble *)src);
+      break;
+    }
+    default: {
+      unreachable();
+    }
+  }
+}
+
+void ObjectReviver::set_primitive_elements(jarray handle, basic_type_t type, uint32_t length, const uint8_t *src) {
+  switch (type) {
+    case T_BOOLEAN: {
+      j_env->SetBooleanArrayRegion((jbooleanArray)handle, 0, length, (const jboolean *)src);
+      break;
+    }
+    case T_BYTE: {
+      j_env->SetByteArrayRegion((jbyteArray)handle, 0, length, (const jbyte *)src);
+      break;
+    }
+    case T_CHAR: {
+      j_env->SetCharArrayRegion((jcharArray)handle, 0, length, (const jchar *)src);
+      break;
+    }
+    case T_SHORT: {
+      j_env->SetShortArrayRegion((jshortArray)handle, 0, length, (const jshort *)src);
+      break;
+    }
+    case T_INT: {
+      j_env->SetIntArrayRegion((jintArray)handle, 0, length, (const jint *)src);
+      break;
+    }
+    case T_FLOAT: {
+      j_env->SetFloatArrayRegion((jfloatArray)handle, 0, length, (const jfloat *)src);
+      break;
+    }
+    case T_LONG: {
+      j_env->SetLongArrayRegion((jlongArray)handle, 0, length, (const jlong *)src);
+      break;
+    }
+    case T_DOUBLE: {
+      j_env->SetDoubleArrayRegion((jdoubleArray)handle, 0, length, (const jdouble *)src);
+      break;
+    }
+    default: {
+      unreachable();
+    }
+  }
+}
+
+void ObjectReviver::cvt_utf8_to_utf16(char16_t *u16_raw, uint32_t length) {
   auto origin_byte_size [[maybe_unused]] = b.get<uint32_t>();
-  auto u16_raw = (char16_t *)obj->raw(info.array_header_size());
   auto actual_byte_size = b.get<uint32_t>();
   auto u8_raw = b.raw();
   uint32_t actual_length =
@@ -205,4 +574,17 @@ void ObjectReviver::cvt_utf8_to_utf16(const FakeObject *obj, ClassInfo info, uin
   b.skip(actual_byte_size);
 }
 
+bool ObjectReviver::try_cvt_from_latin1(char16_t *u16_raw, uint32_t length) {
+  auto coder = b.get<uint8_t>();
+  if (coder != CHAR_CODER_LATIN1) {
+    assert(coder == CHAR_CODER_UTF16);
+    return false;
+  }
+  [[maybe_unused]] auto actual_length =
+      simdutf::convert_latin1_to_utf16le(reinterpret_cast<const char *>(b.raw()), length, u16_raw);
+  assert(actual_length == length);
+  b.skip(length);
+  return true;
+}
+
 }  // namespace dpx::sd
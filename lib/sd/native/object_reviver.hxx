@@ -2,40 +2,100 @@
 
 #include <jni.h>
 
+#include <vector>
+
 #include "memory/naive_buffer.hxx"
 #include "sd/native/class_info.hxx"
+#include "sd/native/class_plan.hxx"
 #include "sd/native/fake.hxx"
 #include "sd/native/map.hxx"
 #include "sd/native/options.hxx"
+#include "sd/native/ptr_map.hxx"
 #include "sd/native/rw_buffer.hxx"
 
 namespace dpx::sd {
 
 class ClassResolver;
 
+using Off2Ref = PtrMap<uint32_t, jobject>;
+using ReusedSet = PtrMap<const FakeObject *, bool>;
+
 class ObjectReviver : Noncopyable, Nonmovable {
  public:
+  // NOTICE: off2ref is only used if track_references is set, the reviver clears it before use
   static jobject revive(JNIEnv *j_env, const FakeKlass *klass, ClassResolver &resolver, const Options &o,
-                        naive::BorrowedBuffer ctx, naive::BorrowedBuffer in);
+                        naive::BorrowedBuffer ctx, naive::BorrowedBuffer in, Off2Ref *off2ref = nullptr);
+  // revive into target and the mutable members it reaches where their classes match, and allocate the rest.
+  // return target, or a fresh object if the record is of another class than target.
+  // NOTICE: each instance of the target graph is overwritten at most once, one reached again through a shared
+  // member or a cycle is left as is and a fresh object is allocated in its place. reused records them, the reviver
+  // clears it before use. the caller holds a critical region, so the addresses of the instances are stable.
+  static jobject revive_into(JNIEnv *j_env, jobject target, ClassResolver &resolver, const Options &o,
+                             naive::BorrowedBuffer ctx, naive::BorrowedBuffer in, ReusedSet &reused,
+                             Off2Ref *off2ref = nullptr);
+  // NOTICE: for ParallelReviver, which revives ranges of the elements of a root object array at once.
+  // root_info is the class of the root record. revive_elements revives n elements of the root array info from
+  // offset, the record of the first one, into part. neither tracks references. revive_elements runs out of a
+  // critical region and stores through jni, see raw_stores.
+  static ClassInfo root_info(ClassResolver &resolver, const Options &o, naive::BorrowedBuffer in);
+  static void revive_elements(JNIEnv *j_env, ClassInfo info, uint32_t n, uint32_t offset, ClassResolver &resolver,
+                              const Options &o, naive::BorrowedBuffer in, jobjectArray part);
 
  private:
-  ObjectReviver(JNIEnv *j_env, ClassResolver &r, const Options &o, naive::BorrowedBuffer ctx, naive::BorrowedBuffer in)
-      : j_env(j_env), r(r), o(o), b(in), root(nullptr)
-      // , off2ref(ctx)
-      {}
+  ObjectReviver(JNIEnv *j_env, ClassResolver &r, const Options &o, [[maybe_unused]] naive::BorrowedBuffer ctx,
+                naive::BorrowedBuffer in, Off2Ref *off2ref, bool raw_stores = true)
+      : j_env(j_env),
+        r(r),
+        o(o),
+        b(in),
+        root(nullptr),
+        off2ref(o.track_references ? off2ref : nullptr),
+        reused(nullptr),
+        raw_stores(raw_stores) {}
   ~ObjectReviver() = default;
 
-  ObjWithHandle do_parse_object(uint32_t base, ClassInfo info);
-  ObjWithHandle do_parse_array(uint32_t base, ClassInfo info);
-  ObjWithHandle parse(class_id_t expected_id);
-  void cvt_utf8_to_utf16(const FakeObject *obj, ClassInfo info, uint32_t length);
+  // local references made room for at once when references are tracked
+  constexpr static uint32_t LOCAL_REFS_STEP = 1024;
+
+  // parse the root record and return the root, in a local frame of its own when references are tracked
+  jobject parse_root(class_id_t id, jobject target);
+  // target: an existing instance to overwrite instead of allocating, nullptr if there is none
+  ObjWithHandle do_parse_object(uint32_t base, ClassInfo info, jobject target);
+  ObjWithHandle do_parse_members(FakeObject *obj, jobject handle, const ClassPlan &plan, bool reused);
+  ObjWithHandle do_parse_array(uint32_t base, ClassInfo info, jobject target);
+  // always allocates, as the classes with a codec are immutable or tiny, see ObjectWalker::do_walk_codec
+  ObjWithHandle do_parse_codec(uint32_t base, const ClassPlan &plan);
+  void parse_string_chars(jobject handle, const ClassPlan &plan, uint32_t length, uint8_t coder);
+  // exact: the declared class is final, see ClassPlan::RefSlot
+  ObjWithHandle parse(class_id_t expected_id, bool exact = false, jobject target = nullptr);
+  ObjWithHandle parse_compact(class_id_t expected_id, bool exact, jobject target);
+  ObjWithHandle parse_redirect(uint32_t base, uint32_t offset);
+  void mark_revived(uint32_t base, jobject handle);
+  bool can_reuse(jobject target, ClassInfo info) const;
+  // false if target is already overwritten in this revive
+  bool claim(jobject target);
+  void set_member(jobject handle, jfieldID j_field_id, class_id_t id, bool exact, bool reused);
+  void set_element(jobjectArray handle, uint32_t i, class_id_t id, bool exact, bool reused);
+  // src holds the value as laid out in the instance or the array body
+  void set_primitive_field(jobject handle, jfieldID j_field_id, basic_type_t type, const uint8_t *src);
+  void set_primitive_elements(jarray handle, basic_type_t type, uint32_t length, const uint8_t *src);
+  void cvt_utf8_to_utf16(char16_t *u16_raw, uint32_t length);
+  bool try_cvt_from_latin1(char16_t *u16_raw, uint32_t length);
 
   JNIEnv *j_env;
   ClassResolver &r;
   const Options &o;
   RWBuffer b;
-  jobject root;                              // we only need to return the root object
-  // Map<uint32_t, jobject, 4096, 23> off2ref;  // 72 KB+
+  jobject root;       // we only need to return the root object
+  Off2Ref *off2ref;   // offset to a local reference of the revived object, nullptr if references are not tracked
+  ReusedSet *reused;  // instances of the target overwritten so far, nullptr out of revive_into
+  // NOTICE: primitive values are written straight into the revived objects, which is only safe while the caller
+  // holds a critical region, so that no gc moves them under the raw pointers. the attached threads of
+  // ParallelReviver hold none and allocate concurrently, so they go through Set<Type>Field and
+  // Set<Type>ArrayRegion instead, with scratch images of the instance body and the widened chars.
+  const bool raw_stores;
+  std::vector<uint8_t> body;
+  std::vector<char16_t> chars;
 };
 
 }  // namespace dpx::sd
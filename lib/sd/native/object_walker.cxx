@@ -2,57 +2,75 @@
 
 #include <simdutf.h>
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
 
 #include "sd/common/basic_type.h"
 #include "sd/native/class_resolver.hxx"
+#include "sd/native/oop_decode.hxx"
 
 namespace dpx::sd {
 
-void ObjectWalker::do_walk_object(const FakeObject *obj, ClassInfo info) {
-  TRACE("walk {} id: {} n non static field: {}", info.signature(), info.id(), info.n_non_static_field());
+void ObjectWalker::do_walk_object(const FakeObject *obj, const ClassPlan &plan) {
+  auto info = plan.info;
+  TRACE("walk {} id: {} n ref: {}", info.signature(), info.id(), plan.refs.size());
   TRACE("current offset: {}", b.offset());
-  assert(b.offset() % 8 == 0);
-  b.put(info.id());
-  b.put(OBJECT_FLAG);
-  b.fill_next_align_8();
-  auto obj_base = b.offset();
-  b.put(obj->raw(info.object_header_size()), info.object_body_size());
-  for (uint32_t i = 0; i < info.n_non_static_field(); i++) {
-    auto &f = info.get_field(i);
-    TRACE("field: {} id: {}", i, f.id);
-    if (is_primitive_type(f.type)) {
-      continue;
+  uint32_t obj_base = 0;
+  if (o.compact_format) {
+    // reference fields are left out, their members follow
+    for (auto &run : plan.prims) {
+      b.put(obj->raw(info.object_header_size() + run.offset), run.size);
     }
-    assert(is_reference_type(f.type));
+  } else {
+    assert(b.offset() % 8 == 0);
+    b.put(info.id());
+    b.put(OBJECT_FLAG);
+    b.fill_next_align_8();
+    obj_base = b.offset();
+    b.put(obj->raw(info.object_header_size()), info.object_body_size());
+  }
+  if (plan.is_leaf()) {
+    return;
+  }
+  // decode all members at once and prefetch them, so that their misses overlap,
+  // then push them in reverse, the first member is walked first as it used to be
+  auto top = stack.size();
+  stack.resize(top + plan.refs.size());
+  for (auto i = 0uz; i < plan.refs.size(); i++) {
+    auto &ref = plan.refs[i];
+    TRACE("ref at: {} id: {} exact: {}", ref.offset, ref.id, ref.exact);
     // here we can access the buffer instead
-    auto f_offset = obj_base + f.offset;
-    auto member_cptr = b.get_at<uint32_t>(f_offset);
-    auto member = (const FakeObject *)JVMArgs::parse_heap_cptr(member_cptr);
-    auto member_offset = walk(member, f.id);
-    b.put_at(member_offset, f_offset);
+    uint32_t f_offset = o.compact_format ? NO_PATCH : obj_base + ref.offset;
+    auto member = o.compact_format ? obj->reference_at(info.object_header_size() + ref.offset)
+                                   : (const FakeObject *)JVMArgs::parse_heap_cptr(b.get_at<uint32_t>(f_offset));
+    if (member != nullptr) {
+      __builtin_prefetch(member);
+    }
+    stack[top + plan.refs.size() - 1 - i] = {
+        .obj = member,
+        .cache = &ref.klass_cache,
+        .patch_at = f_offset,
+        .id = ref.id,
+        .exact = ref.exact,
+    };
   }
 }
 
-void ObjectWalker::do_walk_array(const FakeObject *obj, ClassInfo info) {
+void ObjectWalker::do_walk_array(const FakeObject *obj, const ClassPlan &plan) {
+  auto info = plan.info;
   TRACE("walk {} id: {}", info.signature(), info.id());
   TRACE("current offset: {}", b.offset());
   uint32_t length = obj->array_length(info.array_header_size());
-  assert(b.offset() % 8 == 0);
-  b.put(info.id());
-  b.put(ARRAY_FLAG);
-  b.put(length);
-  b.fill_next_align_8();
+  put_array_head(info, length);
   auto &elem = info.get_field(0);
   if (is_reference_type(elem.type)) {
-    for (uint32_t i = 0; i < length; i++) {
-      auto elem_obj = obj->array_elem_ref(info.array_header_size(), i);
-      [[maybe_unused]] auto elem_off = walk(elem_obj, elem.id);
-      TRACE("element offset: {}", elem_off);
-    }
+    push_elements(obj, plan, 0, length);
   } else if (is_primitive_type(elem.type)) {
     assert(info.dim() == 1);
-    if (elem.type == T_CHAR && o.enable_utf16_to_utf8) {
+    if (elem.type == T_CHAR && o.enable_latin1_chars && try_cvt_to_latin1(obj, info, length)) {
+      // stored as latin-1
+    } else if (elem.type == T_CHAR && o.enable_utf16_to_utf8) {
       cvt_utf16_to_utf8(obj, info, length);
     } else {
       b.put(obj->raw(info.array_header_size()), info.array_body_size(length));
@@ -61,6 +79,126 @@ void ObjectWalker::do_walk_array(const FakeObject *obj, ClassInfo info) {
     unreachable();
   }
 }
+
+// NOTICE:
+//  codec layouts, after | id | codec flag | or the compact head:
+//   string: | length | coder | value bytes |, | length << 1 | coder | in one varint in the compact format.
+//           a String of char[] before jdk 9 is laid out the same, as if it were compact, see put_string_chars
+//   box:    | value |, a zigzag varint for short, int and long in the compact format
+//   tuple2: nothing, the members follow as those of an instance
+//  the value array of a string is never a record of its own, so it is not shared even if references are tracked.
+void ObjectWalker::do_walk_codec(const FakeObject *obj, const ClassPlan &plan) {
+  auto info = plan.info;
+  auto header_size = info.object_header_size();
+  TRACE("walk {} id: {} codec: {}", info.signature(), info.id(), (int)plan.codec);
+  switch (plan.codec) {
+    case ClassPlan::STRING_CODEC: {
+      auto value = obj->reference_at(header_size + plan.refs[0].offset);
+      assert(value != nullptr);
+      uint32_t length = value->array_length(value->array_header_size());
+      if (plan.codec_type == T_CHAR) {
+        put_string_chars(value, length);
+        break;
+      }
+      auto coder = obj->parse_at<uint8_t>(header_size + plan.codec_offset);
+      assert(coder <= 1);
+      if (o.compact_format) {
+        b.put_varint((uint64_t)length << 1 | coder);
+      } else {
+        b.put(length);
+        b.put(coder);
+      }
+      b.put(value->raw(value->array_header_size()), length);
+      break;
+    }
+    case ClassPlan::BOX_CODEC: {
+      auto value = obj->raw(header_size + plan.codec_offset);
+      if (o.compact_format && plan.codec_type == T_SHORT) {
+        b.put_zigzag(*(const jshort *)value);
+      } else if (o.compact_format && plan.codec_type == T_INT) {
+        b.put_zigzag(*(const jint *)value);
+      } else if (o.compact_format && plan.codec_type == T_LONG) {
+        b.put_zigzag(*(const jlong *)value);
+      } else {
+        b.put(value, type_size(plan.codec_type));
+      }
+      break;
+    }
+    case ClassPlan::TUPLE2_CODEC: {
+      auto top = stack.size();
+      stack.resize(top + plan.refs.size());
+      for (auto i = 0uz; i < plan.refs.size(); i++) {
+        auto &ref = plan.refs[i];
+        auto member = obj->reference_at(header_size + ref.offset);
+        if (member != nullptr) {
+          __builtin_prefetch(member);
+        }
+        stack[top + plan.refs.size() - 1 - i] = {
+            .obj = member,
+            .cache = &ref.klass_cache,
+            .patch_at = NO_PATCH,
+            .id = ref.id,
+            .exact = ref.exact,
+        };
+      }
+      break;
+    }
+    default: {
+      unreachable();
+    }
+  }
+}
+
+void ObjectWalker::put_compact_head(ClassInfo info, bool exact) {
+  if (exact) {
+    b.put_varint(COMPACT_PRESENT);
+  } else {
+    b.put_varint(COMPACT_PRESENT | (uint64_t)(info.id() - MIN_CLASS_ID) << COMPACT_KIND_BITS);
+  }
+}
+
+void ObjectWalker::put_array_head(ClassInfo info, uint32_t length) {
+  if (o.compact_format) {
+    b.put_varint(length);
+  } else {
+    assert(b.offset() % 8 == 0);
+    b.put(info.id());
+    b.put(ARRAY_FLAG);
+    b.put(length);
+    b.fill_next_align_8();
+  }
+}
+
+void ObjectWalker::push_elements(const FakeObject *obj, const ClassPlan &plan, uint32_t begin, uint32_t end) {
+  // decode the elements run by run, only the first run is prefetched here, the rest are left to the
+  // window in drain, as a wide array does not fit in the cache at once
+  auto info = plan.info;
+  auto &elem = info.get_field(0);
+  auto &slot = plan.refs[0];
+  auto f = OopFormat::heap();
+  auto cptrs = (const uint32_t *)obj->raw(info.array_header_size());
+  uint64_t elems[MAX_OOP_RUN];
+  auto top = stack.size();
+  auto n_elem = end - begin;
+  stack.resize(top + n_elem);
+  for (uint32_t i = begin; i < end; i += MAX_OOP_RUN) {
+    auto n = std::min(end - i, MAX_OOP_RUN);
+    auto null_mask = decode_oops(f, cptrs + i, n, elems);
+    if (i == begin) {
+      prefetch_oops(elems, n, null_mask);
+    }
+    for (uint32_t j = 0; j < n; j++) {
+      stack[top + n_elem - 1 - (i - begin + j)] = {
+          .obj = (const FakeObject *)elems[j],
+          .cache = &slot.klass_cache,
+          .patch_at = NO_PATCH,
+          .id = elem.id,
+          .exact = slot.exact,
+      };
+    }
+  }
+}
+
 // NOTICE:
 //  instance layout:
 //   | id | object flag | end off | padding | body | padding |
@@ -72,7 +210,12 @@ void ObjectWalker::do_walk_array(const FakeObject *obj, ClassInfo info) {
 //   | id | redirect flag | redirect off | padding |
 //  array layout:
 //   | id | array flag | length | padding | elements | padding |
-uint32_t ObjectWalker::walk(const FakeObject *obj, class_id_t expected_id) {
+//  codec layout, if enable_codecs is set:
+//   | id | codec flag | codec layout | padding |
+//  records are laid out in depth first pre-order, members of an object or an array follow it one by one.
+uint32_t ObjectWalker::visit(const Item &item) {
+  auto obj = item.obj;
+  auto expected_id = item.id;
   b.fill_next_align_8();
   auto base = b.offset();
   TRACE("base: {} expected id: {}", base, expected_id);
@@ -84,59 +227,306 @@ uint32_t ObjectWalker::walk(const FakeObject *obj, class_id_t expected_id) {
     return base;
   }
   // check visited
-  // if (auto [off, found] = ref2off.lookup_v(obj); found) {
-  //   TRACE("visited at offset {}", off);
-  //   b.put<int16_t>(expected_id);
-  //   b.put<uint16_t>(REDIRECT_FLAG);
-  //   b.put<uint32_t>(off);
-  //   return base;
-  // }
-  // check resolved
-  auto info = r.get_class_info(obj->klass_pointer());
-  assert(!info.is_dummy());
-  // mark visited
-  // ref2off.insert_kv(obj, base);
+  if (ref2off != nullptr) {
+    if (auto [off, found] = ref2off->lookup(obj); found) {
+      TRACE("visited at offset {}", off);
+      b.put<int16_t>(expected_id);
+      b.put<uint16_t>(REDIRECT_FLAG);
+      b.put<uint32_t>(off);
+      return base;
+    }
+  }
+  auto info = resolve(item);
+  auto &plan = r.get_class_plan(info.id());
+  // mark visited before walking the members, so that cycles end up in a redirect
+  // enum instances are singletons and as small as a redirect, so we do not track them
+  if (ref2off != nullptr && !info.is_enum()) {
+    ref2off->insert(obj, base);
+  }
   // do walk
   if (info.is_enum()) {
     b.put(info.id());
     b.put((flag_t)(ENUM_FLAG | OBJECT_FLAG));
     b.put(obj->enum_ordinal());
     assert(b.offset() % 8 == 0);
+  } else if (o.enable_codecs && plan.has_codec()) {
+    b.put(info.id());
+    b.put((flag_t)(CODEC_FLAG | OBJECT_FLAG));
+    do_walk_codec(obj, plan);
   } else if (info.is_object()) {
-    do_walk_object(obj, info);
+    do_walk_object(obj, plan);
   } else if (info.is_array()) {
-    do_walk_array(obj, info);
+    do_walk_array(obj, plan);
   } else {
     unreachable();
   }
   return base;
 }
 
+// NOTICE:
+//  compact layout, no padding, lengths, ids and offsets are varints:
+//   head: | kind | (id - MIN_CLASS_ID) |, packed into one varint, the id is omitted if the slot is exact
+//  instance layout:
+//   | head | primitive fields |
+//  enum layout:
+//   | head | ordinal |
+//  null layout:
+//   | null |
+//  redirect layout:
+//   | redirect | redirect off |
+//  array layout:
+//   | head | length | elements |
+//  codec layout, if enable_codecs is set:
+//   | head | codec layout |
+//  records are laid out in the same order as above, reference fields are not stored as their members follow.
+uint32_t ObjectWalker::visit_compact(const Item &item) {
+  auto obj = item.obj;
+  auto base = b.offset();
+  TRACE("base: {} expected id: {}", base, item.id);
+  if (obj == nullptr) [[unlikely]] {
+    b.put_varint(COMPACT_NULL);
+    return base;
+  }
+  if (ref2off != nullptr) {
+    if (auto [off, found] = ref2off->lookup(obj); found) {
+      TRACE("visited at offset {}", off);
+      b.put_varint(COMPACT_REDIRECT);
+      b.put_varint(off);
+      return base;
+    }
+  }
+  auto info = resolve(item);
+  auto &plan = r.get_class_plan(info.id());
+  if (ref2off != nullptr && !info.is_enum()) {
+    ref2off->insert(obj, base);
+  }
+  put_compact_head(info, item.exact);
+  if (info.is_enum()) {
+    b.put_varint(obj->enum_ordinal());
+  } else if (o.enable_codecs && plan.has_codec()) {
+    do_walk_codec(obj, plan);
+  } else if (info.is_object()) {
+    do_walk_object(obj, plan);
+  } else if (info.is_array()) {
+    do_walk_array(obj, plan);
+  } else {
+    unreachable();
+  }
+  return base;
+}
+
+ClassInfo ObjectWalker::resolve(const Item &item) {
+  // a final declared class is the runtime class, so skip the klass lookup
+  auto info = item.exact              ? r.get_class_info(item.id)
+              : item.cache != nullptr ? r.get_class_info(item.obj->klass_cptr(), item.cache)
+                                      : r.get_class_info(item.obj->klass_cptr());
+  assert(!info.is_dummy());
+  assert(info.klass() == item.obj->klass_pointer());
+  return info;
+}
+
+void ObjectWalker::walk(const FakeObject *root) {
+  // NOTICE: no recursion, so deep structures like long linked lists do not overflow the native stack
+  stack.clear();
+  stack.push_back({.obj = root, .cache = nullptr, .patch_at = NO_PATCH, .id = UNREGISTERED_CLASS_ID, .exact = false});
+  drain();
+}
+
+void ObjectWalker::drain() {
+  while (!stack.empty()) {
+    // keep a window of the next pending objects in flight
+    if (stack.size() > PREFETCH_DISTANCE) {
+      if (auto ahead = stack[stack.size() - 1 - PREFETCH_DISTANCE].obj; ahead != nullptr) {
+        __builtin_prefetch(ahead);
+      }
+    }
+    auto item = stack.back();
+    stack.pop_back();
+    auto offset = o.compact_format ? visit_compact(item) : visit(item);
+    if (item.patch_at != NO_PATCH) {
+      b.put_at(offset, item.patch_at);
+      if (patches != nullptr) {
+        patches->push_back(item.patch_at);
+      }
+    }
+  }
+}
+
+std::vector<ObjectWalker::Item> &ObjectWalker::local_stack() {
+  // the work stack keeps its capacity across walks on the same thread
+  thread_local std::vector<Item> stack;
+  return stack;
+}
+
 size_t ObjectWalker::walk(const FakeObject *obj, ClassResolver &resolver, const Options &o, naive::BorrowedBuffer ctx,
-                          naive::BorrowedBuffer out) {
-  ObjectWalker w(resolver, o, ctx, out);
+                          ChunkedBuffer &out, Ref2Off *ref2off) {
+  ObjectWalker w(resolver, o, ctx, out, ref2off, local_stack());
+  if (w.ref2off != nullptr) {
+    w.ref2off->clear();
+  }
+  w.b.clear();
   w.b.skip(OBJECT_DATA_OFFSET);
   TRACE("start offset: {}", w.b.offset());
-  w.walk(obj, UNREGISTERED_CLASS_ID);
+  uint32_t index_offset = 0;
+  if (has_element_index(obj, resolver, o)) {
+    // the same records as a plain walk, with the offsets of every stride elements noted down on the way
+    auto info = resolver.get_class_info(obj->klass_cptr());
+    uint32_t length = obj->array_length(info.array_header_size());
+    std::vector<uint32_t> index;
+    w.put_root_array_head(info, length);
+    w.walk_elements(obj, resolver.get_class_plan(info.id()), 0, length, &index);
+    index_offset = put_element_index(w.b, length, index);
+  } else {
+    w.walk(obj);
+  }
   TRACE("end offset: {}", w.b.offset());
-  auto header = (meta_header_t *)w.b.raw_at(0);
-  header->total_length = w.b.offset();
-  TRACE("total length: {}", header->total_length);
-  return header->total_length;
+  meta_header_t header{.total_length = (uint32_t)w.b.offset(), .index_offset = index_offset};
+  w.b.put_at(header, 0);
+  TRACE("total length: {}", header.total_length);
+  return header.total_length;
+}
+
+void ObjectWalker::put_root_array_head(ClassInfo info, uint32_t length) {
+  // the root is not exact, as in walk
+  if (o.compact_format) {
+    put_compact_head(info, false);
+  }
+  put_array_head(info, length);
+}
+
+void ObjectWalker::walk_elements(const FakeObject *array, const ClassPlan &plan, uint32_t begin, uint32_t end,
+                                 std::vector<uint32_t> *index) {
+  if (index == nullptr) {
+    stack.clear();
+    push_elements(array, plan, begin, end);
+    drain();
+    return;
+  }
+  assert(begin % ELEMENT_INDEX_STRIDE == 0);
+  for (uint32_t i = begin; i < end; i += ELEMENT_INDEX_STRIDE) {
+    // an element is aligned before its record anyway
+    if (!o.compact_format) {
+      b.fill_next_align_8();
+    }
+    index->push_back(b.offset());
+    stack.clear();
+    push_elements(array, plan, i, std::min(end, i + ELEMENT_INDEX_STRIDE));
+    drain();
+  }
+}
+
+size_t ObjectWalker::walk_array_head(const FakeObject *array, ClassResolver &resolver, const Options &o,
+                                     ChunkedBuffer &out) {
+  ObjectWalker w(resolver, o, naive::BorrowedBuffer(nullptr, 0), out, nullptr, local_stack());
+  auto info = resolver.get_class_info(array->klass_cptr());
+  assert(info.is_array());
+  w.b.clear();
+  w.b.skip(OBJECT_DATA_OFFSET);
+  w.put_root_array_head(info, array->array_length(info.array_header_size()));
+  return w.b.offset();
+}
+
+size_t ObjectWalker::walk_elements(const FakeObject *array, uint32_t begin, uint32_t end, ClassResolver &resolver,
+                                   const Options &o, ChunkedBuffer &out, std::vector<uint32_t> &patches,
+                                   std::vector<uint32_t> *index) {
+  ObjectWalker w(resolver, o, naive::BorrowedBuffer(nullptr, 0), out, nullptr, local_stack(), &patches);
+  auto info = resolver.get_class_info(array->klass_cptr());
+  w.walk_elements(array, resolver.get_class_plan(info.id()), begin, end, index);
+  TRACE("elements [{}, {}) end offset: {}", begin, end, w.b.offset());
+  return w.b.offset();
+}
+
+bool ObjectWalker::is_large_array(const FakeObject *obj, const ClassResolver &resolver, const Options &o) {
+  if (obj == nullptr) {
+    return false;
+  }
+  auto info = resolver.get_class_info(obj->klass_cptr());
+  if (info.is_dummy() || !info.is_array() || !is_reference_type(info.get_field(0).type)) {
+    return false;
+  }
+  return obj->array_length(info.array_header_size()) >= o.min_parallel_array_length;
+}
+
+bool ObjectWalker::has_element_index(const FakeObject *obj, const ClassResolver &resolver, const Options &o) {
+  // ranges of elements are only independent if no reference is tracked
+  return o.index_large_arrays && !o.track_references && is_large_array(obj, resolver, o);
+}
+
+uint32_t ObjectWalker::put_element_index(ChunkedBuffer &b, uint32_t length, const std::vector<uint32_t> &index) {
+  b.fill_next_align_8();
+  uint32_t index_offset = b.offset();
+  b.put(length);
+  b.put<uint32_t>(ELEMENT_INDEX_STRIDE);
+  b.put<uint32_t>(index.size());
+  b.put(index.data(), index.size() * sizeof(uint32_t));
+  TRACE("element index at {} with {} entries", index_offset, index.size());
+  return index_offset;
 }
 
 void ObjectWalker::cvt_utf16_to_utf8(const FakeObject *obj, ClassInfo info, uint32_t length) {
   // NOTICE:
   //  data layout:
   //   | origin byte size | actual byte size | utf-8 data | padding |
-  auto origin_byte_size = info.array_body_size(length);
-  b.put(origin_byte_size);
+  //  the sizes and the worst case of 3 bytes per char are reserved in one chunk, so the conversion writes in place.
+  uint32_t origin_byte_size = info.array_body_size(length);
   auto u16_raw = (const char16_t *)obj->raw(info.array_header_size());
-  auto u8_raw = b.raw_at(b.offset() + sizeof(uint32_t));
-  uint32_t actual_byte_size = simdutf::convert_utf16le_to_utf8(u16_raw, length, reinterpret_cast<char *>(u8_raw));
+  auto raw = b.reserve(2 * sizeof(uint32_t) + 3uz * length);
+  uint32_t actual_byte_size =
+      simdutf::convert_utf16le_to_utf8(u16_raw, length, reinterpret_cast<char *>(raw + 2 * sizeof(uint32_t)));
   TRACE("origin size: {}, actual size: {}, length: {}", origin_byte_size, actual_byte_size, length);
-  b.put(actual_byte_size);
-  b.skip(actual_byte_size);
+  memcpy(raw, &origin_byte_size, sizeof(uint32_t));
+  memcpy(raw + sizeof(uint32_t), &actual_byte_size, sizeof(uint32_t));
+  b.commit(2 * sizeof(uint32_t) + actual_byte_size);
+}
+
+bool ObjectWalker::try_cvt_to_latin1(const FakeObject *obj, ClassInfo info, uint32_t length) {
+  // NOTICE:
+  //  data layout:
+  //   | coder | latin-1 data | padding |
+  //   | coder | utf-16 data or utf-8 layout of cvt_utf16_to_utf8 | padding |
+  //  most chars are ascii, narrow them in one pass, the check and the copy are both simd in simdutf.
+  //  the narrowed bytes are left as garbage if any char is out of latin-1, the caller writes over them.
+  auto u16_raw = (const char16_t *)obj->raw(info.array_header_size());
+  auto raw = b.reserve(sizeof(uint8_t) + length);
+  if (length == 0 || simdutf::convert_utf16le_to_latin1(u16_raw, length, reinterpret_cast<char *>(raw + 1)) ==
+                         length) {
+    raw[0] = CHAR_CODER_LATIN1;
+    b.commit(sizeof(uint8_t) + length);
+    return true;
+  }
+  TRACE("char array of length {} is out of latin-1", length);
+  b.put(CHAR_CODER_UTF16);
+  return false;
+}
+
+void ObjectWalker::put_string_chars(const FakeObject *value, uint32_t length) {
+  // NOTICE: narrow the chars behind the head of the latin-1 layout, whose size is known up front, so that most
+  // strings take one pass. the narrowed bytes are left as garbage if any char is out of latin-1, and the head and the
+  // utf-16 bytes of the other layout are written over them.
+  auto u16_raw = (const char16_t *)value->raw(value->array_header_size());
+  auto head_size = o.compact_format ? (std::bit_width((uint64_t)length << 1 | 1) + 6) / 7
+                                    : sizeof(uint32_t) + sizeof(uint8_t);
+  // at least the 10 bytes put_varint reserves, so that it writes in place
+  auto raw = b.reserve(std::max(head_size + length, 10uz));
+  if (length == 0 ||
+      simdutf::convert_utf16le_to_latin1(u16_raw, length, reinterpret_cast<char *>(raw + head_size)) == length) {
+    if (o.compact_format) {
+      b.put_varint((uint64_t)length << 1 | CHAR_CODER_LATIN1);
+    } else {
+      b.put(length);
+      b.put(CHAR_CODER_LATIN1);
+    }
+    b.commit(length);
+    return;
+  }
+  TRACE("string of length {} is out of latin-1", length);
+  if (o.compact_format) {
+    b.put_varint((uint64_t)length << 2 | CHAR_CODER_UTF16);
+  } else {
+    b.put(length * (uint32_t)sizeof(char16_t));
+    b.put(CHAR_CODER_UTF16);
+  }
+  b.put(u16_raw, length * sizeof(char16_t));
 }
 
 }  // namespace dpx::sd
@@ -1,40 +1,93 @@
 #pragma once
 
+#include <vector>
+
 #include "memory/naive_buffer.hxx"
 #include "sd/native/class_info.hxx"
+#include "sd/native/chunked_buffer.hxx"
+#include "sd/native/class_plan.hxx"
 #include "sd/native/fake.hxx"
 #include "sd/native/map.hxx"
 #include "sd/native/options.hxx"
-#include "sd/native/rw_buffer.hxx"
+#include "sd/native/ptr_map.hxx"
 
 namespace dpx::sd {
 
 class ClassResolver;
 
+using Ref2Off = PtrMap<const FakeObject *, uint32_t>;
+
 class ObjectWalker : Noncopyable, Nonmovable {
  public:
+  // NOTICE: ref2off is only used if track_references is set, the walker clears it and out before use
   static size_t walk(const FakeObject *obj, ClassResolver &resolver, const Options &o, naive::BorrowedBuffer ctx,
-                     naive::BorrowedBuffer out);
+                     ChunkedBuffer &out, Ref2Off *ref2off = nullptr);
+  // NOTICE: for ParallelWalker, which splits the elements of a root object array into chunks.
+  // walk_array_head clears out, lays out the meta header and the head of the array, and returns where its elements
+  // begin. walk_elements lays out elements [begin, end) as the whole walk does, but after what out already holds,
+  // returns the end offset, and appends the offsets of the patched reference fields to patches, so that the caller
+  // can move the chunk. patched offsets and those of the index are offsets in out. if index is given, begin is a
+  // multiple of ELEMENT_INDEX_STRIDE and the offsets of the indexed elements are appended to it.
+  // neither tracks references.
+  static size_t walk_array_head(const FakeObject *array, ClassResolver &resolver, const Options &o,
+                                ChunkedBuffer &out);
+  static size_t walk_elements(const FakeObject *array, uint32_t begin, uint32_t end, ClassResolver &resolver,
+                              const Options &o, ChunkedBuffer &out, std::vector<uint32_t> &patches,
+                              std::vector<uint32_t> *index);
+  // a root object array of at least min_parallel_array_length elements
+  static bool is_large_array(const FakeObject *obj, const ClassResolver &resolver, const Options &o);
+  // whether the output of obj ends with an element index, see element_index_t
+  static bool has_element_index(const FakeObject *obj, const ClassResolver &resolver, const Options &o);
+  // lay out the element index after the last record, return its offset for the meta header
+  static uint32_t put_element_index(ChunkedBuffer &b, uint32_t length, const std::vector<uint32_t> &index);
 
  private:
-  ObjectWalker(ClassResolver &r, const Options &o, naive::BorrowedBuffer ctx, naive::BorrowedBuffer out)
-      : r(r),
-        o(o),
-        b(out)
-  // , ref2off(ctx)
-  {}
+  // a pending object, and where to patch its offset once it is laid out
+  struct Item {
+    const FakeObject *obj;
+    klass_cache_t *cache;  // last hit of the call site, nullptr for the root
+    uint32_t patch_at;     // offset of the reference field in the output, NO_PATCH for the root and elements
+    class_id_t id;         // declared class
+    bool exact;            // see ClassPlan::RefSlot
+  };
+
+  // offset 0 is the meta header, never a reference field
+  constexpr static uint32_t NO_PATCH = 0;
+  // how many pending objects ahead of the top are prefetched
+  constexpr static size_t PREFETCH_DISTANCE = 4;
+
+  ObjectWalker(ClassResolver &r, const Options &o, [[maybe_unused]] naive::BorrowedBuffer ctx, ChunkedBuffer &out,
+               Ref2Off *ref2off, std::vector<Item> &stack, std::vector<uint32_t> *patches = nullptr)
+      : r(r), o(o), b(out), ref2off(o.track_references ? ref2off : nullptr), stack(stack), patches(patches) {}
   ~ObjectWalker() = default;
 
-  void do_walk_object(const FakeObject *obj, ClassInfo info);
-  void do_walk_array(const FakeObject *obj, ClassInfo info);
-  uint32_t walk(const FakeObject *obj, class_id_t id);
+  static std::vector<Item> &local_stack();
+
+  void do_walk_object(const FakeObject *obj, const ClassPlan &plan);
+  void do_walk_array(const FakeObject *obj, const ClassPlan &plan);
+  void do_walk_codec(const FakeObject *obj, const ClassPlan &plan);
+  void put_compact_head(ClassInfo info, bool exact);
+  void put_array_head(ClassInfo info, uint32_t length);
+  void push_elements(const FakeObject *obj, const ClassPlan &plan, uint32_t begin, uint32_t end);
+  void put_root_array_head(ClassInfo info, uint32_t length);
+  void walk_elements(const FakeObject *array, const ClassPlan &plan, uint32_t begin, uint32_t end,
+                     std::vector<uint32_t> *index);
+  uint32_t visit(const Item &item);
+  uint32_t visit_compact(const Item &item);
+  ClassInfo resolve(const Item &item);
+  void walk(const FakeObject *root);
+  void drain();
   void cvt_utf16_to_utf8(const FakeObject *obj, ClassInfo info, uint32_t length);
+  bool try_cvt_to_latin1(const FakeObject *obj, ClassInfo info, uint32_t length);
+  // the chars of a String of char[] in the string codec layout, latin-1 bytes if they fit, utf-16 bytes otherwise
+  void put_string_chars(const FakeObject *value, uint32_t length);
 
   ClassResolver &r;
   const Options &o;
-  RWBuffer b;
-  // TODO make the map size variant
-  // Map<const FakeObject *, uint32_t, 4096, 23> ref2off;
+  ChunkedBuffer &b;
+  Ref2Off *ref2off;  // visited object to its offset, nullptr if references are not tracked
+  std::vector<Item> &stack;
+  std::vector<uint32_t> *patches;  // offsets of the patched reference fields, nullptr if not needed
 };
 
 }  // namespace dpx::sd
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+
+#include "sd/native/jvm_args.hxx"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace dpx::sd {
+
+// heap parameters of compressed oops, an oop decodes to base + (cptr << shift), and 0 stays null
+struct OopFormat {
+  uint64_t base;
+  uint32_t shift;
+
+  static OopFormat heap() {
+    auto &a = JVMArgs::jvm_args;
+    switch (a.heap_compress_ptr_mode) {
+      case JVM_COMPRESS_PTR_MODE_RAW32:
+        return {.base = 0, .shift = 0};
+      case JVM_COMPRESS_PTR_MODE_ZERO_BASED:
+        return {.base = 0, .shift = a.heap_compress_ptr_shift};
+      case JVM_COMPRESS_PTR_MODE_NON_ZERO_BASED:
+        return {.base = a.h_heap_base, .shift = a.heap_compress_ptr_shift};
+      case JVM_COMPRESS_PTR_MODE_RAW64:
+      default:
+        unreachable();
+    }
+  }
+};
+
+// the null mask of a run is one uint64_t
+constexpr uint32_t MAX_OOP_RUN = 64;
+
+namespace detail {
+
+inline uint64_t decode_oops_sw(OopFormat f, const uint32_t *cptrs, uint32_t n, uint64_t *out) {
+  uint64_t null_mask = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (cptrs[i] == 0) {
+      null_mask |= 1ull << i;
+      out[i] = 0;
+    } else {
+      out[i] = f.base + ((uint64_t)cptrs[i] << f.shift);
+    }
+  }
+  return null_mask;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) inline uint64_t decode_oops_hw(OopFormat f, const uint32_t *cptrs, uint32_t n,
+                                                               uint64_t *out) {
+  auto zero = _mm256_setzero_si256();
+  auto base = _mm256_set1_epi64x(f.base);
+  auto shift = _mm_cvtsi32_si128(f.shift);
+  uint64_t null_mask = 0;
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto c = _mm256_loadu_si256((const __m256i *)(cptrs + i));
+    null_mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(c, zero))) << i;
+    auto lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(c));
+    auto hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(c, 1));
+    // keep nulls null instead of base
+    lo = _mm256_andnot_si256(_mm256_cmpeq_epi64(lo, zero), _mm256_add_epi64(_mm256_sll_epi64(lo, shift), base));
+    hi = _mm256_andnot_si256(_mm256_cmpeq_epi64(hi, zero), _mm256_add_epi64(_mm256_sll_epi64(hi, shift), base));
+    _mm256_storeu_si256((__m256i *)(out + i), lo);
+    _mm256_storeu_si256((__m256i *)(out + i + 4), hi);
+  }
+  if (i < n) {
+    null_mask |= decode_oops_sw(f, cptrs + i, n - i, out + i) << i;
+  }
+  return null_mask;
+}
+
+inline bool decode_oops_hw_supported() {
+  static bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#elif defined(__aarch64__)
+inline uint64_t decode_oops_hw(OopFormat f, const uint32_t *cptrs, uint32_t n, uint64_t *out) {
+  auto zero = vdupq_n_u64(0);
+  auto base = vdupq_n_u64(f.base);
+  auto shift = vdupq_n_s64(f.shift);
+  uint64_t null_mask = 0;
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto c = vld1q_u32(cptrs + i);
+    auto lo = vmovl_u32(vget_low_u32(c));
+    auto hi = vmovl_u32(vget_high_u32(c));
+    auto lo_null = vceqq_u64(lo, zero);
+    auto hi_null = vceqq_u64(hi, zero);
+    null_mask |= ((vgetq_lane_u64(lo_null, 0) & 1) | (vgetq_lane_u64(lo_null, 1) & 2) |
+                  (vgetq_lane_u64(hi_null, 0) & 4) | (vgetq_lane_u64(hi_null, 1) & 8))
+                 << i;
+    vst1q_u64(out + i, vbicq_u64(vaddq_u64(vshlq_u64(lo, shift), base), lo_null));
+    vst1q_u64(out + i + 2, vbicq_u64(vaddq_u64(vshlq_u64(hi, shift), base), hi_null));
+  }
+  if (i < n) {
+    null_mask |= decode_oops_sw(f, cptrs + i, n - i, out + i) << i;
+  }
+  return null_mask;
+}
+
+inline bool decode_oops_hw_supported() { return true; }
+#else
+inline uint64_t decode_oops_hw(OopFormat f, const uint32_t *cptrs, uint32_t n, uint64_t *out) {
+  return decode_oops_sw(f, cptrs, n, out);
+}
+
+inline bool decode_oops_hw_supported() { return false; }
+#endif
+
+}  // namespace detail
+
+// decode a run of at most MAX_OOP_RUN compressed oops into addresses, return the null mask where bit i is set
+// if cptrs[i] is null, use AVX2 or NEON when available
+inline uint64_t decode_oops(OopFormat f, const uint32_t *cptrs, uint32_t n, uint64_t *out) {
+  assert(n <= MAX_OOP_RUN);
+  if (detail::decode_oops_hw_supported()) {
+    return detail::decode_oops_hw(f, cptrs, n, out);
+  }
+  return detail::decode_oops_sw(f, cptrs, n, out);
+}
+
+// issue the loads of a decoded run at once, so that their misses overlap
+inline void prefetch_oops(const uint64_t *oops, uint32_t n, uint64_t null_mask) {
+  for (uint32_t i = 0; i < n; i++) {
+    if (!(null_mask & (1ull << i))) {
+      __builtin_prefetch((const void *)oops[i]);
+    }
+  }
+}
+
+}  // namespace dpx::sd
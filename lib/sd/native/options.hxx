@@ -18,10 +18,19 @@ namespace dpx::sd {
 struct Options {
   bool use_dpa = false;
   bool enable_utf16_to_utf8 = false;
+  bool enable_latin1_chars = false;  // store char arrays within latin-1 as bytes
+  bool track_references = false;     // keep shared references and cycles, costs a map lookup per object
+  bool compact_format = false;       // unaligned records with varint heads, for disk and network rather than dma
+  bool index_large_arrays = false;   // end large root object arrays with an element index, to revive in parallel
+  bool enable_codecs = false;        // lay out strings, boxes and tuples by hand, see ClassPlan::Codec
   size_t max_class_info_size = 16_KB;
   size_t max_task_ctx_buffer_size = 128_KB;
-  size_t max_task_out_buffer_size = 128_KB;
+  size_t max_task_out_buffer_size = 128_KB;  // output of a dpa task, and the idle output chunks a context keeps
+  size_t out_chunk_size = 64_KB;             // the output of a walk grows by chunks of this size
   size_t max_device_threads = 4;
+  size_t max_host_threads = 1;                 // threads to walk or revive a large root array, including the caller
+  size_t min_parallel_array_length = 1 << 16;  // shorter root arrays are walked and revived on the caller only
+  size_t max_idle_contexts = 4;                // per thread, kept warm for new handles, see ContextPool
   size_t max_heap_size;
   size_t min_heap_size;
   size_t heap_base_min_address;
@@ -61,10 +70,19 @@ struct Options {
 
     o.use_dpa = get_bool("useDpa");
     o.enable_utf16_to_utf8 = get_bool("enableUtf16ToUtf8");
+    o.enable_latin1_chars = get_bool("enableLatin1Chars");
+    o.track_references = get_bool("trackReferences");
+    o.compact_format = get_bool("compactFormat");
+    o.index_large_arrays = get_bool("indexLargeArrays");
+    o.enable_codecs = get_bool("enableCodecs");
     o.max_class_info_size = get_long("maxClassInfoSize");
     o.max_task_ctx_buffer_size = get_long("maxTaskCtxBufferSize");
     o.max_task_out_buffer_size = get_long("maxTaskOutBufferSize");
+    o.out_chunk_size = get_long("outChunkSize");
     o.max_device_threads = get_long("maxDeviceThreads");
+    o.max_host_threads = get_long("maxHostThreads");
+    o.min_parallel_array_length = get_long("minParallelArrayLength");
+    o.max_idle_contexts = get_long("maxIdleContexts");
     args.h_heap_size = o.max_heap_size = get_long("maxHeapSize");
     o.min_heap_size = get_long("minHeapSize");
     args.h_heap_base = o.heap_base_min_address = get_long("heapBaseMinAddress");
@@ -91,6 +109,36 @@ struct Options {
       o.enable_utf16_to_utf8 = false;
     }
 
+    if (o.use_dpa && o.enable_latin1_chars) {
+      WARN("dpa does not support latin-1 chars, set to false");
+      o.enable_latin1_chars = false;
+    }
+
+    if (o.use_dpa && o.track_references) {
+      WARN("dpa does not support reference tracking, set to false");
+      o.track_references = false;
+    }
+
+    if (o.out_chunk_size < 64) {
+      WARN("out chunk size {} is too small, set to 64", o.out_chunk_size);
+      o.out_chunk_size = 64;
+    }
+
+    if (o.max_host_threads == 0) {
+      WARN("max host threads must be positive, set to 1");
+      o.max_host_threads = 1;
+    }
+
+    if (o.use_dpa && o.compact_format) {
+      WARN("dpa does not support compact format, set to false");
+      o.compact_format = false;
+    }
+
+    if (o.use_dpa && o.enable_codecs) {
+      WARN("dpa does not support codecs, set to false");
+      o.enable_codecs = false;
+    }
+
     return {std::make_pair(o, args)};
   }
 };
@@ -0,0 +1,109 @@
+#include "sd/native/parallel_reviver.hxx"
+
+#include <algorithm>
+
+#include "sd/native/class_resolver.hxx"
+#include "sd/native/jenv_util.hxx"
+#include "sd/native/object_reviver.hxx"
+
+namespace dpx::sd {
+
+namespace {
+
+JavaVM *get_vm(JNIEnv *j_env) {
+  JavaVM *vm = nullptr;
+  if (j_env->GetJavaVM(&vm) != JNI_OK) {
+    die("Fail to get jvm");
+  }
+  return vm;
+}
+
+}  // namespace
+
+ParallelReviver::ParallelReviver(JNIEnv *j_env, ClassResolver &r_, const Options &o_, HostPool &pool_)
+    : vm(get_vm(j_env)),
+      r(r_),
+      o(o_),
+      j_system((jclass)j_env->NewGlobalRef(j_env->FindClass("java/lang/System"))),
+      j_arraycopy(j_env->GetStaticMethodID(j_system, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V")),
+      pool(pool_) {
+  if (j_arraycopy == nullptr) {
+    die("Fail to find System.arraycopy");
+  }
+  DEBUG("parallel reviver with {} threads", pool.n_thread());
+}
+
+ParallelReviver::~ParallelReviver() {
+  JNIEnv *j_env = nullptr;
+  if (vm->GetEnv((void **)&j_env, JNI_VERSION_1_8) == JNI_OK) {
+    j_env->DeleteGlobalRef(j_system);
+  }
+}
+
+bool ParallelReviver::accept(const meta_header_t &header, const Options &o) {
+  return header.index_offset != 0 && o.max_host_threads > 1 && !o.track_references;
+}
+
+jobject ParallelReviver::revive(JNIEnv *j_env, naive::BorrowedBuffer in_) {
+  in = in_;
+  index = (const element_index_t *)(in.data() + ((const meta_header_t *)in.data())->index_offset);
+  info = ObjectReviver::root_info(r, o, in);
+  assert(info.is_array());
+  auto elem_info = r.get_class_info(info.get_field(0).id);
+  auto handle = (jobjectArray)new_array(j_env, elem_info.klass(), index->length);
+  if (handle == nullptr) {
+    j_env->ExceptionDescribe();
+    die("Fail to allocate array");
+  }
+  uint32_t n_part = std::min<uint32_t>(index->n, pool.n_thread() * PARTS_PER_THREAD);
+  uint32_t part_length = (index->n + n_part - 1) / n_part;
+  parts.clear();
+  for (uint32_t begin = 0; begin < index->n; begin += part_length) {
+    parts.push_back({.begin = begin, .end = std::min(index->n, begin + part_length), .handle = nullptr});
+  }
+  TRACE("revive {} elements in {} parts", index->length, parts.size());
+
+  next_part.store(0, std::memory_order_relaxed);
+  pool.run([this](uint32_t idx) { run(idx); });
+
+  // the stores with their barriers are left to the jvm, one call per part
+  for (auto &p : parts) {
+    uint32_t begin = p.begin * index->stride;
+    uint32_t end = std::min(index->length, p.end * index->stride);
+    j_env->CallStaticVoidMethod(j_system, j_arraycopy, p.handle, 0, handle, begin, end - begin);
+    j_env->DeleteGlobalRef(p.handle);
+  }
+  if (j_env->ExceptionCheck()) {
+    j_env->ExceptionDescribe();
+    die("Meet exception");
+  }
+  return handle;
+}
+
+void ParallelReviver::run(uint32_t idx) {
+  JNIEnv *j_env = nullptr;
+  if (vm->GetEnv((void **)&j_env, JNI_VERSION_1_8) != JNI_OK) {
+    die("Reviver thread {} is not attached", idx);
+  }
+  auto elem_info = r.get_class_info(info.get_field(0).id);
+  for (uint32_t i = next_part.fetch_add(1, std::memory_order_relaxed); i < parts.size();
+       i = next_part.fetch_add(1, std::memory_order_relaxed)) {
+    auto &p = parts[i];
+    uint32_t begin = p.begin * index->stride;
+    uint32_t end = std::min(index->length, p.end * index->stride);
+    // an attached thread never returns to java, so free its local references part by part
+    if (j_env->PushLocalFrame(16) != JNI_OK) {
+      die("Fail to push local frame");
+    }
+    auto part = (jobjectArray)new_array(j_env, elem_info.klass(), end - begin);
+    if (part == nullptr) {
+      j_env->ExceptionDescribe();
+      die("Fail to allocate array");
+    }
+    ObjectReviver::revive_elements(j_env, info, end - begin, index->offsets[p.begin], r, o, in, part);
+    p.handle = j_env->NewGlobalRef(part);
+    j_env->PopLocalFrame(nullptr);
+  }
+}
+
+}  // namespace dpx::sd
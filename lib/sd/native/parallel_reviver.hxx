@@ -0,0 +1,62 @@
+#pragma once
+
+#include <jni.h>
+
+#include <atomic>
+#include <vector>
+
+#include "memory/naive_buffer.hxx"
+#include "sd/common/class_info.h"
+#include "sd/native/class_info.hxx"
+#include "sd/native/host_pool.hxx"
+#include "sd/native/options.hxx"
+
+namespace dpx::sd {
+
+class ClassResolver;
+
+// NOTICE:
+//  counterpart of ParallelWalker. with the element index of a large root object array, host threads attached to the
+//  jvm claim ranges of elements and revive each into a part array of their own, then the caller allocates the root
+//  and stores the parts into it in bulk with System.arraycopy, instead of one SetObjectArrayElement per element.
+class ParallelReviver : Noncopyable, Nonmovable {
+ public:
+  // the threads of pool are borrowed for each revive, and must be attached to the jvm
+  ParallelReviver(JNIEnv *j_env, ClassResolver &r, const Options &o, HostPool &pool);
+  ~ParallelReviver();
+
+  // whether an input with this header is revived in parallel, that is it has an element index, and no reference
+  // is tracked
+  static bool accept(const meta_header_t &header, const Options &o);
+
+  // same as ObjectReviver::revive. the caller must not be in a critical region, as the other threads allocate
+  jobject revive(JNIEnv *j_env, naive::BorrowedBuffer in);
+
+ private:
+  struct Part {
+    uint32_t begin;  // [begin, end) of the index entries
+    uint32_t end;
+    jobject handle;  // global reference to the revived elements
+  };
+
+  // parts per thread, so that a thread that meets larger elements does not hold the others back
+  constexpr static uint32_t PARTS_PER_THREAD = 8;
+
+  void run(uint32_t idx);
+
+  JavaVM *vm;
+  ClassResolver &r;
+  const Options &o;
+  jclass j_system;
+  jmethodID j_arraycopy;
+  HostPool &pool;
+
+  // the current revive
+  naive::BorrowedBuffer in{nullptr, 0};
+  const element_index_t *index = nullptr;
+  ClassInfo info;
+  std::vector<Part> parts;
+  std::atomic_uint32_t next_part = 0;
+};
+
+}  // namespace dpx::sd
@@ -0,0 +1,89 @@
+#include "sd/native/parallel_walker.hxx"
+
+#include <algorithm>
+
+#include "sd/native/class_resolver.hxx"
+#include "sd/native/object_walker.hxx"
+
+namespace dpx::sd {
+
+ParallelWalker::ParallelWalker(ClassResolver &r_, const Options &o_, ChunkPool &chunk_pool, HostPool &pool_)
+    : r(r_), o(o_), pool(pool_) {
+  for (auto i = 0uz; i < pool.n_thread(); i++) {
+    workers.emplace_back(new Worker(chunk_pool));
+  }
+  DEBUG("parallel walker with {} threads", pool.n_thread());
+}
+
+bool ParallelWalker::accept(const FakeObject *obj, const ClassResolver &r, const Options &o) {
+  return o.max_host_threads > 1 && !o.track_references && ObjectWalker::is_large_array(obj, r, o);
+}
+
+size_t ParallelWalker::walk(const FakeObject *obj, ChunkedBuffer &out) {
+  auto info = r.get_class_info(obj->klass_cptr());
+  uint32_t length = obj->array_length(info.array_header_size());
+  uint32_t n_chunk = workers.size() * CHUNKS_PER_THREAD;
+  // chunks begin at indexed elements
+  uint32_t chunk_length = upper_align((length + n_chunk - 1) / n_chunk, ELEMENT_INDEX_STRIDE);
+  chunks.clear();
+  for (uint32_t begin = 0; begin < length; begin += chunk_length) {
+    chunks.push_back({.begin = begin, .end = std::min(length, begin + chunk_length)});
+  }
+  for (auto &w : workers) {
+    w->out.clear();
+    w->patches.clear();
+    w->index.clear();
+  }
+  TRACE("walk {} elements in {} chunks", length, chunks.size());
+
+  array = obj;
+  indexed = ObjectWalker::has_element_index(obj, r, o);
+  next_chunk.store(0, std::memory_order_relaxed);
+  pool.run([this](uint32_t idx) { run(idx); });
+
+  auto &b = out;
+  ObjectWalker::walk_array_head(obj, r, o, b);
+  std::vector<uint32_t> index;
+  for (auto &c : chunks) {
+    // each element is aligned in the sequential walk, and so is the first of a chunk, no alignment in compact
+    if (!o.compact_format) {
+      b.fill_next_align_8();
+    }
+    // moves an offset in the buffer of the worker to the output
+    uint32_t shift = b.offset() - c.offset;
+    auto &w = *workers[c.worker];
+    b.put(w.out, c.offset, c.length);
+    for (auto i = c.patch_begin; i < c.patch_end; i++) {
+      auto at = w.patches[i] + shift;
+      b.put_at<uint32_t>(b.get_at<uint32_t>(at) + shift, at);
+    }
+    for (auto i = c.index_begin; i < c.index_end; i++) {
+      index.push_back(w.index[i] + shift);
+    }
+  }
+  uint32_t index_offset = indexed ? ObjectWalker::put_element_index(b, length, index) : 0;
+  meta_header_t header{.total_length = (uint32_t)b.offset(), .index_offset = index_offset};
+  b.put_at(header, 0);
+  TRACE("total length: {}", header.total_length);
+  return header.total_length;
+}
+
+void ParallelWalker::run(uint32_t idx) {
+  auto &w = *workers[idx];
+  for (uint32_t i = next_chunk.fetch_add(1, std::memory_order_relaxed); i < chunks.size();
+       i = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+    auto &c = chunks[i];
+    w.out.fill_next_align_8();
+    c.worker = idx;
+    c.offset = w.out.offset();
+    c.patch_begin = w.patches.size();
+    c.index_begin = w.index.size();
+    c.length = ObjectWalker::walk_elements(array, c.begin, c.end, r, o, w.out, w.patches,
+                                           indexed ? &w.index : nullptr) -
+               c.offset;
+    c.patch_end = w.patches.size();
+    c.index_end = w.index.size();
+  }
+}
+
+}  // namespace dpx::sd
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "sd/native/chunked_buffer.hxx"
+#include "sd/native/fake.hxx"
+#include "sd/native/host_pool.hxx"
+#include "sd/native/options.hxx"
+
+namespace dpx::sd {
+
+class ClassResolver;
+
+// NOTICE:
+//  host side counterpart of DPAContext::do_array_obj_serialize. the elements of a large root object array are split
+//  into chunks, host threads claim chunks one by one and walk each into their own buffer, then the chunks are
+//  stitched in order after the head of the array. reference fields are patched with offsets in the buffer of the
+//  worker, so they are moved along with their chunk, and so are the entries of the element index. the output is the
+//  same as ObjectWalker::walk.
+class ParallelWalker : Noncopyable, Nonmovable {
+ public:
+  // the buffers of the workers grow with chunks of chunk_pool, so they are only as large as their share. the threads
+  // of pool are borrowed for each walk, so walkers of many contexts share them
+  ParallelWalker(ClassResolver &r, const Options &o, ChunkPool &chunk_pool, HostPool &pool);
+  ~ParallelWalker() = default;
+
+  // a large root object array, see ObjectWalker::is_large_array. references must not be tracked, as an element
+  // shared by two chunks would be a redirect or a copy depending on which chunk is walked first
+  static bool accept(const FakeObject *obj, const ClassResolver &r, const Options &o);
+
+  // same as ObjectWalker::walk
+  size_t walk(const FakeObject *obj, ChunkedBuffer &out);
+
+ private:
+  struct Chunk {
+    uint32_t begin;
+    uint32_t end;
+    uint32_t worker;  // whose buffer holds the chunk
+    size_t offset;    // in the buffer of the worker
+    size_t length;
+    size_t patch_begin;  // [patch_begin, patch_end) of the patches of the worker
+    size_t patch_end;
+    size_t index_begin;  // [index_begin, index_end) of the index of the worker
+    size_t index_end;
+  };
+
+  struct Worker {
+    explicit Worker(ChunkPool &chunk_pool) : out(chunk_pool) {}
+
+    ChunkedBuffer out;
+    std::vector<uint32_t> patches;
+    std::vector<uint32_t> index;
+  };
+
+  // chunks per thread, so that a thread that meets larger elements does not hold the others back
+  constexpr static uint32_t CHUNKS_PER_THREAD = 8;
+
+  void run(uint32_t idx);
+
+  ClassResolver &r;
+  const Options &o;
+  HostPool &pool;
+  std::vector<std::unique_ptr<Worker>> workers;  // worker 0 is the calling thread
+
+  // the current walk
+  const FakeObject *array = nullptr;
+  bool indexed = false;
+  std::vector<Chunk> chunks;
+  std::atomic_uint32_t next_chunk = 0;
+};
+
+}  // namespace dpx::sd
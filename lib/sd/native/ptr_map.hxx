@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace dpx::sd {
+
+// open addressing map with linear probing for identity keys, e.g. object pointers or buffer offsets.
+// key 0 marks an empty slot, so it can not be inserted. The map doubles when half full and keeps its
+// capacity on clear, so reusing one map across walks does not allocate. The used slots are tracked, so clear
+// and for_each cost the entries, not the capacity a large graph once left behind.
+template <typename K, typename V>
+class PtrMap {
+  static_assert(sizeof(K) <= sizeof(uint64_t), "?");
+
+  struct Slot {
+    K k;
+    V v;
+  };
+
+ public:
+  explicit PtrMap(size_t initial_capacity = 64) : slots(upper_pow2(initial_capacity)), mask(slots.size() - 1) {
+    memset(slots.data(), 0, slots.size() * sizeof(Slot));
+  }
+  ~PtrMap() = default;
+
+  size_t size() const { return used.size(); }
+  size_t capacity() const { return slots.size(); }
+  bool empty() const { return used.empty(); }
+
+  // return false if k exists, the value is kept
+  bool insert(K k, V v) {
+    assert(k != K{});
+    if ((used.size() + 1) * 2 > slots.size()) {
+      grow();
+    }
+    auto i = index(k);
+    while (slots[i].k != K{}) {
+      if (slots[i].k == k) {
+        return false;
+      }
+      i = (i + 1) & mask;
+    }
+    slots[i] = {k, v};
+    used.push_back(i);
+    return true;
+  }
+
+  std::pair<V, bool> lookup(K k) const {
+    auto i = index(k);
+    while (slots[i].k != K{}) {
+      if (slots[i].k == k) {
+        return {slots[i].v, true};
+      }
+      i = (i + 1) & mask;
+    }
+    return {V{}, false};
+  }
+
+  void clear() {
+    for (auto i : used) {
+      slots[i] = {};
+    }
+    used.clear();
+  }
+
+  // in insertion order
+  template <typename Fn>
+  void for_each(Fn &&fn) const {
+    for (auto i : used) {
+      fn(slots[i].k, slots[i].v);
+    }
+  }
+
+ private:
+  static size_t upper_pow2(size_t x) {
+    size_t c = 8;
+    while (c < x) {
+      c <<= 1;
+    }
+    return c;
+  }
+
+  size_t index(K k) const {
+    // fibonacci hashing, the low bits of pointers are always zero
+    return (static_cast<uint64_t>((uintptr_t)k) * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    std::swap(old, slots);
+    memset(slots.data(), 0, slots.size() * sizeof(Slot));
+    mask = slots.size() - 1;
+    std::vector<uint32_t> old_used;
+    std::swap(old_used, used);
+    used.reserve(old_used.size() + 1);
+    for (auto i : old_used) {
+      insert(old[i].k, old[i].v);
+    }
+  }
+
+  std::vector<Slot> slots;
+  size_t mask;
+  std::vector<uint32_t> used;  // indexes of the occupied slots
+};
+
+}  // namespace dpx::sd
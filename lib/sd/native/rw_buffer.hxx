@@ -57,10 +57,39 @@ struct RWBuffer {
     off += length;
   }
 
+  // LEB128, 7 bits per byte with the high bit set on all but the last byte
+  void put_varint(uint64_t value) {
+    while (value >= 0x80) {
+      b.data()[off++] = (uint8_t)(value | 0x80);
+      value >>= 7;
+    }
+    b.data()[off++] = (uint8_t)value;
+  }
+
+  uint64_t get_varint() const {
+    uint64_t value = 0;
+    for (uint32_t shift = 0;; shift += 7) {
+      uint8_t byte = b.data()[off++];
+      value |= (uint64_t)(byte & 0x7F) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+  }
+
+  // zigzag, so that small negative values stay short
+  void put_zigzag(int64_t value) { put_varint((uint64_t)value << 1 ^ (uint64_t)(value >> 63)); }
+
+  int64_t get_zigzag() const {
+    auto value = get_varint();
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+  }
+
   size_t offset() const { return off; }
   size_t limit() const { return b.size(); }
 
   void skip(size_t n) const { off += n; }
+  void seek(size_t offset) const { off = offset; }
   void fill_next_align_8() {
     size_t len = upper_align(off, 8) - off;
     if (len == 0) {
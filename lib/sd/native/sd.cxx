@@ -1,5 +1,8 @@
 #include "sd/native/sd.hxx"
 
+#include <limits>
+
+#include "sd/native/key_hasher.hxx"
 #include "sd/native/object_reviver.hxx"
 #include "sd/native/object_walker.hxx"
 
@@ -7,33 +10,139 @@ namespace dpx::sd {
 
 jbyteArray Context::serialize(JNIEnv* j_env, jobject j_obj) {
   auto obj = FakeObject::from_jobject(j_obj);
-  auto total_length = ObjectWalker::walk(obj, r, o, ctx_buffer.borrow(), out_buffer.borrow());
+  auto total_length = walk(obj, out);
   DEBUG("total length: {}", total_length);
   auto j_output = j_env->NewByteArray(total_length);
   auto j_output_obj = FakeObject::from_jobject(j_output);
-  memcpy(j_output_obj->raw(j_output_obj->array_header_size()), out_buffer.data(), total_length);
-  TRACE("{}", Hexdump(out_buffer.data(), total_length));
+  out.copy_to(j_output_obj->raw(j_output_obj->array_header_size()));
+  out.clear();
+  TRACE("{}", Hexdump(j_output_obj->raw(j_output_obj->array_header_size()), total_length));
   return j_output;
 }
 
+jintArray Context::serialize_batch(JNIEnv* j_env, jobjectArray j_objs, jint from, jobject j_out, jint position,
+                                   jint limit) {
+  auto base = reinterpret_cast<uint8_t*>(j_env->GetDirectBufferAddress(j_out));
+  if (base == nullptr) {
+    die("Output of batch serialization must be a direct buffer");
+  }
+  auto n = j_env->GetArrayLength(j_objs);
+  if (from < 0 || from > n) {
+    die("Batch from {} out of {} objects", from, n);
+  }
+  std::vector<jint> ends;
+  ends.reserve(n - from);
+  size_t off = position;
+  for (jsize i = from; i < n; ++i) {
+    auto j_obj = j_env->GetObjectArrayElement(j_objs, i);
+    auto obj = FakeObject::from_jobject(j_obj);
+    size_t remain = limit - off;
+    // in place, the bytes past the limit go to chunks of the context, and an object that does not fit is left to
+    // the next batch
+    ChunkedBuffer in_place(naive::BorrowedBuffer(base + off, remain), chunk_pool);
+    auto length = walk(obj, in_place);
+    j_env->DeleteLocalRef(j_obj);
+    if (length > remain) {
+      break;
+    }
+    if (in_place.overflowed()) {
+      in_place.copy_to(base + off);
+    }
+    off += length;
+    ends.push_back(off);
+  }
+  DEBUG("batch serialize {} of {} objects from {}, end offset: {}", ends.size(), n, from, off);
+  auto j_ends = j_env->NewIntArray(ends.size());
+  j_env->SetIntArrayRegion(j_ends, 0, ends.size(), ends.data());
+  return j_ends;
+}
+
+size_t Context::serialize_to(JNIEnv*, jobject j_obj, naive::BorrowedBuffer dst) {
+  auto obj = FakeObject::from_jobject(j_obj);
+  ChunkedBuffer in_place(dst, chunk_pool);
+  auto total_length = walk(obj, in_place);
+  DEBUG("total length: {}", total_length);
+  if (in_place.overflowed()) {
+    if (total_length <= dst.size()) {
+      in_place.copy_to(dst.data());
+    } else {
+      // too small, the caller takes it once it has a larger output
+      out.put(in_place, 0, total_length);
+    }
+  }
+  return total_length;
+}
+
+void Context::take_overflow(uint8_t* dst) {
+  if (dst != nullptr) {
+    out.copy_to(dst);
+  }
+  out.clear();
+}
+
+size_t Context::walk(const FakeObject* obj, ChunkedBuffer& out) {
+  if (ParallelWalker::accept(obj, r, o)) {
+    if (pw == nullptr) {
+      pw = std::make_unique<ParallelWalker>(r, o, chunk_pool, hosts.get());
+    }
+    return pw->walk(obj, out);
+  }
+  return ObjectWalker::walk(obj, r, o, ctx_buffer.borrow(), out, &ref2off);
+}
+
 jobject Context::deserialize(JNIEnv* j_env, jbyteArray j_input, jclass j_cls) {
   auto klass = FakeKlass::from_clazz(j_cls);
   // auto j_input_obj = FakeObject::from_jobject(j_input);
   // auto in_buffer =
   // naive::BorrowedBuffer(reinterpret_cast<uint8_t*>(j_input_obj->raw(j_input_obj->array_header_size())),
   //                                        j_input_obj->array_length(j_input_obj->array_header_size()));
+  auto raw_input_length = j_env->GetArrayLength(j_input);
+  meta_header_t header = {};
+  if (raw_input_length >= (jsize)sizeof(header)) {
+    j_env->GetByteArrayRegion(j_input, 0, sizeof(header), (jbyte*)&header);
+  }
+  if (ParallelReviver::accept(header, o)) {
+    // NOTICE: the other threads allocate while the caller waits for them, which may need a gc, so the caller must
+    // not hold a critical region, copy the input out instead
+    in_copy.resize(raw_input_length);
+    j_env->GetByteArrayRegion(j_input, 0, raw_input_length, (jbyte*)in_copy.data());
+    if (pr == nullptr) {
+      pr = std::make_unique<ParallelReviver>(j_env, r, o, hosts.get());
+    }
+    return pr->revive(j_env, naive::BorrowedBuffer(in_copy.data(), in_copy.size()));
+  }
   jboolean is_copy = false;
   auto raw_input = j_env->GetPrimitiveArrayCritical(j_input, &is_copy);
+  auto in_buffer = naive::BorrowedBuffer((uint8_t*)raw_input, raw_input_length);
+  auto j_obj = ObjectReviver::revive(j_env, klass, r, o, ctx_buffer.borrow(), in_buffer, &off2ref);
+  j_env->ReleasePrimitiveArrayCritical(j_input, raw_input, 0);
+  return j_obj;
+}
+
+jobject Context::deserialize_into(JNIEnv* j_env, jbyteArray j_input, jobject target) {
   auto raw_input_length = j_env->GetArrayLength(j_input);
+  jboolean is_copy = false;
+  auto raw_input = j_env->GetPrimitiveArrayCritical(j_input, &is_copy);
   auto in_buffer = naive::BorrowedBuffer((uint8_t*)raw_input, raw_input_length);
-  auto j_obj = ObjectReviver::revive(j_env, klass, r, o, ctx_buffer.borrow(), in_buffer);
+  auto j_obj = ObjectReviver::revive_into(j_env, target, r, o, ctx_buffer.borrow(), in_buffer, reused, &off2ref);
   j_env->ReleasePrimitiveArrayCritical(j_input, raw_input, 0);
   return j_obj;
 }
 
+jlong Context::hash_key(JNIEnv* j_env, jbyteArray j_input, jintArray j_path) {
+  std::vector<uint32_t> path(j_env->GetArrayLength(j_path));
+  j_env->GetIntArrayRegion(j_path, 0, path.size(), (jint*)path.data());
+  auto raw_input_length = j_env->GetArrayLength(j_input);
+  jboolean is_copy = false;
+  auto raw_input = j_env->GetPrimitiveArrayCritical(j_input, &is_copy);
+  auto h = KeyHasher::hash(r, o, path, naive::BorrowedBuffer((uint8_t*)raw_input, raw_input_length), &off2id);
+  j_env->ReleasePrimitiveArrayCritical(j_input, raw_input, 0);
+  return h.has_value() ? *h : std::numeric_limits<jlong>::min();
+}
+
 jbyteArray DPAContext::do_serialize(JNIEnv* j_env, jobject j_obj) {
   auto object = FakeObject::from_jobject(j_obj);
-  auto info = r.get_class_info(object->klass_pointer());
+  auto info = r.get_class_info(object->klass_cptr());
   if (info.is_dummy()) {
     return nullptr;
   }
@@ -100,6 +209,7 @@ jbyteArray DPAContext::do_array_obj_serialize(JNIEnv* j_env, FakeObject* object,
   }
   uint32_t total_length = b.offset();
   ((meta_header_t*)b.raw_at(0))->total_length = total_length;
+  ((meta_header_t*)b.raw_at(0))->index_offset = 0;
   jbyteArray j_result = j_env->NewByteArray(total_length);
   auto result_obj = FakeObject::from_jobject(j_result);
   memcpy(result_obj->raw(result_obj->array_header_size()), out.data(), total_length);
@@ -2,13 +2,20 @@
 
 #include <jni.h>
 
+#include <algorithm>
+
 #include "doca/buffer.hxx"
 #include "doca/device.hxx"
 #include "doca/dpa_thread.hxx"
 #include "memory/naive_buffer.hxx"
 #include "sd/common/args.h"
 #include "sd/native/class_resolver.hxx"
+#include "sd/native/key_hasher.hxx"
+#include "sd/native/object_reviver.hxx"
+#include "sd/native/object_walker.hxx"
 #include "sd/native/options.hxx"
+#include "sd/native/parallel_reviver.hxx"
+#include "sd/native/parallel_walker.hxx"
 
 extern "C" doca_dpa_func_t serialize;
 extern "C" doca_dpa_func_t register_jvm_heap;
@@ -43,7 +50,7 @@ class DPAContext : Noncopyable, Nonmovable {
       : dev(dev_),
         o(o_),
         r(r_),
-        infos(dev, o.max_class_info_size),
+        infos(dev, ClassResolver::device_class_infos_size(o)),
         out(o.max_task_out_buffer_size),
         g(dev, o.max_device_threads, ::serialize) {
     for (uint32_t i = 0; i < o.max_device_threads; ++i) {
@@ -61,6 +68,10 @@ class DPAContext : Noncopyable, Nonmovable {
   void export_class_infos() { r.export_class_infos(dev, infos); }
 
   jbyteArray serialize(JNIEnv* j_env, jobject j_obj) {
+    // classes registered after the start are sent before the device meets them
+    if (r.has_unexported_class_infos()) {
+      export_class_infos();
+    }
     bool done = false;
     boost::fibers::fiber poller([&]() {
       TRACE("begin poller");
@@ -95,19 +106,50 @@ class DPAContext : Noncopyable, Nonmovable {
 
 class Context : Noncopyable, Nonmovable {
  public:
-  Context(Options& o_, ClassResolver& r_)
-      : o(o_), r(r_), ctx_buffer(o.max_task_ctx_buffer_size), out_buffer(o.max_task_out_buffer_size) {}
+  // the output grows by chunks of out_chunk_size, and keeps at most max_task_out_buffer_size bytes of them idle.
+  // large arrays borrow the threads of hosts, which are shared with the other contexts of the pool
+  Context(Options& o_, ClassResolver& r_, LazyHostPool& hosts_)
+      : o(o_),
+        r(r_),
+        hosts(hosts_),
+        ctx_buffer(o.max_task_ctx_buffer_size),
+        chunk_pool(o.out_chunk_size, std::max(o.max_task_out_buffer_size / o.out_chunk_size, 1uz)),
+        out(chunk_pool) {}
 
   ~Context() = default;
 
   jbyteArray serialize(JNIEnv* j_env, jobject j_obj);
+  // serialize j_objs[from, length) back to back into [position, limit) of a direct buffer, return the end offset of
+  // each object that fits, the remaining objects are left to the next batch
+  jintArray serialize_batch(JNIEnv* j_env, jobjectArray j_objs, jint from, jobject j_out, jint position, jint limit);
+  // walk in place and return the length, if it is larger than dst.size() the object did not fit, and its output is
+  // kept for take_overflow, which must follow before the next call
+  size_t serialize_to(JNIEnv* j_env, jobject j_obj, naive::BorrowedBuffer dst);
+  // copy the output kept by serialize_to to dst, or drop it if dst is nullptr
+  void take_overflow(uint8_t* dst);
   jobject deserialize(JNIEnv* j_env, jbyteArray j_input, jclass j_cls);
+  // overwrite target and its mutable members in place where the classes match, see ObjectReviver::revive_into
+  jobject deserialize_into(JNIEnv* j_env, jbyteArray j_input, jobject target);
+  // hash of the key at path of a serialized record, see KeyHasher, Long.MIN_VALUE if it has no known hash
+  jlong hash_key(JNIEnv* j_env, jbyteArray j_input, jintArray j_path);
 
  private:
+  // split large root object arrays across host threads, see ParallelWalker
+  size_t walk(const FakeObject* obj, ChunkedBuffer& out);
+
   Options& o;
   ClassResolver& r;
+  LazyHostPool& hosts;
   naive::OwnedBuffer ctx_buffer;
-  naive::OwnedBuffer out_buffer;
+  ChunkPool chunk_pool;
+  ChunkedBuffer out;  // cleared after each use, so idle chunks go back to the pool
+  Ref2Off ref2off;
+  Off2Ref off2ref;
+  ReusedSet reused;
+  Off2Id off2id;
+  std::unique_ptr<ParallelWalker> pw;   // created on the first large array
+  std::unique_ptr<ParallelReviver> pr;  // created on the first indexed input
+  std::vector<uint8_t> in_copy;         // input of the parallel reviver, out of the critical region
 };
 
 }  // namespace dpx::sd
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace dpx {
+
+namespace detail {
+
+constexpr uint32_t crc32c_poly = 0x82f63b78;  // reflected Castagnoli
+
+constexpr std::array<uint32_t, 256> crc32c_table = [] {
+  std::array<uint32_t, 256> t{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = (c >> 1) ^ ((c & 1) ? crc32c_poly : 0);
+    }
+    t[i] = c;
+  }
+  return t;
+}();
+
+inline uint32_t crc32c_sw(uint32_t crc, const uint8_t* p, size_t n) {
+  for (auto i = 0uz; i < n; i++) {
+    crc = crc32c_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) inline uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t n) {
+  uint64_t c = crc;
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    c = _mm_crc32_u64(c, x);
+  }
+  auto c32 = static_cast<uint32_t>(c);
+  for (; n > 0; p++, n--) {
+    c32 = _mm_crc32_u8(c32, *p);
+  }
+  return c32;
+}
+
+inline bool crc32c_hw_supported() {
+  static bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+inline uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t n) {
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    crc = __crc32cd(crc, x);
+  }
+  for (; n > 0; p++, n--) {
+    crc = __crc32cb(crc, *p);
+  }
+  return crc;
+}
+
+inline bool crc32c_hw_supported() { return true; }
+#else
+inline uint32_t crc32c_hw(uint32_t crc, const uint8_t* p, size_t n) { return crc32c_sw(crc, p, n); }
+
+inline bool crc32c_hw_supported() { return false; }
+#endif
+
+}  // namespace detail
+
+// crc32c (Castagnoli), use SSE4.2 or ARMv8 crc instructions when available
+inline uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0) {
+  auto p = reinterpret_cast<const uint8_t*>(data);
+  crc = ~crc;
+  if (detail::crc32c_hw_supported()) {
+    crc = detail::crc32c_hw(crc, p, length);
+  } else {
+    crc = detail::crc32c_sw(crc, p, length);
+  }
+  return ~crc;
+}
+
+}  // namespace dpx
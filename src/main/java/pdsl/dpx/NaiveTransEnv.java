@@ -8,7 +8,12 @@ public class NaiveTransEnv {
         System.loadLibrary("dpx_common");
     }
 
-    public static native void Initialize(String dev_pci_addr, String spill_dir);
+    public static void Initialize(String dev_pci_addr, String spill_dir) {
+        Initialize(dev_pci_addr, spill_dir, SpillCodec.RAW);
+    }
+
+    // spill blocks are compressed with codec, one of SpillCodec
+    public static native void Initialize(String dev_pci_addr, String spill_dir, int codec);
 
     public static native void TriggerSpillStart(boolean need_header);
 
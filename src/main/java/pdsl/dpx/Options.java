@@ -17,10 +17,19 @@ import com.sun.management.*;
 public class Options {
     public boolean useDpa;
     public boolean enableUtf16ToUtf8;
+    public boolean enableLatin1Chars;
+    public boolean trackReferences;
+    public boolean compactFormat;
+    public boolean indexLargeArrays;
+    public boolean enableCodecs;
     public long maxClassInfoSize;
     public long maxTaskCtxBufferSize;
     public long maxTaskOutBufferSize;
+    public long outChunkSize;
     public long maxDeviceThreads;
+    public long maxHostThreads;
+    public long minParallelArrayLength;
+    public long maxIdleContexts;
 
     public long maxHeapSize;
     public long minHeapSize;
@@ -47,10 +56,19 @@ public class Options {
         jvmOptions = loadJVMOptions();
         defaultOptions.useDpa = true;
         defaultOptions.enableUtf16ToUtf8 = false;
+        defaultOptions.enableLatin1Chars = false;
+        defaultOptions.trackReferences = false;
+        defaultOptions.compactFormat = false;
+        defaultOptions.indexLargeArrays = false;
+        defaultOptions.enableCodecs = false;
         defaultOptions.maxClassInfoSize = 16 * 1024;
         defaultOptions.maxTaskCtxBufferSize = 128 * 1024;
         defaultOptions.maxTaskOutBufferSize = 16 * 1024;
+        defaultOptions.outChunkSize = 4 * 1024;
         defaultOptions.maxDeviceThreads = 1;
+        defaultOptions.maxHostThreads = 1;
+        defaultOptions.minParallelArrayLength = 1 << 16;
+        defaultOptions.maxIdleContexts = 4;
         defaultOptions.maxHeapSize = Long.parseLong(jvmOptions.get("MaxHeapSize"));
         defaultOptions.minHeapSize = Long.parseLong(jvmOptions.get("InitialHeapSize"));
         defaultOptions.heapBaseMinAddress = Long.parseLong(jvmOptions.get("HeapBaseMinAddress"));
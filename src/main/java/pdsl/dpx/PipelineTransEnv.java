@@ -8,12 +8,45 @@ public class PipelineTransEnv {
         System.loadLibrary("dpx_common");
     }
 
-    public static native void Initialize(String dev_pci_addr, String spill_dir);
+    // combine ops and value types, see CombineOp and CombineValueType of the native combiner
+    public static final int COMBINE_NONE = -1;
+    public static final int COMBINE_SUM = 0;
+    public static final int COMBINE_COUNT = 1;
+    public static final int COMBINE_MIN = 2;
+    public static final int COMBINE_MAX = 3;
+
+    public static final int COMBINE_INT32 = 0;
+    public static final int COMBINE_INT64 = 1;
+    public static final int COMBINE_FLOAT32 = 2;
+    public static final int COMBINE_FLOAT64 = 3;
+
+    public static void Initialize(String dev_pci_addr, String spill_dir) {
+        Initialize(dev_pci_addr, spill_dir, false);
+    }
+
+    public static void Initialize(String dev_pci_addr, String spill_dir, boolean frameRecords) {
+        Initialize(dev_pci_addr, spill_dir, frameRecords, COMBINE_NONE, COMBINE_INT64);
+    }
+
+    public static void Initialize(String dev_pci_addr, String spill_dir, boolean frameRecords, int combineOp,
+            int combineValueType) {
+        Initialize(dev_pci_addr, spill_dir, frameRecords, combineOp, combineValueType, SpillCodec.RAW);
+    }
+
+    // records are framed if frameRecords or combineOp is not COMBINE_NONE. with a combine op, every value appended
+    // must be a little-endian number of combineValueType, and an offload server started with combine folds the values
+    // of equal keys. the format travels with each partition buffer, so buffers that do not declare it pass through.
+    // spill blocks are compressed with codec, one of SpillCodec
+    public static native void Initialize(String dev_pci_addr, String spill_dir, boolean frameRecords, int combineOp,
+            int combineValueType, int codec);
 
     public static native void TriggerSpillStart();
 
     public static native void Append(int partitionId, byte[] key, byte[] value, boolean last);
 
+    // serialize obj with SD straight into the partition buffer, SD must be initialized
+    public static native void AppendObject(int partitionId, Object obj, boolean last);
+
     public static native void WaitForSpillDone();
 
     public static native void Destroy();
@@ -1,6 +1,7 @@
 package pdsl.dpx;
 
 import pdsl.dpx.type.*;
+import java.nio.ByteBuffer;
 import java.util.*;
 
 public class SD {
@@ -30,6 +31,21 @@ public class SD {
         Register(RelatedClassCollector.collect(traits, mapping));
     }
 
+    // serialize objects back to back into a direct buffer from its position, return the end offset of
+    // each object that fits and advance the position past the last one
+    public static int[] SerializeBatch(Object[] objs, ByteBuffer out) {
+        return SerializeBatch(objs, 0, out);
+    }
+
+    // same as above for objs[from, objs.length), so that a caller resumes a batch without copying the rest
+    public static int[] SerializeBatch(Object[] objs, int from, ByteBuffer out) {
+        int[] ends = SerializeBatch(objs, from, out, out.position(), out.limit());
+        if (ends.length > 0) {
+            out.position(ends[ends.length - 1]);
+        }
+        return ends;
+    }
+
     // public native methods
     public static native void Start();
 
@@ -43,7 +59,15 @@ public class SD {
 
     public static native <T> T Deserialize(byte[] buffer, Class<T> t);
 
+    // see Serde.DeserializeInto
+    public static native <T> T DeserializeInto(byte[] buffer, T target);
+
+    // see Serde.HashKey, returns Serde.NO_HASH if the key has no known hash
+    public static native long HashKey(byte[] buffer, int... path);
+
     // private native methods
+    private static native int[] SerializeBatch(Object[] objs, int from, ByteBuffer out, int position, int limit);
+
     private static native void Register(Set<Class<?>> relatedClasses);
 
     private static native void Initialize(Map<String, String> jvm_options, Options dpx_options);
@@ -1,5 +1,6 @@
 package pdsl.dpx;
 
+import java.nio.ByteBuffer;
 import java.util.Map;
 import java.util.Set;
 
@@ -17,6 +18,9 @@ public class Serde {
         System.loadLibrary("dpx_common");
     }
 
+    // see HashKey
+    public static final long NO_HASH = Long.MIN_VALUE;
+
     private long handle;
 
     public Serde() {
@@ -30,12 +34,41 @@ public class Serde {
         return Serialize(handle, obj);
     }
 
+    // serialize objects back to back into a direct buffer from its position, return the end offset of
+    // each object that fits and advance the position past the last one
+    public int[] SerializeBatch(Object[] objs, ByteBuffer out) {
+        return SerializeBatch(objs, 0, out);
+    }
+
+    // same as above for objs[from, objs.length), so that a caller resumes a batch without copying the rest
+    public int[] SerializeBatch(Object[] objs, int from, ByteBuffer out) {
+        int[] ends = SerializeBatch(handle, objs, from, out, out.position(), out.limit());
+        if (ends.length > 0) {
+            out.position(ends[ends.length - 1]);
+        }
+        return ends;
+    }
+
     public <T> T Deserialize(byte[] buffer, Class<T> t) {
         return Deserialize(handle, buffer, t);
     }
 
+    // overwrite target and the mutable objects it reaches instead of allocating them, returns target, or a new
+    // object if the buffer holds another class, so callers must use the returned object
+    public <T> T DeserializeInto(byte[] buffer, T target) {
+        return DeserializeInto(handle, buffer, target);
+    }
+
+    // hashCode of the key of a serialized object without deserializing it, the key is reached by member indices
+    // from the root, in field offset order for objects, returns NO_HASH if the key has no known hash
+    public long HashKey(byte[] buffer, int... path) {
+        return HashKey(handle, buffer, path);
+    }
+
+    // the native context goes back to a pool of the calling thread for the next Serde
     public void close() {
         close(handle);
+        handle = 0;
     }
 
     // static
@@ -62,6 +95,9 @@ public class Serde {
     // public native methods
     public static native void Destroy();
 
+    // free the native contexts kept warm for new Serde instances, see Options.maxIdleContexts, returns how many
+    public static native long TrimContexts();
+
     public static native void ShowRegisteredClass();
 
     // private native methods
@@ -76,6 +112,13 @@ public class Serde {
 
     private static native <T> T Deserialize(long handle, byte[] buffer, Class<T> t);
 
+    private static native <T> T DeserializeInto(long handle, byte[] buffer, T target);
+
+    private static native long HashKey(long handle, byte[] buffer, int[] path);
+
+    private static native int[] SerializeBatch(long handle, Object[] objs, int from, ByteBuffer out, int position,
+            int limit);
+
     private static native void Register(Set<Class<?>> relatedClasses);
 
     private static native void Initialize(Map<String, String> jvm_options, Options dpx_options);
@@ -4,10 +4,15 @@ import java.io.Closeable;
 import java.io.Flushable;
 import java.io.IOException;
 import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.channels.Channels;
+import java.nio.channels.WritableByteChannel;
 
 public class SerdeOutputStream implements Closeable, Flushable {
     private Serde sd;
     private OutputStream os;
+    private ByteBuffer batchBuffer = null;
+    private WritableByteChannel channel = null;
 
     public SerdeOutputStream(OutputStream os) {
         this.os = os;
@@ -18,6 +23,30 @@ public class SerdeOutputStream implements Closeable, Flushable {
         os.write(sd.Serialize(obj));
     }
 
+    // one native call per batch instead of per object, and no byte[] per object
+    public void writeObjects(Object[] objs) throws IOException {
+        if (batchBuffer == null) {
+            batchBuffer = ByteBuffer.allocateDirect(4 * 1024 * 1024);
+            channel = Channels.newChannel(os);
+        }
+        int done = 0;
+        while (done < objs.length) {
+            batchBuffer.clear();
+            int[] ends = sd.SerializeBatch(objs, done, batchBuffer);
+            if (ends.length == 0) {
+                // larger than the batch buffer, on its own, the channel does not buffer so the order is kept
+                os.write(sd.Serialize(objs[done]));
+                done++;
+                continue;
+            }
+            batchBuffer.flip();
+            while (batchBuffer.hasRemaining()) {
+                channel.write(batchBuffer);
+            }
+            done += ends.length;
+        }
+    }
+
     @Override
     public void close() throws IOException {
         os.close();
@@ -0,0 +1,10 @@
+package pdsl.dpx;
+
+// codecs of the spill blocks written by the host spill workers, see CodecType of the native codec
+public final class SpillCodec {
+    public static final int RAW = 0;
+    public static final int LZ = 1;
+
+    private SpillCodec() {
+    }
+}
@@ -0,0 +1,52 @@
+package pdsl.dpx.bench;
+
+import pdsl.dpx.Serde;
+
+// timing loops of the record benches, which only set up the options, the types and the records
+final class RecordBench {
+    private RecordBench() {
+    }
+
+    // check that each record survives a round trip, then time serialize and deserialize after a warm up
+    static <T> void run(Serde sd, T[] records, Class<T> cls, int nRound) {
+        byte[][] rs = new byte[records.length][];
+        for (int i = 0; i < records.length; i++) {
+            rs[i] = sd.Serialize(records[i]);
+            if (!records[i].equals(sd.Deserialize(rs[i], cls))) {
+                throw new RuntimeException("Mismatched record " + i);
+            }
+        }
+
+        // warm up
+        runSerialize(sd, records, nRound / 10 + 1);
+        runDeserialize(sd, rs, cls, nRound / 10 + 1);
+
+        runSerialize(sd, records, nRound);
+        runDeserialize(sd, rs, cls, nRound);
+    }
+
+    static void runSerialize(Serde sd, Object[] records, int nRound) {
+        long bytes = 0;
+        long s = System.nanoTime();
+        for (int r = 0; r < nRound; r++) {
+            for (Object record : records) {
+                bytes += sd.Serialize(record).length;
+            }
+        }
+        long e = System.nanoTime();
+        System.err.printf("serialize: %d records, %.2f bytes/record, %.2f ns/record\n", (long) records.length * nRound,
+                (double) bytes / records.length / nRound, (double) (e - s) / records.length / nRound);
+    }
+
+    static void runDeserialize(Serde sd, byte[][] rs, Class<?> cls, int nRound) {
+        long s = System.nanoTime();
+        for (int r = 0; r < nRound; r++) {
+            for (byte[] b : rs) {
+                sd.Deserialize(b, cls);
+            }
+        }
+        long e = System.nanoTime();
+        System.err.printf("deserialize: %d records, %.2f ns/record\n", (long) rs.length * nRound,
+                (double) (e - s) / rs.length / nRound);
+    }
+}
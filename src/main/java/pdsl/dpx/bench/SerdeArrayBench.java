@@ -0,0 +1,83 @@
+package pdsl.dpx.bench;
+
+import java.util.Arrays;
+import java.util.Random;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.type.TypeTraits;
+
+// one large array of records per call, as a cached partition is, walked and revived on nThread host threads
+public class SerdeArrayBench {
+    public static class Record {
+        public String key;
+        public long value;
+        public double[] features;
+
+        Record(Random random) {
+            key = SerdeBatchBench.generateRandomASCII(16);
+            value = random.nextLong();
+            features = new double[4];
+            for (int i = 0; i < features.length; i++) {
+                features[i] = random.nextDouble();
+            }
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (!(o instanceof Record)) {
+                return false;
+            }
+            Record r = (Record) o;
+            return key.equals(r.key) && value == r.value && Arrays.equals(features, r.features);
+        }
+
+        @Override
+        public int hashCode() {
+            return key.hashCode();
+        }
+    }
+
+    public static void main(String[] args) {
+        int nRecord = args.length > 0 ? Integer.parseInt(args[0]) : 1 << 20;
+        int nRound = args.length > 1 ? Integer.parseInt(args[1]) : 10;
+        int nThread = args.length > 2 ? Integer.parseInt(args[2]) : 4;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        o.trackReferences = false;
+        o.indexLargeArrays = true;
+        o.maxHostThreads = nThread;
+        o.maxTaskOutBufferSize = (long) nRecord * 160 + (1 << 20);
+        Serde.Initialize(o);
+        Serde.Register(new TypeTraits<Record[]>() {
+        });
+        Serde sd = new Serde();
+
+        Random random = new Random(42);
+        Record[] rs = new Record[nRecord];
+        for (int i = 0; i < nRecord; i++) {
+            rs[i] = new Record(random);
+        }
+        byte[] b = sd.Serialize(rs);
+        if (!Arrays.equals(rs, sd.Deserialize(b, Record[].class))) {
+            throw new RuntimeException("Mismatched records");
+        }
+
+        long serializeNs = 0;
+        long deserializeNs = 0;
+        for (int r = 0; r < nRound; r++) {
+            long s = System.nanoTime();
+            b = sd.Serialize(rs);
+            long m = System.nanoTime();
+            sd.Deserialize(b, Record[].class);
+            long e = System.nanoTime();
+            serializeNs += m - s;
+            deserializeNs += e - m;
+        }
+        System.err.printf("%d threads, %d records, %d bytes, serialize %.2f ms, deserialize %.2f ms\n", nThread,
+                nRecord, b.length, serializeNs / 1e6 / nRound, deserializeNs / 1e6 / nRound);
+
+        sd.close();
+        Serde.Destroy();
+    }
+}
@@ -0,0 +1,90 @@
+package pdsl.dpx.bench;
+
+import java.nio.ByteBuffer;
+import java.util.Random;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.type.TypeTraits;
+
+public class SerdeBatchBench {
+    public static String generateRandomChars(String candidateChars, int length) {
+        StringBuilder sb = new StringBuilder();
+        Random random = new Random();
+        for (int i = 0; i < length; i++) {
+            sb.append(candidateChars.charAt(random.nextInt(candidateChars.length())));
+        }
+        return sb.toString();
+    }
+
+    public static String generateRandomASCII(int length) {
+        return generateRandomChars("abcdefghijklmnopqrstuvwxyz", length);
+    }
+
+    // small records, where the per call overhead dominates
+    public static class Pair {
+        public String key = generateRandomASCII(16);
+        public Integer value = new Random().nextInt();
+    }
+
+    static long runSingle(Serde sd, Pair[] ps, int nRound) {
+        long bytes = 0;
+        long s = System.nanoTime();
+        for (int r = 0; r < nRound; r++) {
+            for (Pair p : ps) {
+                bytes += sd.Serialize(p).length;
+            }
+        }
+        long e = System.nanoTime();
+        System.err.printf("single: %d records, %d bytes, %.2f ns/record\n", (long) ps.length * nRound, bytes,
+                (double) (e - s) / ps.length / nRound);
+        return bytes;
+    }
+
+    static long runBatch(Serde sd, Pair[] ps, int nRound, ByteBuffer out) {
+        long bytes = 0;
+        long s = System.nanoTime();
+        for (int r = 0; r < nRound; r++) {
+            out.clear();
+            int[] ends = sd.SerializeBatch(ps, out);
+            if (ends.length != ps.length) {
+                throw new RuntimeException("Batch buffer is too small");
+            }
+            bytes += ends[ends.length - 1];
+        }
+        long e = System.nanoTime();
+        System.err.printf("batch: %d records, %d bytes, %.2f ns/record\n", (long) ps.length * nRound, bytes,
+                (double) (e - s) / ps.length / nRound);
+        return bytes;
+    }
+
+    public static void main(String[] args) {
+        int nRecord = args.length > 0 ? Integer.parseInt(args[0]) : 1024;
+        int nRound = args.length > 1 ? Integer.parseInt(args[1]) : 1000;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        Serde.Initialize(o);
+        Serde.Register(new TypeTraits<Pair>() {
+        });
+        Serde sd = new Serde();
+
+        Pair[] ps = new Pair[nRecord];
+        for (int i = 0; i < nRecord; i++) {
+            ps[i] = new Pair();
+        }
+        ByteBuffer out = ByteBuffer.allocateDirect(nRecord * 256 + (int) o.maxTaskOutBufferSize);
+
+        // warm up
+        runSingle(sd, ps, nRound / 10 + 1);
+        runBatch(sd, ps, nRound / 10 + 1, out);
+
+        long singleBytes = runSingle(sd, ps, nRound);
+        long batchBytes = runBatch(sd, ps, nRound, out);
+        if (singleBytes != batchBytes) {
+            throw new RuntimeException("Mismatched output size");
+        }
+
+        sd.close();
+        Serde.Destroy();
+    }
+}
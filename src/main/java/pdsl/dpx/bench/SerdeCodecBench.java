@@ -0,0 +1,61 @@
+package pdsl.dpx.bench;
+
+import java.util.Random;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.type.TypeTraits;
+
+// shuffle like records of a string key and a long value, with or without the codecs of String and Long, run
+// once per setting as the options are fixed at initialization
+public class SerdeCodecBench {
+    public static final class Pair {
+        public String key;
+        public Long value;
+
+        Pair(Random random, int keyLength) {
+            StringBuilder sb = new StringBuilder();
+            for (int i = 0; i < keyLength; i++) {
+                sb.append((char) ('a' + random.nextInt(26)));
+            }
+            key = sb.toString();
+            value = random.nextLong() % 1000000;
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (!(o instanceof Pair)) {
+                return false;
+            }
+            Pair p = (Pair) o;
+            return key.equals(p.key) && value.equals(p.value);
+        }
+    }
+
+    public static void main(String[] args) {
+        int nRecord = args.length > 0 ? Integer.parseInt(args[0]) : 1024;
+        int nRound = args.length > 1 ? Integer.parseInt(args[1]) : 1000;
+        boolean codecs = args.length > 2 ? Boolean.parseBoolean(args[2]) : true;
+        boolean compact = args.length > 3 ? Boolean.parseBoolean(args[3]) : false;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        o.enableCodecs = codecs;
+        o.compactFormat = compact;
+        Serde.Initialize(o);
+        Serde.Register(new TypeTraits<Pair>() {
+        });
+        Serde sd = new Serde();
+        System.err.printf("codecs: %b, format: %s\n", codecs, compact ? "compact" : "aligned");
+
+        Random random = new Random(42);
+        Pair[] ps = new Pair[nRecord];
+        for (int i = 0; i < nRecord; i++) {
+            ps[i] = new Pair(random, 8 + random.nextInt(24));
+        }
+
+        RecordBench.run(sd, ps, Pair.class, nRound);
+
+        sd.close();
+        Serde.Destroy();
+    }
+}
@@ -0,0 +1,46 @@
+package pdsl.dpx.bench;
+
+import java.util.ArrayList;
+import java.util.List;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.bench.jsbs.Image;
+import pdsl.dpx.bench.jsbs.MediaContent;
+import pdsl.dpx.type.InterfaceTypeMapping;
+import pdsl.dpx.type.TypeTraits;
+
+// size and throughput of the jsbs types in the aligned or the compact format, run once per format as the
+// format is fixed at initialization
+public class SerdeCompactBench {
+    public static void main(String[] args) {
+        int nRecord = args.length > 0 ? Integer.parseInt(args[0]) : 1024;
+        int nRound = args.length > 1 ? Integer.parseInt(args[1]) : 1000;
+        boolean compact = args.length > 2 ? Boolean.parseBoolean(args[2]) : true;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        o.compactFormat = compact;
+        Serde.Initialize(o);
+        InterfaceTypeMapping m = new InterfaceTypeMapping();
+        m.add(new TypeTraits<List<Image>>() {
+        }, new TypeTraits<ArrayList<Image>>() {
+        });
+        m.add(new TypeTraits<List<String>>() {
+        }, new TypeTraits<ArrayList<String>>() {
+        });
+        Serde.Register(new TypeTraits<MediaContent>() {
+        }, m);
+        Serde sd = new Serde();
+        System.err.printf("format: %s\n", compact ? "compact" : "aligned");
+
+        MediaContent[] mcs = new MediaContent[nRecord];
+        for (int i = 0; i < nRecord; i++) {
+            mcs[i] = MediaContent.BenchCase();
+        }
+
+        RecordBench.run(sd, mcs, MediaContent.class, nRound);
+
+        sd.close();
+        Serde.Destroy();
+    }
+}
@@ -0,0 +1,83 @@
+package pdsl.dpx.bench;
+
+import java.util.Arrays;
+import java.util.Random;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.type.TypeTraits;
+
+public class SerdePrimitiveBench {
+    // wide records of primitive fields, where restoring one field at a time dominates
+    public static class Row {
+        public long l0, l1, l2, l3;
+        public double d0, d1, d2, d3;
+        public int i0, i1, i2, i3;
+        public float f0, f1;
+        public short s0, s1;
+        public char c0;
+        public byte b0;
+        public boolean z0;
+        public int[] ints = new int[16];
+        public String tag = "row";
+
+        public Row(Random r) {
+            l0 = r.nextLong();
+            l1 = r.nextLong();
+            l2 = r.nextLong();
+            l3 = r.nextLong();
+            d0 = r.nextDouble();
+            d1 = r.nextDouble();
+            d2 = r.nextDouble();
+            d3 = r.nextDouble();
+            i0 = r.nextInt();
+            i1 = r.nextInt();
+            i2 = r.nextInt();
+            i3 = r.nextInt();
+            f0 = r.nextFloat();
+            f1 = r.nextFloat();
+            s0 = (short) r.nextInt();
+            s1 = (short) r.nextInt();
+            c0 = (char) r.nextInt();
+            b0 = (byte) r.nextInt();
+            z0 = r.nextBoolean();
+            for (int i = 0; i < ints.length; i++) {
+                ints[i] = r.nextInt();
+            }
+        }
+
+        @Override
+        public boolean equals(Object obj) {
+            if (!(obj instanceof Row)) {
+                return false;
+            }
+            Row o = (Row) obj;
+            return l0 == o.l0 && l1 == o.l1 && l2 == o.l2 && l3 == o.l3 && d0 == o.d0 && d1 == o.d1 && d2 == o.d2
+                    && d3 == o.d3 && i0 == o.i0 && i1 == o.i1 && i2 == o.i2 && i3 == o.i3 && f0 == o.f0
+                    && f1 == o.f1 && s0 == o.s0 && s1 == o.s1 && c0 == o.c0 && b0 == o.b0 && z0 == o.z0
+                    && Arrays.equals(ints, o.ints) && tag.equals(o.tag);
+        }
+    }
+
+    public static void main(String[] args) {
+        int nRecord = args.length > 0 ? Integer.parseInt(args[0]) : 1024;
+        int nRound = args.length > 1 ? Integer.parseInt(args[1]) : 1000;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        Serde.Initialize(o);
+        Serde.Register(new TypeTraits<Row>() {
+        });
+        Serde sd = new Serde();
+
+        Random random = new Random(42);
+        Row[] rows = new Row[nRecord];
+        for (int i = 0; i < nRecord; i++) {
+            rows[i] = new Row(random);
+        }
+
+        RecordBench.run(sd, rows, Row.class, nRound);
+
+        sd.close();
+        Serde.Destroy();
+    }
+}
@@ -0,0 +1,69 @@
+package pdsl.dpx.bench;
+
+import java.util.Arrays;
+import java.util.Random;
+
+import pdsl.dpx.Options;
+import pdsl.dpx.Serde;
+import pdsl.dpx.bench.SerdeCodecBench.Pair;
+import pdsl.dpx.type.TypeTraits;
+
+// many short streams, each opens a Serde, serializes a few records and closes it, with warm native contexts
+// (maxIdleContexts > 0) or a new one per stream (maxIdleContexts = 0), run once per setting as the options are
+// fixed at initialization
+public class SerdeStreamBench {
+    static long runStreams(Pair[] ps, int nStream, int nRecordPerStream) {
+        long bytes = 0;
+        for (int s = 0; s < nStream; s++) {
+            Serde sd = new Serde();
+            for (int i = 0; i < nRecordPerStream; i++) {
+                bytes += sd.Serialize(ps[(s * nRecordPerStream + i) % ps.length]).length;
+            }
+            sd.close();
+        }
+        return bytes;
+    }
+
+    public static void main(String[] args) {
+        int nStream = args.length > 0 ? Integer.parseInt(args[0]) : 100000;
+        int nRecordPerStream = args.length > 1 ? Integer.parseInt(args[1]) : 8;
+        long maxIdleContexts = args.length > 2 ? Long.parseLong(args[2]) : 4;
+        Options o = Options.defaultOptions;
+        o.useDpa = false;
+        o.enableCodecs = true;
+        o.maxIdleContexts = maxIdleContexts;
+        // as large as for big records, which is what makes a context expensive to create
+        o.maxTaskOutBufferSize = 4 * 1024 * 1024;
+        Serde.Initialize(o);
+        Serde.Register(new TypeTraits<Pair>() {
+        });
+        System.err.printf("max idle contexts: %d, records per stream: %d\n", maxIdleContexts, nRecordPerStream);
+
+        Random random = new Random(42);
+        Pair[] ps = new Pair[1024];
+        for (int i = 0; i < ps.length; i++) {
+            ps[i] = new Pair(random, 8 + random.nextInt(24));
+        }
+        Serde check = new Serde();
+        byte[] expected = check.Serialize(ps[0]);
+        check.close();
+        // a reused context lays out the same bytes
+        Serde reused = new Serde();
+        if (!Arrays.equals(expected, reused.Serialize(ps[0]))) {
+            throw new RuntimeException("Mismatched record on a reused context");
+        }
+        reused.close();
+
+        // warm up
+        runStreams(ps, nStream / 10 + 1, nRecordPerStream);
+
+        long s = System.nanoTime();
+        long bytes = runStreams(ps, nStream, nRecordPerStream);
+        long e = System.nanoTime();
+        System.err.printf("streams: %d, %.2f bytes/stream, %.2f ns/stream, %.2f ns/record\n", nStream,
+                (double) bytes / nStream, (double) (e - s) / nStream, (double) (e - s) / nStream / nRecordPerStream);
+        System.err.printf("trimmed %d idle contexts\n", Serde.TrimContexts());
+
+        Serde.Destroy();
+    }
+}
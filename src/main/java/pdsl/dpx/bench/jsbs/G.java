@@ -0,0 +1,14 @@
+package pdsl.dpx.bench.jsbs;
+
+import java.util.Objects;
+
+// an abstract base, its fields are laid out in H
+public abstract class G {
+    public long id;
+    public String name;
+    public D d;
+
+    protected boolean baseEquals(G g) {
+        return id == g.id && Objects.equals(name, g.name) && Objects.equals(d, g.d);
+    }
+}
@@ -0,0 +1,20 @@
+package pdsl.dpx.bench.jsbs;
+
+import java.util.Objects;
+
+public class H extends G {
+    public int score;
+    public String name; // shadows G.name
+
+    @Override
+    public boolean equals(Object o) {
+        if (this == o) {
+            return true;
+        } else if (o == null || getClass() != o.getClass()) {
+            return false;
+        } else {
+            H h = (H) o;
+            return baseEquals(h) && score == h.score && Objects.equals(name, h.name);
+        }
+    }
+}
@@ -60,6 +60,11 @@ public class RelatedClassCollector {
                 }
                 do_collect(f.getGenericType(), m, result);
             }
+            // NOTICE: fields of super classes are flattened into the layout of c, so their types are related too
+            Class<?> s = c.getSuperclass();
+            if (s != null && s != Object.class && !c.isEnum() && !c.isArray()) {
+                do_collect(s, m, result);
+            }
             if (c.isArray()) {
                 do_collect(c.getComponentType(), m, result);
             }
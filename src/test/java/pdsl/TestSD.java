@@ -11,23 +11,40 @@ import org.junit.jupiter.api.BeforeAll;
 import org.junit.jupiter.api.Test;
 // import org.openjdk.jol.info.ClassLayout;
 import pdsl.dpx.SD;
+import pdsl.dpx.Serde;
 import pdsl.dpx.Options;
 import pdsl.dpx.bench.jsbs.*;
 import pdsl.dpx.type.InterfaceTypeMapping;
 import pdsl.dpx.type.TypeTraits;
 
 public class TestSD {
+    // NOTICE: the native options are fixed at initialization, so each option is tested by a subclass that runs these
+    // tests once more with its own initAll, which hides this one, and surefire forks a jvm per test class
     @BeforeAll
     static void initAll() {
+        initialize(defaults());
+    }
+
+    static Options defaults() {
         Options o = Options.defaultOptions;
         o.useDpa = false;
         o.enableUtf16ToUtf8 = false;
         o.maxDeviceThreads = 1;
+        // room for the deep and wide structures below
+        o.maxTaskOutBufferSize = 16 * 1024 * 1024;
+        return o;
+    }
+
+    static void initialize(Options o) {
         SD.Initialize(o);
         SD.Register(new TypeTraits<E>() {});
         SD.Register(new TypeTraits<ArrayList<String>>() {});
+        SD.Register(new TypeTraits<ArrayList<Long>>() {});
         SD.Register(new TypeTraits<String>() {});
+        SD.Register(new TypeTraits<String[]>() {});
+        SD.Register(new TypeTraits<Long[]>() {});
         SD.Register(new TypeTraits<A>() {});
+        SD.Register(new TypeTraits<H>() {});
         InterfaceTypeMapping m = new InterfaceTypeMapping();
         m.add(new TypeTraits<List<Image>>() {}, new TypeTraits<ArrayList<Image>>() {});
         m.add(new TypeTraits<List<String>>() {}, new TypeTraits<ArrayList<String>>() {});
@@ -78,6 +95,102 @@ public class TestSD {
         }
     }
 
+    static A chain(int depth) {
+        A head = new A();
+        A cur = head;
+        for (int i = 0; i < depth; i++) {
+            cur.i = i;
+            cur.b = new B();
+            cur.b.l = i;
+            cur.b.a = new A();
+            cur = cur.b.a;
+        }
+        return head;
+    }
+
+    @Test
+    void testDeep() {
+        // far deeper than a recursive walker could go on the native stack
+        byte[] r = SD.Serialize(chain(100000));
+        assertTrue(r.length > 100000 * 2 * 16);
+
+        A get = SD.Deserialize(SD.Serialize(chain(1000)), A.class);
+        for (int i = 0; i < 1000; i++) {
+            assertEquals(i, get.i);
+            assertEquals(i, get.b.l);
+            get = get.b.a;
+        }
+        assertNull(get.b);
+    }
+
+    @Test
+    void testDeserializeInto() {
+        A target = chain(10);
+        B b = target.b;
+        A get = SD.DeserializeInto(SD.Serialize(chain(20)), target);
+        assertSame(target, get);
+        assertSame(b, get.b);
+        for (int i = 0; i < 20; i++) {
+            assertEquals(i, get.i);
+            assertEquals(i, get.b.l);
+            get = get.b.a;
+        }
+        assertNull(get.b);
+
+        // arrays of the same length are overwritten, others are allocated
+        E e = new E();
+        e.vector = new long[] {1, 2, 3};
+        e.matrix = new int[][] {{1, 2}, {3, 4, 5}};
+        E into = new E();
+        long[] vector = new long[3];
+        int[] row = new int[2];
+        int[] shortRow = new int[2];
+        into.vector = vector;
+        into.matrix = new int[][] {row, shortRow};
+        E got = SD.DeserializeInto(SD.Serialize(e), into);
+        assertEquals(e, got);
+        assertSame(vector, got.vector);
+        assertSame(row, got.matrix[0]);
+        assertNotSame(shortRow, got.matrix[1]);
+
+        // an instance the target reaches twice is overwritten once, the second member gets a fresh one
+        A source = chain(2);
+        source.c = new C();
+        source.c.is = 1;
+        source.b.c = new C();
+        source.b.c.is = 2;
+        A aliased = chain(2);
+        C shared = new C();
+        aliased.c = shared;
+        aliased.b.c = shared;
+        // and so is a cycle back to the root, which is still being revived when it is met again
+        aliased.b.a = aliased;
+        A gotAliased = SD.DeserializeInto(SD.Serialize(source), aliased);
+        assertSame(aliased, gotAliased);
+        assertEquals(source, gotAliased);
+        assertSame(shared, gotAliased.c);
+        assertNotSame(shared, gotAliased.b.c);
+        assertEquals(1, gotAliased.c.is);
+        assertEquals(2, gotAliased.b.c.is);
+        assertNotSame(aliased, gotAliased.b.a);
+        assertEquals(1, gotAliased.b.a.i);
+        assertEquals(0, gotAliased.i);
+    }
+
+    @Test
+    void testWide() {
+        List<String> names = new ArrayList<String>();
+        for (int i = 0; i < 100000; i++) {
+            names.add("name" + i);
+        }
+        ArrayList<?> gotNames = SD.Deserialize(SD.Serialize(names), ArrayList.class);
+        assertIterableEquals(names, gotNames);
+
+        // a root object array, which large enough is walked and revived by ranges
+        String[] nameArray = names.toArray(new String[0]);
+        assertArrayEquals(nameArray, SD.Deserialize(SD.Serialize(nameArray), String[].class));
+    }
+
     @Test
     void testArray() {
         long[] vector = new long[] {(long) 6, (long) 6, (long) 6};
@@ -108,6 +221,97 @@ public class TestSD {
         assertEquals(s, t);
     }
 
+    @Test
+    void testBoxed() {
+        List<Long> values = new ArrayList<Long>();
+        values.add(0L);
+        values.add(-1L);
+        values.add(Long.MIN_VALUE);
+        values.add(Long.MAX_VALUE);
+        values.add(null);
+        ArrayList<?> gotValues = SD.Deserialize(SD.Serialize(values), ArrayList.class);
+        assertIterableEquals(values, gotValues);
+
+        Long[] valueArray = values.toArray(new Long[0]);
+        assertArrayEquals(valueArray, SD.Deserialize(SD.Serialize(valueArray), Long[].class));
+    }
+
+    @Test
+    void testInherited() {
+        H h = new H();
+        h.id = 42;
+        ((G) h).name = "base";
+        h.name = "derived";
+        h.d = new D();
+        h.d.c1 = 'x';
+        h.d.ds = new double[] {1.5, -2.5};
+        h.score = 7;
+        H get = SD.Deserialize(SD.Serialize(h), H.class);
+        assertEquals(h, get);
+        assertEquals("base", ((G) get).name);
+        assertEquals("derived", get.name);
+
+        // modCount of AbstractList comes along
+        List<String> names = new ArrayList<String>();
+        names.add("a");
+        names.remove(0);
+        names.add("b");
+        ArrayList<?> gotNames = SD.Deserialize(SD.Serialize(names), ArrayList.class);
+        assertIterableEquals(names, gotNames);
+    }
+
+    @Test
+    void testHashKey() {
+        for (String s : new String[] {"", "abc", "中文 mixed", "caf\u00e9"}) {
+            assertEquals(s.hashCode(), SD.HashKey(SD.Serialize(s)));
+        }
+
+        // elementData is the only reference field of an ArrayList
+        List<String> names = new ArrayList<String>();
+        names.add("shared");
+        names.add("shared");
+        names.add("名字");
+        byte[] r = SD.Serialize(names);
+        for (int i = 0; i < names.size(); i++) {
+            assertEquals(names.get(i).hashCode(), SD.HashKey(r, 0, i));
+        }
+        // the spare capacity is null, and there is nothing past it
+        assertEquals(0, SD.HashKey(r, 0, names.size()));
+        assertEquals(Serde.NO_HASH, SD.HashKey(r, 0, 10));
+
+        // the elements of a root array, which may carry an element index
+        String[] nameArray = names.toArray(new String[0]);
+        r = SD.Serialize(nameArray);
+        for (int i = 0; i < nameArray.length; i++) {
+            assertEquals(nameArray[i].hashCode(), SD.HashKey(r, i));
+        }
+
+        List<Long> values = new ArrayList<Long>();
+        values.add(-1L);
+        values.add(Long.MAX_VALUE);
+        values.add(null);
+        r = SD.Serialize(values);
+        assertEquals(Long.valueOf(-1L).hashCode(), SD.HashKey(r, 0, 0));
+        assertEquals(Long.valueOf(Long.MAX_VALUE).hashCode(), SD.HashKey(r, 0, 1));
+        assertEquals(0, SD.HashKey(r, 0, 2));
+
+        assertEquals(Serde.NO_HASH, SD.HashKey(SD.Serialize(new A())));
+    }
+
+    @Test
+    void testMixedScript() {
+        // ascii, latin-1, cjk and surrogate pairs, the last three at the tail to defeat the simd check
+        List<String> names = new ArrayList<String>();
+        names.add("");
+        names.add("abcdefghijklmnopqrstuvwxyz0123456789");
+        names.add("caf\u00e9 na\u00efve \u00ff");
+        names.add("abcdefghijklmnopqrstuvwxyz0123456789\u4e2d\u6587");
+        names.add("abcdefghijklmnopqrstuvwxyz0123456789\ud83d\ude00");
+        names.add("\u0100");
+        ArrayList<?> gotNames = SD.Deserialize(SD.Serialize(names), ArrayList.class);
+        assertIterableEquals(names, gotNames);
+    }
+
     @Test
     void testList() {
         List<String> names = new ArrayList<String>();
@@ -127,6 +331,32 @@ public class TestSD {
         assertIterableEquals(names, gotNames);
     }
 
+    @Test
+    void testThreads() throws InterruptedException {
+        // each calling thread walks and revives with a context of its own
+        MediaContent mc = MediaContent.BenchCase();
+        boolean[] ok = new boolean[4];
+        Thread[] ts = new Thread[ok.length];
+        for (int t = 0; t < ts.length; t++) {
+            final int idx = t;
+            ts[t] = new Thread(() -> {
+                for (int i = 0; i < 200; i++) {
+                    if (!mc.equals(SD.Deserialize(SD.Serialize(mc), MediaContent.class))) {
+                        return;
+                    }
+                }
+                ok[idx] = true;
+            });
+            ts[t].start();
+        }
+        for (Thread t : ts) {
+            t.join();
+        }
+        for (boolean b : ok) {
+            assertTrue(b);
+        }
+    }
+
     @Test
     void testBasicBench() throws InterruptedException {
         MediaContent mc = MediaContent.BenchCase();
@@ -0,0 +1,44 @@
+package pdsl;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+import pdsl.dpx.SD;
+import pdsl.dpx.Options;
+
+// the tests of TestSD with strings and boxes laid out by their codecs, see testString, testBoxed and testHashKey
+public class TestSDCodecs extends TestSD {
+    @BeforeAll
+    static void initAll() {
+        Options o = defaults();
+        o.enableCodecs = true;
+        initialize(o);
+    }
+
+    @Test
+    void testStringCodec() {
+        char[] chars = new char[4096];
+        Arrays.fill(chars, '\u00e9');
+        String latin1 = new String(chars);
+        byte[] r = SD.Serialize(latin1);
+        // one byte per char, with compact strings or a String of char[] alike
+        assertTrue(r.length < chars.length * 2);
+        String got = SD.Deserialize(r, String.class);
+        assertEquals(latin1, got);
+        assertEquals(latin1.hashCode(), got.hashCode());
+
+        // latin-1 and utf-16 values side by side
+        List<String> mixed = new ArrayList<String>(
+                Arrays.asList("", "abc", latin1, "\u4e2d\u6587", "a\u4e2d" + latin1));
+        byte[] m = SD.Serialize(mixed);
+        assertIterableEquals(mixed, SD.Deserialize(m, ArrayList.class));
+        for (int i = 0; i < mixed.size(); i++) {
+            assertEquals(mixed.get(i).hashCode(), SD.HashKey(m, 0, i));
+        }
+    }
+}
@@ -0,0 +1,37 @@
+package pdsl;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+import pdsl.dpx.SD;
+import pdsl.dpx.Options;
+import pdsl.dpx.bench.jsbs.*;
+
+// the tests of TestSD in the compact format, which the reviver and the key hasher read with heads of their own
+public class TestSDCompact extends TestSD {
+    @BeforeAll
+    static void initAll() {
+        Options o = defaults();
+        o.compactFormat = true;
+        initialize(o);
+    }
+
+    @Test
+    @Override
+    void testDeep() {
+        // no alignment and one byte heads, so a link takes less than the 32 bytes of the aligned format, yet holds
+        // the 20 bytes of primitive fields of its A and B
+        byte[] r = SD.Serialize(chain(100000));
+        assertTrue(r.length > 100000 * 20);
+        assertTrue(r.length < 100000 * 2 * 16);
+
+        A get = SD.Deserialize(SD.Serialize(chain(1000)), A.class);
+        for (int i = 0; i < 1000; i++) {
+            assertEquals(i, get.i);
+            assertEquals(i, get.b.l);
+            get = get.b.a;
+        }
+        assertNull(get.b);
+    }
+}
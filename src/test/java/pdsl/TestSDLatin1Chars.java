@@ -0,0 +1,34 @@
+package pdsl;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+import java.util.Arrays;
+
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+import pdsl.dpx.SD;
+import pdsl.dpx.Options;
+import pdsl.dpx.bench.jsbs.*;
+
+// the tests of TestSD with Latin-1 char arrays stored as bytes
+public class TestSDLatin1Chars extends TestSD {
+    @BeforeAll
+    static void initAll() {
+        Options o = defaults();
+        o.enableLatin1Chars = true;
+        initialize(o);
+    }
+
+    @Test
+    void testLatin1CharArray() {
+        F f = new F();
+        f.fake_str = new char[4096];
+        Arrays.fill(f.fake_str, '\u00e9');
+        E e = new E();
+        e.fake_strings = new F[] {f};
+        byte[] r = SD.Serialize(e);
+        // one byte per char instead of two
+        assertTrue(r.length < f.fake_str.length * 2);
+        assertEquals(e, SD.Deserialize(r, E.class));
+    }
+}
@@ -0,0 +1,17 @@
+package pdsl;
+
+import org.junit.jupiter.api.BeforeAll;
+import pdsl.dpx.Options;
+
+// the tests of TestSD with root object arrays walked and revived by host threads, see testWide, testBoxed and
+// testHashKey. the revivers of the other threads run out of a critical region and store through jni
+public class TestSDParallel extends TestSD {
+    @BeforeAll
+    static void initAll() {
+        Options o = defaults();
+        o.maxHostThreads = 4;
+        o.indexLargeArrays = true;
+        o.minParallelArrayLength = 2;
+        initialize(o);
+    }
+}
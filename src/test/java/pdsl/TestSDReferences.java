@@ -0,0 +1,51 @@
+package pdsl;
+
+import static org.junit.jupiter.api.Assertions.*;
+
+import java.util.ArrayList;
+import java.util.List;
+
+import org.junit.jupiter.api.BeforeAll;
+import org.junit.jupiter.api.Test;
+import pdsl.dpx.SD;
+import pdsl.dpx.Options;
+import pdsl.dpx.bench.jsbs.*;
+
+// the tests of TestSD with shared references and cycles tracked
+public class TestSDReferences extends TestSD {
+    @BeforeAll
+    static void initAll() {
+        Options o = defaults();
+        o.trackReferences = true;
+        initialize(o);
+    }
+
+    @Test
+    void testReference() {
+        A a = new A();
+        B b = new B();
+        C c = new C();
+
+        a.b = b;
+        a.c = c;
+        b.a = a;
+        b.c = c;
+        c.s = C.Size.SMALL;
+
+        byte[] r = SD.Serialize(a);
+        A get = SD.Deserialize(r, A.class);
+        assertEquals(a, get);
+        assertSame(get, get.b.a);
+        assertSame(get.c, get.b.c);
+
+        String s = "shared";
+        List<String> names = new ArrayList<String>();
+        names.add(s);
+        names.add(s);
+        names.add("other");
+        ArrayList<?> gotNames = SD.Deserialize(SD.Serialize(names), ArrayList.class);
+        assertIterableEquals(names, gotNames);
+        assertSame(gotNames.get(0), gotNames.get(1));
+    }
+
+}